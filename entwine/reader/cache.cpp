@@ -15,7 +15,9 @@
 #include <entwine/reader/chunk-reader.hpp>
 #include <entwine/reader/reader.hpp>
 #include <entwine/types/metadata.hpp>
+#include <entwine/types/packs.hpp>
 #include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/unique.hpp>
 
@@ -26,11 +28,13 @@ FetchInfo::FetchInfo(
         const Reader& reader,
         const Id& id,
         const Bounds& bounds,
-        const std::size_t depth)
+        const std::size_t depth,
+        const DimNames* dims)
     : reader(reader)
     , id(id)
     , bounds(bounds)
     , depth(depth)
+    , dims(dims)
 { }
 
 bool FetchInfo::operator<(const FetchInfo& other) const
@@ -76,6 +80,7 @@ DataChunkState::~DataChunkState() { }
 Cache::Cache(const std::size_t maxBytes)
     : m_maxBytes(std::max<std::size_t>(maxBytes, 1024 * 1024 * 16))
     , m_maxHierarchyBytes(m_maxBytes / 8)
+    , m_maxMappedBytes(m_maxBytes * 4)
 { }
 
 void Cache::release(const Reader& reader)
@@ -90,7 +95,9 @@ void Cache::release(const Reader& reader)
     {
         if (it->path == reader.path())
         {
-            m_activeBytes -= localManager.at(it->id)->chunkReader->size();
+            const ColdChunkReader& chunk(*localManager.at(it->id)->chunkReader);
+            m_activeBytes -= chunk.size();
+            m_mappedBytes -= chunk.mappedSize();
             localManager.erase(it->id);
             it = m_inactiveList.erase(it);
         }
@@ -113,6 +120,32 @@ std::unique_ptr<Block> Cache::acquire(
 {
     std::unique_ptr<Block> block(reserve(readerPath, fetches));
 
+    // Chunks near each other within a remote pack are fetched together, and
+    // the rest on their own.
+    Packs* packs(nullptr);
+    std::vector<Id> ids;
+
+    if (!fetches.empty())
+    {
+        const Reader& reader(fetches.begin()->reader);
+        packs = reader.metadata().storage().packs();
+
+        if (packs)
+        {
+            for (const auto& f : fetches)
+            {
+                std::unique_lock<std::mutex> globalLock(m_mutex);
+                DataChunkState& state(*m_chunkManager.at(readerPath).at(f.id));
+                globalLock.unlock();
+
+                std::lock_guard<std::mutex> lock(state.mutex);
+                if (!state.chunkReader) ids.push_back(f.id);
+            }
+
+            packs->prefetch(reader.endpoint(), ids);
+        }
+    }
+
     bool success(true);
     std::mutex mutex;
     Pool pool(std::min<std::size_t>(2, fetches.size()));
@@ -135,6 +168,8 @@ std::unique_ptr<Block> Cache::acquire(
 
     pool.join();
 
+    if (packs) packs->drop(ids);
+
     if (!success)
     {
         throw std::runtime_error("Invalid remote index state: " + readerPath);
@@ -178,12 +213,17 @@ void Cache::release(const Block& block)
         }
     }
 
-    while (m_activeBytes > m_maxBytes && m_inactiveList.size())
+    while (
+            (m_activeBytes > m_maxBytes || m_mappedBytes > m_maxMappedBytes) &&
+            m_inactiveList.size())
     {
         const GlobalChunkInfo& toRemove(m_inactiveList.back());
 
         LocalManager& localManager(m_chunkManager.at(toRemove.path));
-        m_activeBytes -= localManager.at(toRemove.id)->chunkReader->size();
+        const ColdChunkReader& chunk(
+                *localManager.at(toRemove.id)->chunkReader);
+        m_activeBytes -= chunk.size();
+        m_mappedBytes -= chunk.mappedSize();
         localManager.erase(toRemove.id);
 
         if (localManager.empty()) m_chunkManager.erase(toRemove.path);
@@ -269,10 +309,17 @@ const ColdChunkReader* Cache::fetch(
                 fetchInfo.bounds,
                 reader.pool(),
                 fetchInfo.id,
-                fetchInfo.depth);
+                fetchInfo.depth,
+                fetchInfo.dims);
 
         globalLock.lock();
         m_activeBytes += chunkState.chunkReader->size();
+        m_mappedBytes += chunkState.chunkReader->mappedSize();
+    }
+    else if (!chunkState.chunkReader->chunk().covers(fetchInfo.dims))
+    {
+        // Cached by a query which needed fewer dimensions than this one.
+        chunkState.chunkReader->chunk().fill(fetchInfo.dims);
     }
 
     return chunkState.chunkReader.get();
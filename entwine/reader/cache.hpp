@@ -21,6 +21,7 @@
 #include <string>
 
 #include <entwine/reader/hierarchy-reader.hpp>
+#include <entwine/types/storage-types.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 
@@ -34,16 +35,20 @@ class Schema;
 
 struct FetchInfo
 {
+    // If dims is non-null, only those dimensions are needed from the chunk,
+    // and it must outlive the fetch.
     FetchInfo(
             const Reader& reader,
             const Id& id,
             const Bounds& bounds,
-            std::size_t depth);
+            std::size_t depth,
+            const DimNames* dims = nullptr);
 
     const Reader& reader;
     const Id id;
     const Bounds bounds;
     const std::size_t depth;
+    const DimNames* dims;
 
     bool operator<(const FetchInfo& rhs) const;
 };
@@ -140,6 +145,10 @@ public:
     std::size_t maxBytes() const { return m_maxBytes; }
     std::size_t activeBytes() const { return m_activeBytes; }
 
+    // Bytes of locally mapped chunks, which live in the filesystem cache
+    // rather than our heap, so are bounded separately from activeBytes.
+    std::size_t mappedBytes() const { return m_mappedBytes; }
+
     void release(const Reader& reader);
 
 private:
@@ -155,7 +164,14 @@ private:
 
     const std::size_t m_maxBytes;
     const std::size_t m_maxHierarchyBytes;
+
+    // Mapped pages may be reclaimed by the kernel, so they may exceed our
+    // heap budget - this bound only keeps idle chunks from pinning the page
+    // cache indefinitely.
+    const std::size_t m_maxMappedBytes;
+
     std::size_t m_activeBytes = 0;
+    std::size_t m_mappedBytes = 0;
     std::size_t m_hierarchyBytes = 0;
 
     GlobalManager m_chunkManager;
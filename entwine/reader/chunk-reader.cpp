@@ -14,6 +14,7 @@
 
 #include <entwine/tree/chunk.hpp>
 #include <entwine/types/binary-point-table.hpp>
+#include <entwine/types/grid.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/storage.hpp>
@@ -25,6 +26,23 @@ namespace entwine
 namespace
 {
     const std::size_t poolBlockSize(1024);
+
+    // Integral points are ticked in integer space, which matches the ticks
+    // of the integer-space climb performed while building.
+    std::size_t calcTick(
+            const Grid& grid,
+            const Point& point,
+            const Bounds& bounds,
+            const std::size_t depth)
+    {
+        Grid::Coord coords[3];
+        if (depth < grid.depthEnd() && grid.normalize(point, coords))
+        {
+            return grid.tick(coords, depth);
+        }
+
+        return Tube::calcTick(point, bounds, depth);
+    }
 }
 
 ChunkReader::ChunkReader(
@@ -34,7 +52,8 @@ ChunkReader::ChunkReader(
         const Bounds& bounds,
         PointPool& pool,
         const Id& id,
-        const std::size_t depth)
+        const std::size_t depth,
+        const DimNames* dims)
     : m_endpoint(endpoint)
     , m_metadata(metadata)
     , m_pool(pool.schema(), pool.delta(), poolBlockSize)
@@ -42,8 +61,72 @@ ChunkReader::ChunkReader(
     , m_schema(metadata.schema())
     , m_id(id)
     , m_depth(depth)
-    , m_cells(metadata.storage().deserialize(endpoint, tmp, m_pool, m_id))
-{ }
+    , m_cells(m_pool.cellPool())
+{
+    const Storage& storage(metadata.storage());
+
+    if ((m_mapped = storage.map(endpoint, m_id)))
+    {
+        m_index = m_mapped->index;
+    }
+    else if (dims && storage.projects())
+    {
+        m_cells = storage.deserialize(
+                endpoint, tmp, m_pool, m_id, *dims, &m_index);
+
+        for (const DimInfo& dim : m_schema.dims())
+        {
+            const std::string name(dim.name());
+            const bool xyz(name == "X" || name == "Y" || name == "Z");
+            if (!xyz && !dims->count(name)) m_missing.insert(name);
+        }
+    }
+    else
+    {
+        m_cells = storage.deserialize(endpoint, tmp, m_pool, m_id, &m_index);
+    }
+
+    if (m_index && m_index->numPoints() != numPoints())
+    {
+        throw std::runtime_error("Invalid chunk index for " + m_id.str());
+    }
+}
+
+std::size_t ChunkReader::mappedBytes() const
+{
+    return m_mapped ? m_mapped->numPoints * m_schema.pointSize() : 0;
+}
+
+std::size_t ChunkReader::numPoints() const
+{
+    return m_mapped ? m_mapped->numPoints : m_cells.size();
+}
+
+bool ChunkReader::covers(const DimNames* dims) const
+{
+    if (!dims) return m_missing.empty();
+
+    for (const std::string& name : *dims)
+    {
+        if (m_missing.count(name)) return false;
+    }
+
+    return true;
+}
+
+void ChunkReader::fill(const DimNames* dims)
+{
+    DimNames fills;
+    for (const std::string& name : m_missing)
+    {
+        if (!dims || dims->count(name)) fills.insert(name);
+    }
+
+    if (fills.empty()) return;
+
+    m_metadata.storage().fill(m_endpoint, m_id, fills, m_cells);
+    for (const std::string& name : fills) m_missing.erase(name);
+}
 
 ChunkReader::ChunkReader(
         const Metadata& m,
@@ -144,42 +227,96 @@ ColdChunkReader::ColdChunkReader(
         const Bounds& bounds,
         PointPool& pool,
         const Id& id,
-        std::size_t depth)
-    : m_chunk(m, ep, tmp, bounds, pool, id, depth)
+        std::size_t depth,
+        const DimNames* dims)
+    : m_chunk(m, ep, tmp, bounds, pool, id, depth, dims)
 {
-    m_points.reserve(m_chunk.cells().size());
+    m_points.reserve(m_chunk.numPoints());
 
     const auto& globalBounds(m.boundsScaledCubic());
-    std::size_t offset(0);
+    const Grid grid(globalBounds);
 
-    for (const auto& cell : m_chunk.cells())
+    // Points of an indexed chunk are found by their index, so they need no
+    // ticks and keep their stored order.
+    const bool indexed(m_chunk.index());
+
+    auto add([&](const Point& point, const char* data)
     {
         m_points.emplace_back(
-                offset,
-                cell.point(),
-                cell.uniqueData(),
-                Tube::calcTick(cell.point(), globalBounds, depth));
-        ++offset;
+                m_points.size(),
+                point,
+                data,
+                indexed ? 0 : calcTick(grid, point, globalBounds, depth));
+    });
+
+    if (const MappedChunk* mapped = m_chunk.mapped())
+    {
+        BinaryPointTable table(m.schema());
+        pdal::PointRef pointRef(table, 0);
+
+        const std::size_t pointSize(m.schema().pointSize());
+        const char* pos(mapped->data);
+
+        for (std::size_t i(0); i < mapped->numPoints; ++i)
+        {
+            table.setPoint(pos);
+
+            add(
+                    Point(
+                        pointRef.getFieldAs<double>(pdal::Dimension::Id::X),
+                        pointRef.getFieldAs<double>(pdal::Dimension::Id::Y),
+                        pointRef.getFieldAs<double>(pdal::Dimension::Id::Z)),
+                    pos);
+
+            pos += pointSize;
+        }
+    }
+
+    for (const auto& cell : m_chunk.cells())
+    {
+        add(cell.point(), cell.uniqueData());
     }
 
-    std::sort(m_points.begin(), m_points.end());
+    if (!indexed) std::sort(m_points.begin(), m_points.end());
 }
 
-ColdChunkReader::QueryRange ColdChunkReader::candidates(const Bounds& qb) const
+std::vector<ColdChunkReader::QueryRange> ColdChunkReader::candidates(
+        const Bounds& qb) const
 {
+    std::vector<QueryRange> result;
+
     if (qb.contains(m_chunk.bounds()))
     {
-        return QueryRange(m_points.begin(), m_points.end());
+        result.emplace_back(m_points.begin(), m_points.end());
+        return result;
+    }
+
+    if (const ChunkIndex* index = m_chunk.index())
+    {
+        for (const ChunkIndex::Range& r : index->ranges(qb))
+        {
+            result.emplace_back(
+                    m_points.begin() + r.first,
+                    m_points.begin() + r.second);
+        }
+
+        return result;
     }
 
+    // Our points may have been ticked in integer space while the query
+    // bounds generally are not, so pad the range by a tick on either side to
+    // absorb any floating point disagreement at tick boundaries.
     const auto& gb(m_chunk.metadata().boundsScaledCubic());
-    const PointInfo min(Tube::calcTick(qb.min(), gb, m_chunk.depth()));
-    const PointInfo max(Tube::calcTick(qb.max(), gb, m_chunk.depth()));
+    const std::size_t minTick(Tube::calcTick(qb.min(), gb, m_chunk.depth()));
+    const std::size_t maxTick(Tube::calcTick(qb.max(), gb, m_chunk.depth()));
+    const PointInfo min(minTick ? minTick - 1 : 0);
+    const PointInfo max(maxTick + 1);
 
     It begin(std::lower_bound(m_points.begin(), m_points.end(), min));
     It end(std::upper_bound(m_points.begin(), m_points.end(), max));
 
-    return QueryRange(begin, end);
+    result.emplace_back(begin, end);
+    return result;
 }
 
 BaseChunkReader::BaseChunkReader(
@@ -191,6 +328,7 @@ BaseChunkReader::BaseChunkReader(
 {
     const Structure& s(m.structure());
     const auto& globalBounds(m.boundsScaledCubic());
+    const Grid grid(globalBounds);
     Climber climber(m);
 
     std::size_t offset(0);
@@ -205,7 +343,7 @@ BaseChunkReader::BaseChunkReader(
                 offset,
                 cell.point(),
                 cell.uniqueData(),
-                Tube::calcTick(cell.point(), globalBounds, depth));
+                calcTick(grid, cell.point(), globalBounds, depth));
 
         if (++offset == m_chunk.offsets().at(slice)) ++slice;
     }
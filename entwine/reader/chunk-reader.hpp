@@ -19,6 +19,7 @@
 #include <entwine/reader/append.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/types/storage-types.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/types/vector-point-table.hpp>
 #include <entwine/util/io.hpp>
@@ -29,11 +30,15 @@ namespace entwine
 class Bounds;
 class Metadata;
 class Schema;
+struct MappedChunk;
 
 class ChunkReader
 {
 public:
-    // Cold chunks.
+    // Cold chunks.  If dims is given, only those dimensions may be decoded -
+    // see Storage::projects.  If the chunk may be mapped - see Storage::map -
+    // its points are served in place from the mapping and we have no cells.
+    // If the chunk is indexed, its index is read along with it.
     ChunkReader(
             const Metadata& metadata,
             const arbiter::Endpoint& endpoint,
@@ -41,7 +46,8 @@ public:
             const Bounds& bounds,
             PointPool& pool,
             const Id& id,
-            std::size_t depth);
+            std::size_t depth,
+            const DimNames* dims = nullptr);
 
     // Base chunks.
     ChunkReader(
@@ -60,6 +66,18 @@ public:
     const Cell::PooledStack& cells() const { return m_cells; }
     const std::vector<std::size_t> offsets() const { return m_offsets; }
 
+    const MappedChunk* mapped() const { return m_mapped.get(); }
+    const ChunkIndex* index() const { return m_index.get(); }
+    std::size_t mappedBytes() const;
+    std::size_t numPoints() const;
+
+    // True if each of these dimensions, or every dimension if null, has
+    // been decoded.  Otherwise, the missing ones may be filled in, which must
+    // be done with the chunk's cache state locked.  Points already handed out
+    // are filled in place, and their other dimensions are untouched.
+    bool covers(const DimNames* dims) const;
+    void fill(const DimNames* dims);
+
     Append& getOrCreateAppend(std::string name, const Schema& s) const
     {
         std::lock_guard<std::mutex> lock(m);
@@ -70,7 +88,7 @@ public:
                     name,
                     s,
                     m_id,
-                    m_cells.size());
+                    numPoints());
             m_appends[name] = std::move(append);
         }
         return *m_appends.at(name);
@@ -81,7 +99,7 @@ public:
         std::lock_guard<std::mutex> lock(m);
         if (m_appends.count(name)) return m_appends.at(name).get();
 
-        const auto np(m_cells.size());
+        const auto np(numPoints());
         if (auto a = Append::maybeCreate(m_endpoint, name, s, m_id, np))
         {
             m_appends[name] = std::move(a);
@@ -103,6 +121,11 @@ protected:
 
     Cell::PooledStack m_cells;
     std::vector<std::size_t> m_offsets;
+    std::unique_ptr<MappedChunk> m_mapped;
+    std::shared_ptr<const ChunkIndex> m_index;
+
+    // Native dimensions which have not been decoded.
+    DimNames m_missing;
 
     mutable std::mutex m;
     mutable std::map<std::string, std::unique_ptr<Append>> m_appends;
@@ -153,7 +176,8 @@ public:
             const Bounds& bounds,
             PointPool& pool,
             const Id& id,
-            std::size_t depth);
+            std::size_t depth,
+            const DimNames* dims = nullptr);
 
     using It = TubeData::const_iterator;
     struct QueryRange
@@ -162,12 +186,22 @@ public:
         It begin, end;
     };
 
-    QueryRange candidates(const Bounds& queryBounds) const;
+    // Runs of our points which may lie within the query bounds.  If our
+    // chunk is indexed, these are found from its index, in which case our
+    // points are in their stored order.  Otherwise our points are sorted by
+    // tick, and a single run is found from the query's Z extents.
+    std::vector<QueryRange> candidates(const Bounds& queryBounds) const;
+
+    // Heap bytes held for our points.  The points of a mapped chunk live in
+    // the filesystem cache instead, and are counted by mappedSize.
     std::size_t size() const
     {
+        if (m_chunk.mapped()) return m_points.size() * sizeof(PointInfo);
         return m_chunk.cells().size() * m_chunk.schema().pointSize();
     }
 
+    std::size_t mappedSize() const { return m_chunk.mappedBytes(); }
+
     ChunkReader& chunk() { return m_chunk; }
     ChunkReader& chunk() const { return m_chunk; }
 
@@ -18,6 +18,7 @@
 #include <entwine/reader/logic-gate.hpp>
 #include <entwine/types/delta.hpp>
 #include <entwine/types/metadata.hpp>
+#include <entwine/types/storage-types.hpp>
 
 namespace entwine
 {
@@ -33,6 +34,7 @@ public:
         : m_metadata(metadata)
         , m_queryBounds(queryBounds)
         , m_root()
+        , m_dims()
     {
         if (json.isObject()) build(m_root, json, delta);
         else if (!json.isNull())
@@ -56,6 +58,9 @@ public:
         m_root.log("");
     }
 
+    // Names of the dimensions our comparisons test.
+    const DimNames& dims() const { return m_dims; }
+
 private:
     void build(LogicGate& gate, const Json::Value& json, const Delta* delta)
     {
@@ -84,6 +89,7 @@ private:
                 else if (!val.isObject() || val.size() == 1)
                 {
                     // a comparison query object.
+                    use(key);
                     active->push(
                             Comparison::create(m_metadata, key, val, delta));
                 }
@@ -98,6 +104,7 @@ private:
                     // There cannot be any further nested logical operators
                     // within val, since we've already selected a dimension.
                     //
+                    use(key);
                     for (const std::string& innerKey : val.getMemberNames())
                     {
                         Json::Value next;
@@ -125,9 +132,15 @@ private:
         }
     }
 
+    void use(const std::string& name)
+    {
+        m_dims.insert(name == "Path" ? "OriginId" : name);
+    }
+
     const Metadata& m_metadata;
     const Bounds m_queryBounds;
     LogicalAnd m_root;
+    DimNames m_dims;
 };
 
 } // namespace entwine
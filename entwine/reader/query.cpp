@@ -97,9 +97,14 @@ Query::Query(const Reader& reader, const QueryParams& p)
     , m_depthBegin(p.db())
     , m_depthEnd(p.de() ? p.de() : std::numeric_limits<uint32_t>::max())
     , m_filter(m_reader.metadata(), m_bounds, p.filter(), &m_delta)
+    , m_dims(m_filter.dims())
     , m_table(m_reader.metadata().schema())
     , m_pointRef(m_table, 0)
 {
+    m_dims.insert("X");
+    m_dims.insert("Y");
+    m_dims.insert("Z");
+
     if (!m_depthEnd || m_depthEnd > m_structure.coldDepthBegin())
     {
         QueryChunkState chunkState(m_structure, m_metadata.boundsScaledCubic());
@@ -116,7 +121,12 @@ void Query::getFetches(const QueryChunkState& c)
         if (!m_reader.exists(c)) return;
         if (c.depth() >= m_depthBegin)
         {
-            m_chunks.emplace(m_reader, c.chunkId(), c.bounds(), c.depth());
+            m_chunks.emplace(
+                    m_reader,
+                    c.chunkId(),
+                    c.bounds(),
+                    c.depth(),
+                    &m_dims);
         }
     }
 
@@ -214,13 +224,15 @@ void Query::getChunked()
         {
             chunk(cr->chunk());
 
-            ColdChunkReader::QueryRange range(cr->candidates(m_bounds));
-            auto it(range.begin);
-
-            while (it != range.end)
+            for (const auto& range : cr->candidates(m_bounds))
             {
-                processPoint(*it);
-                ++it;
+                auto it(range.begin);
+
+                while (it != range.end)
+                {
+                    processPoint(*it);
+                    ++it;
+                }
             }
 
             if (++m_chunkReaderIt == m_block->chunkMap().end())
@@ -276,7 +288,12 @@ ReadQuery::ReadQuery(
             params.nativeBounds() ?
                 m_delta.offset() :
                 m_metadata.boundsScaledCubic().mid())
-{ }
+{
+    for (const auto& d : m_reg.dims())
+    {
+        if (d.native()) m_dims.insert(d.info().name());
+    }
+}
 
 void ReadQuery::chunk(const ChunkReader& cr)
 {
@@ -69,6 +69,10 @@ protected:
     const std::size_t m_depthEnd;
     const Filter m_filter;
 
+    // Native dimensions needed from each chunk - derived queries which read
+    // more of them add theirs before the first call to next.
+    DimNames m_dims;
+
     BinaryPointTable m_table;
     pdal::PointRef m_pointRef;
 
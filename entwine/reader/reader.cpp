@@ -23,8 +23,10 @@
 #include <entwine/tree/registry.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/manifest.hpp>
+#include <entwine/types/packs.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/types/subset.hpp>
 #include <entwine/util/compression.hpp>
@@ -288,7 +290,14 @@ bool Reader::exists(const QueryChunkState& c) const
         val = false;
 
         const auto f(m_metadata.filename(c.chunkId()));
-        if (const auto size = m_endpoint.tryGetSize(f)) val = *size;
+
+        // Packed chunks are found in the index of packs, rather than by a
+        // request for each.
+        if (const Packs* packs = m_metadata.storage().packs())
+        {
+            val = packs->contains(m_endpoint, c.chunkId());
+        }
+        else if (const auto size = m_endpoint.tryGetSize(f)) val = *size;
         std::cout << m_endpoint.prefixedRoot() << f << ": " << val << std::endl;
         return val;
     }
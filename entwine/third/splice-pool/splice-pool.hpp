@@ -22,16 +22,23 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <deque>
 #include <functional>
 #include <iostream>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <type_traits>
 #include <vector>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace splicer
 {
 
@@ -730,9 +737,12 @@ public:
 
     SplicePool(std::size_t blockSize)
         : m_blockSize(blockSize)
+        , m_magazineSize(
+                blockSize < maxMagazineSize ? blockSize : maxMagazineSize)
         , m_stack()
         , m_mutex()
         , m_allocated(0)
+        , m_magazines(new Magazine[numMagazines])
     { }
 
     virtual ~SplicePool() { }
@@ -748,27 +758,56 @@ public:
         return allocated() - available();
     }
 
+    // Includes nodes held in thread caches.
     std::size_t available() const
     {
+        std::size_t result(0);
+
+        for (std::size_t i(0); i < numMagazines; ++i)
+        {
+            const Magazine& m(m_magazines[i]);
+            std::lock_guard<std::mutex> lock(m.mutex);
+            result += m.stack.size();
+        }
+
         std::lock_guard<std::mutex> lock(m_mutex);
-        return m_stack.size();
+        return result + m_stack.size();
     }
 
+    // Number of acquisitions satisfied entirely by a thread cache, and the
+    // number which had to reach into the shared stack.
+    std::size_t hits() const { return sum(&Magazine::hits); }
+    std::size_t misses() const { return sum(&Magazine::misses); }
+
     void release(UniqueNodeType&& node) { node.reset(); }
     void release(UniqueStackType&& stack) { stack.reset(); }
 
+    // Hand the memory backing the free nodes of the shared stack back to the
+    // operating system, where the pool type allows it, returning the number of
+    // bytes released.  The nodes remain available, and their memory is
+    // simply faulted back in when they are next used.
+    std::size_t trim()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return doTrim(m_stack);
+    }
+
     void release(Node<T>* node)
     {
         if (node)
         {
             reset(&node->val());
 
-            // TODO - For these single node releases, we could put them into a
-            // separate Stack to avoid blocking the entire pool, and only reach
-            // into it when some threshold is reached or the main stack is
-            // empty.
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_stack.push(node);
+            Magazine& m(magazine());
+            Stack<T> excess;
+
+            {
+                std::lock_guard<std::mutex> lock(m.mutex);
+                m.stack.push(node);
+                excess = flush(m);
+            }
+
+            give(excess);
         }
     }
 
@@ -782,8 +821,24 @@ public:
                 node = node->next();
             }
 
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_stack.push(other);
+            // Large stacks, for example those of entire chunks, go straight
+            // back to the shared stack rather than churning a cache.
+            if (other.size() >= m_magazineSize)
+            {
+                give(other);
+                return;
+            }
+
+            Magazine& m(magazine());
+            Stack<T> excess;
+
+            {
+                std::lock_guard<std::mutex> lock(m.mutex);
+                m.stack.push(other);
+                excess = flush(m);
+            }
+
+            give(excess);
         }
     }
 
@@ -791,21 +846,24 @@ public:
     UniqueNodeType acquireOne(Args&&... args)
     {
         UniqueNodeType node(*this);
+        Magazine& m(magazine());
 
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            node.reset(m_stack.pop());
+            std::lock_guard<std::mutex> lock(m.mutex);
+            node.reset(m.stack.pop());
+
+            if (node) ++m.hits;
+            else ++m.misses;
         }
 
         if (!node)
         {
-            Stack<T> newStack(doAllocate(1));
-            node.reset(newStack.pop());
-
-            std::lock_guard<std::mutex> lock(m_mutex);
+            // Refill this cache in bulk, rather than a node at a time.
+            Stack<T> refill(take(m_magazineSize + 1));
+            node.reset(refill.pop());
 
-            m_allocated += m_blockSize;
-            m_stack.push(newStack);
+            std::lock_guard<std::mutex> lock(m.mutex);
+            m.stack.push(refill);
         }
 
         if (!std::is_pointer<T>::value)
@@ -818,38 +876,24 @@ public:
 
     UniqueStackType acquire(const std::size_t count)
     {
-        UniqueStackType other(*this);
+        Magazine& m(magazine());
+        Stack<T> stack;
 
-        std::unique_lock<std::mutex> lock(m_mutex);
-        if (count >= m_stack.size())
         {
-            other = UniqueStackType(*this, std::move(m_stack));
-
-            lock.unlock();
+            std::lock_guard<std::mutex> lock(m.mutex);
+            stack = m.stack.popStack(count);
 
-            if (count > other.size())
-            {
-                const std::size_t numNodes(count - other.size());
-                const std::size_t numBlocks(numNodes / m_blockSize + 1);
-
-                Stack<T> alloc(doAllocate(numBlocks));
-
-                assert(alloc.size() == numBlocks * m_blockSize);
-
-                Stack<T> taken(alloc.popStack(numNodes));
-                other.push(taken);
-
-                lock.lock();
-                m_stack.push(alloc);
-                m_allocated += numBlocks * m_blockSize;
-            }
+            if (stack.size() == count) ++m.hits;
+            else ++m.misses;
         }
-        else
+
+        if (stack.size() < count)
         {
-            other = UniqueStackType(*this, m_stack.popStack(count));
+            Stack<T> rest(take(count - stack.size()));
+            stack.push(rest);
         }
 
-        return other;
+        return UniqueStackType(*this, std::move(stack));
     }
 
 protected:
@@ -860,6 +904,7 @@ protected:
     }
 
     virtual Stack<T> doAllocate(std::size_t blocks) = 0;
+    virtual std::size_t doTrim(const Stack<T>&) { return 0; }
     virtual void construct(T*) const { }
     virtual void destruct(T*) const { }
 
@@ -869,10 +914,109 @@ private:
     SplicePool(const SplicePool&) = delete;
     SplicePool& operator=(const SplicePool&) = delete;
 
+    // A cache of free nodes in front of the shared stack.  Threads are
+    // assigned to caches round-robin, so as long as there are no more threads
+    // than caches, each cache lock is uncontended and the shared stack is
+    // only locked to move entire stacks to or from a cache.
+    struct Magazine
+    {
+        Stack<T> stack;
+        mutable std::mutex mutex;
+        std::size_t hits = 0;
+        std::size_t misses = 0;
+
+        // Keep neighboring caches off of each other's cache lines.
+        char pad[64];
+    };
+
+    static constexpr std::size_t numMagazines = 64;
+    static constexpr std::size_t maxMagazineSize = 256;
+
+    static std::size_t threadIndex()
+    {
+        static std::atomic_size_t next(0);
+        thread_local const std::size_t index(next++);
+        return index;
+    }
+
+    Magazine& magazine()
+    {
+        return m_magazines[threadIndex() % numMagazines];
+    }
+
+    std::size_t sum(std::size_t Magazine::*counter) const
+    {
+        std::size_t result(0);
+
+        for (std::size_t i(0); i < numMagazines; ++i)
+        {
+            const Magazine& m(m_magazines[i]);
+            std::lock_guard<std::mutex> lock(m.mutex);
+            result += m.*counter;
+        }
+
+        return result;
+    }
+
+    // Called with the cache locked.  If it has grown too large, returns the
+    // nodes that should be handed back to the shared stack.
+    Stack<T> flush(Magazine& m)
+    {
+        if (m.stack.size() > 2 * m_magazineSize)
+        {
+            return m.stack.popStack(m.stack.size() - m_magazineSize);
+        }
+
+        return Stack<T>();
+    }
+
+    void give(Stack<T>& other)
+    {
+        if (other.empty()) return;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stack.push(other);
+    }
+
+    // Take exactly count nodes from the shared stack, allocating more if
+    // needed.
+    Stack<T> take(const std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        if (count < m_stack.size()) return m_stack.popStack(count);
+
+        Stack<T> other(std::move(m_stack));
+        lock.unlock();
+
+        if (count > other.size())
+        {
+            const std::size_t numNodes(count - other.size());
+            const std::size_t numBlocks(numNodes / m_blockSize + 1);
+
+            Stack<T> alloc(doAllocate(numBlocks));
+
+            assert(alloc.size() == numBlocks * m_blockSize);
+
+            Stack<T> taken(alloc.popStack(numNodes));
+            other.push(taken);
+
+            lock.lock();
+            m_stack.push(alloc);
+            m_allocated += numBlocks * m_blockSize;
+        }
+
+        return other;
+    }
+
+    const std::size_t m_magazineSize;
+
     Stack<T> m_stack;
     mutable std::mutex m_mutex;
 
     std::size_t m_allocated;
+
+    std::unique_ptr<Magazine[]> m_magazines;
 };
 
 template<typename T>
@@ -998,6 +1142,60 @@ private:
         std::fill(*val, *val + m_bufferSize, 0);
     }
 
+    // Free buffers are zero-filled, which is exactly how discarded pages read
+    // back, so the pages lying entirely within runs of free buffers may be
+    // discarded outright.
+    virtual std::size_t doTrim(const Stack<T*>& stack) override
+    {
+#ifdef _WIN32
+        return 0;
+#else
+        std::vector<char*> buffers;
+        buffers.reserve(stack.size());
+
+        for (const Node<T*>* node(stack.head()); node; node = node->next())
+        {
+            buffers.push_back(reinterpret_cast<char*>(node->val()));
+        }
+
+        std::sort(buffers.begin(), buffers.end());
+
+        const std::size_t page(sysconf(_SC_PAGESIZE));
+        const std::size_t bytes(m_bufferSize * sizeof(T));
+        std::size_t released(0);
+
+        auto discard([page, &released](char* begin, char* end)
+        {
+            const std::size_t b(reinterpret_cast<std::size_t>(begin));
+            const std::size_t e(reinterpret_cast<std::size_t>(end));
+            const std::size_t first((b + page - 1) / page * page);
+            const std::size_t last(e / page * page);
+
+            if (first < last &&
+                    !madvise(
+                        reinterpret_cast<void*>(first),
+                        last - first,
+                        MADV_DONTNEED))
+            {
+                released += last - first;
+            }
+        });
+
+        std::size_t i(0);
+        while (i < buffers.size())
+        {
+            char* begin(buffers[i]);
+            char* end(begin + bytes);
+
+            while (++i < buffers.size() && buffers[i] == end) end += bytes;
+
+            discard(begin, end);
+        }
+
+        return released;
+#endif
+    }
+
     const std::size_t m_bufferSize;
     const std::size_t m_bytesPerBlock;
 
@@ -10,7 +10,9 @@
 
 #include <entwine/tree/builder.hpp>
 
+#include <algorithm>
 #include <chrono>
+#include <deque>
 #include <limits>
 #include <numeric>
 #include <random>
@@ -23,20 +25,26 @@
 #include <entwine/tree/clipper.hpp>
 #include <entwine/tree/heuristics.hpp>
 #include <entwine/tree/hierarchy-block.hpp>
+#include <entwine/tree/memory-budget.hpp>
+#include <entwine/tree/prefetcher.hpp>
 #include <entwine/tree/registry.hpp>
 #include <entwine/tree/sequence.hpp>
+#include <entwine/tree/serializer.hpp>
 #include <entwine/tree/thread-pools.hpp>
 #include <entwine/tree/traverser.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/metadata.hpp>
+#include <entwine/types/packs.hpp>
 #include <entwine/types/pooled-point-table.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/types/schema.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/types/subset.hpp>
 #include <entwine/util/compression.hpp>
 #include <entwine/util/executor.hpp>
 #include <entwine/util/json.hpp>
+#include <entwine/util/morton.hpp>
 #include <entwine/util/pool.hpp>
 #include <entwine/util/unique.hpp>
 
@@ -45,10 +53,34 @@ namespace entwine
 
 using namespace arbiter;
 
-namespace
+struct Builder::Lane
 {
-    const std::size_t inputRetryLimit(16);
-}
+    Lane(Builder& builder, Origin origin)
+        : origin(origin)
+        , clipper(builder, origin)
+        , climber(
+                *builder.m_metadata,
+                builder.m_deferHierarchy ?
+                    nullptr : builder.m_hierarchy.get())
+        , inserted(0)
+        , epoch(builder.m_memoryBudget ? builder.m_memoryBudget->epoch() : 0)
+        , mutex()
+        , pending()
+        , error()
+    { }
+
+    const Origin origin;
+    Clipper clipper;
+    Climber climber;
+    std::size_t inserted;
+    std::size_t epoch;
+
+    // A batch handed off to this lane, which is inserted by whichever of a
+    // worker or our reader gets to it first.
+    std::mutex mutex;
+    std::unique_ptr<Cell::PooledStack> pending;
+    std::string error;
+};
 
 Builder::Builder(
         const Metadata& metadata,
@@ -77,7 +109,6 @@ Builder::Builder(
                 *m_outEndpoint,
                 m_outEndpoint.get(),
                 false))
-    , m_sequence(makeUnique<Sequence>(*this))
     , m_registry(makeUnique<Registry>(*this))
     , m_start(now())
 {
@@ -107,7 +138,6 @@ Builder::Builder(
                 *m_outEndpoint,
                 m_outEndpoint.get(),
                 exists()))
-    , m_sequence(makeUnique<Sequence>(*this))
     , m_registry(makeUnique<Registry>(*this, exists()))
     , m_start(now())
 {
@@ -146,6 +176,22 @@ void Builder::go(std::size_t max)
 
     const std::size_t alreadyInserted(manifest.pointStats().inserts());
 
+    if (Packs* packs = m_metadata->storage().packs())
+    {
+        packs->stage(*m_tmpEndpoint);
+    }
+
+    if (m_uploadThreads && !m_serializer)
+    {
+        m_serializer = makeUnique<Serializer>(
+                m_metadata->storage(),
+                *m_outEndpoint,
+                m_compressThreads ?
+                    m_compressThreads :
+                    m_threadPools->clipPool().numThreads(),
+                m_uploadThreads);
+    }
+
     Pool p(2);
     p.add([this, max, &done]()
     {
@@ -178,14 +224,33 @@ void Builder::go(std::size_t max)
                 const std::size_t used(
                         100.0 - 100.0 * d.available() / (double)d.allocated());
 
+                // Fraction of pool acquisitions served by thread caches.
+                const std::size_t hits(d.hits());
+                const std::size_t cached(
+                        100.0 * hits / std::max<double>(hits + d.misses(), 1));
+
                 std::cout <<
                     " T: " << commify(s) << "s" <<
                     " P: " << commify(inserts * 3600.0 / s / 1000000.0) <<
                         "M/h" <<
                     " A: " << commify(d.allocated()) <<
                     " U: " << used << "%"  <<
+                    " M: " << cached << "%" <<
                     " C: " << commify(Chunk::count()) <<
-                    " H: " << commify(HierarchyBlock::count()) <<
+                    " S: " << commify(chunkSaves()) <<
+                    " R: " << commify(chunkReloads()) <<
+                    " H: " << commify(HierarchyBlock::count());
+
+                // Chunks queued for compression and for upload.
+                if (const Serializer* serializer = m_serializer.get())
+                {
+                    std::cout <<
+                        " Q: " <<
+                        serializer->compressStage().queued << "/" <<
+                        serializer->uploadStage().queued;
+                }
+
+                std::cout <<
                     " I: " << commify(inserts) <<
                     " P: " << std::round(progress * 100.0) << "%" <<
                     std::endl;
@@ -203,9 +268,22 @@ void Builder::doRun(const std::size_t max)
         throw std::runtime_error("Cannot add to read-only builder");
     }
 
-    while (auto o = m_sequence->next(max))
+    m_prefetcher = makeUnique<Prefetcher>(
+            *m_arbiter,
+            *m_tmpEndpoint,
+            m_prefetch,
+            m_prefetchBudget,
+            verbose());
+
+    // Origins whose inputs are being prefetched, but which have not yet been
+    // handed out for insertion.
+    std::deque<Origin> ahead;
+
+    auto dispatch([this, &ahead]()
     {
-        const Origin origin(*o);
+        const Origin origin(ahead.front());
+        ahead.pop_front();
+
         FileInfo& info(m_metadata->manifest().get(origin));
         const auto path(info.path());
 
@@ -245,11 +323,32 @@ void Builder::doRun(const std::size_t max)
                 message = "Unknown error";
             }
 
+            m_prefetcher->release(origin);
             m_metadata->manifest().set(origin, status, message);
             if (verbose()) std::cout << "\tDone " << origin << std::endl;
         });
+    });
+
+    while (auto o = sequence().next(max))
+    {
+        const Origin origin(*o);
+        m_prefetcher->push(origin, m_metadata->manifest().get(origin).path());
+        ahead.push_back(origin);
+
+        // Our fetched inputs may only be released by inserting them, so hand
+        // them out before waiting on the prefetch budget.
+        while (
+                ahead.size() > m_prefetcher->depth() ||
+                (!ahead.empty() && m_prefetcher->full()))
+        {
+            dispatch();
+        }
+
+        m_prefetcher->await();
     }
 
+    while (!ahead.empty()) dispatch();
+
     if (verbose())
     {
         std::cout << "\tPushes complete - joining..." << std::endl;
@@ -261,39 +360,8 @@ void Builder::doRun(const std::size_t max)
 void Builder::insertPath(const Origin origin, FileInfo& info)
 {
     const std::string rawPath(info.path());
-    std::size_t tries(0);
-    std::unique_ptr<arbiter::fs::LocalHandle> localHandle;
-
-    do
-    {
-        if (tries) std::this_thread::sleep_for(std::chrono::seconds(tries));
-
-        try
-        {
-            localHandle = m_arbiter->getLocalHandle(rawPath, *m_tmpEndpoint);
-        }
-        catch (const std::exception& e)
-        {
-            if (verbose())
-            {
-                std::cout <<
-                    "Failed GET " << tries << " of " << rawPath << ": " <<
-                    e.what() << std::endl;
-            }
-        }
-        catch (...)
-        {
-            if (verbose())
-            {
-                std::cout <<
-                    "Failed GET " << tries << " of " << rawPath << ": " <<
-                    "unknown error" << std::endl;
-            }
-        }
-    }
-    while (!localHandle && ++tries < inputRetryLimit);
-
-    if (!localHandle) throw std::runtime_error("No local handle: " + rawPath);
+    std::unique_ptr<LocalFile> localHandle(
+            m_prefetcher->take(origin, rawPath));
 
     const std::string& localPath(localHandle->localPath());
 
@@ -316,25 +384,50 @@ void Builder::insertPath(const Origin origin, FileInfo& info)
         }
     }
 
-    std::size_t inserted(0);
-
-    Clipper clipper(*this, origin);
-    Climber climber(*m_metadata, m_hierarchy.get());
+    // Very large files are inserted by several lanes at once, each with its
+    // own Clipper reporting under our origin.  Our reader hands batches off
+    // to idle workers when there are any, and otherwise inserts them itself.
+    std::vector<std::shared_ptr<Lane>> lanes;
+    lanes.push_back(std::make_shared<Lane>(*this, origin));
 
-    auto inserter([this, origin, &clipper, &climber, &inserted]
-    (Cell::PooledStack cells)
+    if (m_splitThreshold && info.numPoints() >= m_splitThreshold)
     {
-        inserted += cells.size();
+        const std::size_t n(
+                std::min<std::size_t>(
+                    m_threadPools->workPool().numThreads(),
+                    info.numPoints() / m_splitThreshold + 1));
 
-        if (inserted > heuristics::sleepCount)
+        while (lanes.size() < n)
         {
-            inserted = 0;
-            const float available(m_pointPool->dataPool().available());
-            const float allocated(m_pointPool->dataPool().allocated());
-            if (available / allocated < 0.5) clipper.clip();
+            lanes.push_back(std::make_shared<Lane>(*this, origin));
         }
+    }
 
-        return insertData(std::move(cells), origin, clipper, climber);
+    auto inserter([this, &lanes](Cell::PooledStack cells)
+    {
+        for (std::size_t i(1); i < lanes.size(); ++i)
+        {
+            std::shared_ptr<Lane> lane(lanes[i]);
+            std::unique_lock<std::mutex> lock(lane->mutex, std::try_to_lock);
+
+            if (lock && !lane->pending)
+            {
+                lane->pending = makeUnique<Cell::PooledStack>(std::move(cells));
+
+                if (m_threadPools->workPool().tryAdd([this, lane]()
+                {
+                    drain(*lane);
+                }))
+                {
+                    return Cell::PooledStack(m_pointPool->cellPool());
+                }
+
+                cells = std::move(*lane->pending);
+                lane->pending.reset();
+            }
+        }
+
+        return insertBatch(*lanes.front(), std::move(cells));
     });
 
     std::unique_ptr<PooledPointTable> table(
@@ -342,7 +435,8 @@ void Builder::insertPath(const Origin origin, FileInfo& info)
                 *m_pointPool,
                 inserter,
                 m_metadata->delta(),
-                origin));
+                origin,
+                m_pipelinedInput));
 
     if (!Executor::get().run(
                 *table,
@@ -353,6 +447,75 @@ void Builder::insertPath(const Origin origin, FileInfo& info)
     {
         throw std::runtime_error("Failed to execute: " + rawPath);
     }
+
+    table->flush();
+
+    // Any batch not yet picked up by a worker is inserted here.
+    for (auto& lane : lanes)
+    {
+        drain(*lane);
+        if (!lane->error.empty()) throw std::runtime_error(lane->error);
+    }
+}
+
+Cell::PooledStack Builder::insertBatch(Lane& lane, Cell::PooledStack cells)
+{
+    lane.inserted += cells.size();
+
+    if (lane.inserted > heuristics::sleepCount)
+    {
+        lane.inserted = 0;
+        const float available(m_pointPool->dataPool().available());
+        const float allocated(m_pointPool->dataPool().allocated());
+        if (available / allocated < 0.5) lane.clipper.clip();
+    }
+
+    Cell::PooledStack rejected(
+            insertData(
+                std::move(cells),
+                lane.origin,
+                lane.clipper,
+                lane.climber));
+
+    if (m_memoryBudget)
+    {
+        m_memoryBudget->apply();
+
+        if (lane.epoch != m_memoryBudget->epoch())
+        {
+            lane.epoch = m_memoryBudget->epoch();
+            lane.clipper.evict();
+            m_registry->cold().shed(0, false);
+        }
+
+        // Our reader's table is not refilled until we return, so this is
+        // where back-pressure is applied to it.
+        m_memoryBudget->throttle();
+    }
+
+    return rejected;
+}
+
+void Builder::drain(Lane& lane)
+{
+    std::lock_guard<std::mutex> lock(lane.mutex);
+    if (!lane.pending) return;
+
+    Cell::PooledStack cells(std::move(*lane.pending));
+    lane.pending.reset();
+
+    try
+    {
+        m_pointPool->release(insertBatch(lane, std::move(cells)));
+    }
+    catch (const std::exception& e)
+    {
+        lane.error = e.what();
+    }
+    catch (...)
+    {
+        lane.error = "Unknown error";
+    }
 }
 
 Cell::PooledStack Builder::insertData(
@@ -373,17 +536,34 @@ Cell::PooledStack Builder::insertData(
     const auto boundsSubset(m_metadata->boundsScaledSubset());
     const std::size_t baseDepthBegin(m_metadata->structure().baseDepthBegin());
 
-    while (!cells.empty())
+    // When sorted, consecutive points will typically fall within the same
+    // node at the base depth, so we can jump directly there from the position
+    // of the previous point rather than climbing from the root.
+    std::unique_ptr<Climber::Position> position;
+
+    auto insert([&](Cell::PooledNode& cell)
     {
-        Cell::PooledNode cell(cells.popOne());
         const Point& point(cell->point());
 
         if (boundsConforming.contains(point))
         {
             if (!boundsSubset || boundsSubset->contains(point))
             {
-                climber.reset();
-                climber.magnifyTo(point, baseDepthBegin);
+                if (position && position->contains(point))
+                {
+                    climber.jump(*position);
+                }
+                else
+                {
+                    climber.reset();
+                    climber.magnifyTo(point, baseDepthBegin);
+
+                    if (m_sortedInsertion)
+                    {
+                        position = makeUnique<Climber::Position>(
+                                climber.position());
+                    }
+                }
 
                 if (m_registry->addPoint(cell, climber, clipper))
                 {
@@ -405,6 +585,40 @@ Cell::PooledStack Builder::insertData(
             reject(cell);
             pointStats.addOutOfBounds();
         }
+    });
+
+    if (m_sortedInsertion)
+    {
+        const Bounds& bounds(m_metadata->boundsScaledCubic());
+
+        std::vector<std::pair<uint64_t, Cell::PooledNode>> sorted;
+        sorted.reserve(cells.size());
+
+        while (!cells.empty())
+        {
+            Cell::PooledNode cell(cells.popOne());
+            const uint64_t key(morton::key(cell->point(), bounds));
+            sorted.emplace_back(key, std::move(cell));
+        }
+
+        std::sort(
+                sorted.begin(),
+                sorted.end(),
+                [](const std::pair<uint64_t, Cell::PooledNode>& a,
+                    const std::pair<uint64_t, Cell::PooledNode>& b)
+                {
+                    return a.first < b.first;
+                });
+
+        for (auto& entry : sorted) insert(entry.second);
+    }
+    else
+    {
+        while (!cells.empty())
+        {
+            Cell::PooledNode cell(cells.popOne());
+            insert(cell);
+        }
     }
 
     if (origin != invalidOrigin) m_metadata->manifest().add(origin, pointStats);
@@ -425,12 +639,62 @@ void Builder::save(const arbiter::Endpoint& ep)
 {
     m_threadPools->cycle();
 
+    // Chunks held resident after their release, or cooled after that, must
+    // be written out before the hierarchy, which they may still need to count
+    // into.
+    m_registry->cold().shed(0, false);
+    m_threadPools->clipPool().await();
+
+    m_registry->cold().age(0, false);
+    m_threadPools->clipPool().await();
+
+    if (m_serializer)
+    {
+        if (verbose()) std::cout << "Flushing chunk writes..." << std::endl;
+        m_serializer->flush();
+
+        if (verbose())
+        {
+            using ms = std::chrono::milliseconds;
+            const Serializer::Stage c(m_serializer->compressStage());
+            const Serializer::Stage u(m_serializer->uploadStage());
+
+            std::cout <<
+                "\tCompressed: " << commify(c.done) << " chunks, " <<
+                    std::chrono::duration_cast<ms>(c.latency).count() <<
+                    "ms mean latency\n" <<
+                "\tUploaded: " << commify(u.done) << " chunks, " <<
+                    std::chrono::duration_cast<ms>(u.latency).count() <<
+                    "ms mean latency" << std::endl;
+        }
+    }
+
+    if (m_deferHierarchy)
+    {
+        // Every other chunk has been counted as it was saved, but the base is
+        // not saved until after the hierarchy.
+        if (Chunk* base = m_registry->cold().base()) base->countHierarchy(1);
+    }
+
     if (verbose()) std::cout << "Saving hierarchy..." << std::endl;
     m_hierarchy->save(m_threadPools->clipPool());
 
+    if (Packs* packs = m_metadata->storage().packs())
+    {
+        packs->stage(*m_tmpEndpoint);
+    }
+
     if (verbose()) std::cout << "Saving registry..." << std::endl;
     m_registry->save(*m_outEndpoint);
 
+    // The registry writes out the base chunk, which is packed along with the
+    // others.
+    if (Packs* packs = m_metadata->storage().packs())
+    {
+        if (verbose()) std::cout << "Saving packs..." << std::endl;
+        packs->save(*m_outEndpoint);
+    }
+
     if (verbose()) std::cout << "Saving metadata..." << std::endl;
     m_metadata->save(*m_outEndpoint);
 }
@@ -508,11 +772,57 @@ const Hierarchy& Builder::hierarchy() const         { return *m_hierarchy; }
 const arbiter::Arbiter& Builder::arbiter() const    { return *m_arbiter; }
 arbiter::Arbiter& Builder::arbiter() { return *m_arbiter; }
 
-Sequence& Builder::sequence() { return *m_sequence; }
-const Sequence& Builder::sequence() const { return *m_sequence; }
+Sequence& Builder::sequence()
+{
+    if (!m_sequence) m_sequence = makeUnique<Sequence>(*this);
+    return *m_sequence;
+}
 
 ThreadPools& Builder::threadPools() const { return *m_threadPools; }
 
+bool Builder::adaptiveThreads() const { return m_threadPools->adaptive(); }
+
+void Builder::adaptiveThreads(const bool v)
+{
+    m_threadPools->adapt(v ? m_pointPool : nullptr);
+}
+
+std::size_t Builder::memoryBudget() const
+{
+    return m_memoryBudget ? m_memoryBudget->bytes() : 0;
+}
+
+void Builder::memoryBudget(const std::size_t bytes)
+{
+    if (bytes)
+    {
+        m_memoryBudget = makeUnique<MemoryBudget>(
+                bytes,
+                *m_pointPool,
+                *m_hierarchyPool,
+                cooler());
+    }
+    else
+    {
+        m_memoryBudget.reset();
+    }
+}
+
+std::size_t Builder::chunkSaves() const
+{
+    return m_registry->cold().residency().saves();
+}
+
+std::size_t Builder::chunkReloads() const
+{
+    return m_registry->cold().residency().reloads();
+}
+
+const Cooler& Builder::cooler() const
+{
+    return m_registry->cold().cooler();
+}
+
 PointPool& Builder::pointPool() const { return *m_pointPool; }
 std::shared_ptr<PointPool> Builder::sharedPointPool() const
 {
@@ -529,10 +839,28 @@ const arbiter::Endpoint& Builder::tmpEndpoint() const { return *m_tmpEndpoint; }
 
 std::mutex& Builder::mutex() { return m_mutex; }
 
+std::size_t Builder::packChunks() const
+{
+    const Packs* packs(m_metadata->storage().packs());
+    return packs ? packs->chunksPerPack() : 0;
+}
+
+void Builder::packChunks(const std::size_t chunks)
+{
+    if (!chunks || m_isContinuation) return;
+
+    if (m_metadata->subset())
+    {
+        throw std::runtime_error("Subset builds cannot be packed");
+    }
+
+    m_metadata->storage().pack(chunks);
+}
+
 void Builder::append(const FileInfoList& fileInfo)
 {
     m_metadata->manifest().append(fileInfo);
-    m_sequence = makeUnique<Sequence>(*this);
+    m_sequence.reset();
 }
 
 void Builder::clip(
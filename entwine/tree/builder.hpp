@@ -44,20 +44,25 @@ namespace arbiter
 
 class Bounds;
 class Clipper;
+class Cooler;
 class Executor;
 class FileInfo;
+class MemoryBudget;
 class Metadata;
 class Pool;
+class Prefetcher;
 class Registry;
 class Reprojection;
 class Schema;
 class Sequence;
+class Serializer;
 class Structure;
 class Subset;
 class ThreadPools;
 
 class Builder
 {
+    friend class Chunk;
     friend class Clipper;
     friend class Merger;
     friend class Sequence;
@@ -97,7 +102,9 @@ public:
     ThreadPools& threadPools() const;
     arbiter::Arbiter& arbiter();
     const arbiter::Arbiter& arbiter() const;
-    const Sequence& sequence() const;
+
+    // Created on first use, so it is ordered by our final configuration and
+    // manifest.
     Sequence& sequence();
 
     PointPool& pointPool() const;
@@ -118,6 +125,88 @@ public:
     bool verbose() const { return m_verbose; }
     void verbose(bool v) { m_verbose = v; }
 
+    // If set, each batch of points is sorted in Morton order before being
+    // inserted, so consecutive insertions share their paths through the tree.
+    bool sortedInsertion() const { return m_sortedInsertion; }
+    void sortedInsertion(bool v) { m_sortedInsertion = v; }
+
+    // If set, points are not counted into the hierarchy as they are inserted.
+    // Instead, each chunk counts its resident points as it is saved.
+    bool deferHierarchy() const { return m_deferHierarchy; }
+    void deferHierarchy(bool v) { m_deferHierarchy = v; }
+
+    // If set, each file's points are inserted on a thread of their own while
+    // the next batch of them is read - see PooledPointTable.
+    bool pipelinedInput() const { return m_pipelinedInput; }
+    void pipelinedInput(bool v) { m_pipelinedInput = v; }
+
+    // If set, threads move between the work and clip pools as the build
+    // progresses, rather than keeping the split given at construction.
+    bool adaptiveThreads() const;
+    void adaptiveThreads(bool v);
+
+    // If non-zero, the approximate number of bytes the build may hold in
+    // points, hierarchy nodes, and chunks before inserting threads are slowed
+    // down and made to release their chunks.
+    std::size_t memoryBudget() const;
+    void memoryBudget(std::size_t bytes);
+
+    // If non-zero, chunks released by every origin stay resident, up to
+    // about this many bytes of them, rather than being serialized at once.
+    std::size_t chunkCache() const { return m_chunkCache; }
+    void chunkCache(std::size_t bytes) { m_chunkCache = bytes; }
+
+    // If non-zero, chunks evicted from memory are packed and kept, up to
+    // about this many bytes of them, rather than written out at once.  They
+    // are written when they age out of this budget or when we are saved.
+    std::size_t coolingBudget() const { return m_coolingBudget; }
+    void coolingBudget(std::size_t bytes) { m_coolingBudget = bytes; }
+
+    // The policy by which input files are ordered for insertion - see
+    // Sequence.  If empty, that of a previous run is continued.
+    const std::string& scheduling() const { return m_scheduling; }
+    void scheduling(const std::string& s) { m_scheduling = s; }
+
+    // If non-zero, files of at least this many points are inserted by up to
+    // one lane per work thread, for each multiple of it, rather than by a
+    // single thread.
+    std::size_t splitThreshold() const { return m_splitThreshold; }
+    void splitThreshold(std::size_t points) { m_splitThreshold = points; }
+
+    // The number of remote inputs to download ahead of those being inserted,
+    // and if non-zero, the bytes of downloaded inputs past which no more are
+    // fetched until some have been inserted.
+    std::size_t prefetch() const { return m_prefetch; }
+    void prefetch(std::size_t files) { m_prefetch = files; }
+    std::size_t prefetchBudget() const { return m_prefetchBudget; }
+    void prefetchBudget(std::size_t bytes) { m_prefetchBudget = bytes; }
+
+    // If uploadThreads is non-zero, chunks are written out in stages - see
+    // Serializer - with compression on compressThreads threads, or as many as
+    // the clip pool has if that is zero, and uploads on uploadThreads.
+    std::size_t compressThreads() const { return m_compressThreads; }
+    void compressThreads(std::size_t n) { m_compressThreads = n; }
+    std::size_t uploadThreads() const { return m_uploadThreads; }
+    void uploadThreads(std::size_t n) { m_uploadThreads = n; }
+
+    // If non-zero, chunks are written into pack files of about this many
+    // chunks each, rather than each to its own file - see Packs.  The layout
+    // of a build is fixed when it is created, so this is ignored when one is
+    // continued.
+    std::size_t packChunks() const;
+    void packChunks(std::size_t chunks);
+
+    // Null unless chunks are being written out in stages.
+    Serializer* serializer() const { return m_serializer.get(); }
+
+    // Counts of chunks serialized so far, and of serialized chunks which
+    // have been loaded back for insertion.
+    std::size_t chunkSaves() const;
+    std::size_t chunkReloads() const;
+
+    // The tier of evicted chunks held packed under our cooling budget.
+    const Cooler& cooler() const;
+
     static std::unique_ptr<Builder> tryCreateExisting(
             std::string path,
             std::string tmp,
@@ -142,6 +231,16 @@ private:
     // based on file contents.
     void insertPath(Origin origin, FileInfo& info);
 
+    // The state with which one thread at a time inserts batches from a file.
+    struct Lane;
+
+    // Insert a batch from a lane, applying any memory pressure.  Returns a
+    // stack of rejected info nodes so that they may be reused.
+    Cell::PooledStack insertBatch(Lane& lane, Cell::PooledStack cells);
+
+    // Insert the batch pending for this lane, if there is one.
+    void drain(Lane& lane);
+
     // Returns a stack of rejected info nodes so that they may be reused.
     Cell::PooledStack insertData(
             Cell::PooledStack cells,
@@ -179,10 +278,24 @@ private:
     mutable std::shared_ptr<HierarchyCell::Pool> m_hierarchyPool;
 
     std::unique_ptr<Hierarchy> m_hierarchy;
+    std::unique_ptr<MemoryBudget> m_memoryBudget;
     std::unique_ptr<Sequence> m_sequence;
+    std::unique_ptr<Prefetcher> m_prefetcher;
     std::unique_ptr<Registry> m_registry;
+    std::unique_ptr<Serializer> m_serializer;
 
     bool m_verbose = false;
+    bool m_sortedInsertion = false;
+    bool m_deferHierarchy = false;
+    bool m_pipelinedInput = false;
+    std::size_t m_chunkCache = 0;
+    std::size_t m_coolingBudget = 0;
+    std::string m_scheduling;
+    std::size_t m_splitThreshold = 0;
+    std::size_t m_prefetch = 0;
+    std::size_t m_prefetchBudget = 0;
+    std::size_t m_compressThreads = 0;
+    std::size_t m_uploadThreads = 0;
 
     TimePoint m_start;
 
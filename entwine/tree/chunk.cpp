@@ -10,8 +10,10 @@
 
 #include <entwine/tree/chunk.hpp>
 
+#include <algorithm>
 #include <atomic>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 
 #include <pdal/Dimension.hpp>
@@ -22,6 +24,9 @@
 #include <entwine/formats/cesium/tile-builder.hpp>
 #include <entwine/third/arbiter/arbiter.hpp>
 #include <entwine/tree/builder.hpp>
+#include <entwine/tree/cooler.hpp>
+#include <entwine/tree/hierarchy.hpp>
+#include <entwine/tree/serializer.hpp>
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/storage.hpp>
 #include <entwine/types/metadata.hpp>
@@ -38,6 +43,20 @@ namespace entwine
 namespace
 {
     std::atomic_size_t chunkCount(0);
+
+    template<typename T> void append(std::vector<char>& data, const T v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        data.insert(data.end(), pos, pos + sizeof(T));
+    }
+
+    template<typename T> T extract(const char*& pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        pos += sizeof(T);
+        return v;
+    }
 }
 
 std::size_t Chunk::count() { return chunkCount; }
@@ -56,6 +75,9 @@ Chunk::Chunk(
     , m_zDepth(std::min(Tube::maxTickDepth(), depth))
     , m_id(id)
     , m_maxPoints(maxPoints)
+#ifdef ENTWINE_SLAB_TUBE
+    , m_slab(m_pointPool.schema())
+#endif
 {
     ++chunkCount;
 }
@@ -73,11 +95,264 @@ void Chunk::populate(Cell::PooledStack cells)
 
         insert(climber, cell);
     }
+
+    // These points were counted when they were saved, and will be counted
+    // again when we are.
+    countHierarchy(-1);
 }
 
 void Chunk::save()
 {
-    storage().serialize(*this);
+    countHierarchy(1);
+
+    if (Serializer* serializer = m_builder.serializer())
+    {
+        serializer->save(*this);
+    }
+    else
+    {
+        storage().serialize(*this);
+    }
+}
+
+void Chunk::countHierarchy(const int sign)
+{
+    if (!m_builder.deferHierarchy()) return;
+
+    CellCounts cells;
+
+    forEachTube([&](const Id& index, const Tube& tube)
+    {
+        if (tube.empty()) return;
+
+        cells.clear();
+        for (const auto& cellPair : tube)
+        {
+            cells.emplace_back(cellPair.first, size(cellPair));
+        }
+
+        countTube(m_builder, index, cells, sign);
+    });
+}
+
+void Chunk::countTube(
+        const Builder& builder,
+        const Id& index,
+        const CellCounts& cells,
+        const int sign)
+{
+    Hierarchy& hierarchy(*builder.m_hierarchy);
+    const Metadata& metadata(builder.metadata());
+    const Structure& structure(metadata.structure());
+    const Structure& hierarchyStructure(metadata.hierarchyStructure());
+
+    // The hierarchy climb only begins to subdivide past its start depth, so
+    // the points of a tube are counted in its ancestor that many depths up,
+    // at the tick made of the leading bits of their own.
+    const std::size_t up(
+            hierarchyStructure.startDepth() - structure.startDepth());
+    const std::size_t dimensions(structure.dimensions());
+    const std::size_t maxTickDepth(Tube::maxTickDepth());
+
+    const std::size_t depth(ChunkInfo::calcDepth(structure.factor(), index));
+    if (depth < up) return;
+
+    Id ancestor(index);
+    for (std::size_t i(0); i < up; ++i)
+    {
+        --ancestor;
+        ancestor >>= dimensions;
+    }
+
+    const ChunkInfo chunkInfo(hierarchyStructure, ancestor);
+    const std::size_t shift(
+            std::min(depth, maxTickDepth) -
+            std::min(depth - up, maxTickDepth));
+
+    for (const auto& cell : cells)
+    {
+        hierarchy.count(
+                chunkInfo,
+                cell.first >> shift,
+                sign * static_cast<int>(cell.second));
+    }
+}
+
+std::size_t Chunk::numPoints() const
+{
+    std::size_t points(0);
+
+    forEachTube([&](const Id&, const Tube& tube)
+    {
+        for (const auto& cellPair : tube) points += size(cellPair);
+    });
+
+    return points;
+}
+
+// Each non-empty tube is packed as its index, relative to our own, followed by
+// its cells, each of which is its tick followed by its points:
+//
+//      [blocks: u64][index: u64 * blocks][cells: u64]
+//          [tick: u64][points: u64][point data: pointSize * points]...
+std::vector<char> Chunk::pack() const
+{
+    const std::size_t pointSize(schema().pointSize());
+    std::vector<char> data;
+
+    forEachTube([&](const Id& index, const Tube& tube)
+    {
+        if (tube.empty()) return;
+
+        const Id local(index - m_id);
+        const auto& blocks(local.data());
+        const char* pos(reinterpret_cast<const char*>(blocks.data()));
+
+        append<uint64_t>(data, blocks.size());
+        data.insert(data.end(), pos, pos + blocks.size() * sizeof(Id::Block));
+
+        uint64_t cells(0);
+        for (auto it(tube.begin()); it != tube.end(); ++it) ++cells;
+        append<uint64_t>(data, cells);
+
+        for (const auto& cellPair : tube)
+        {
+            append<uint64_t>(data, cellPair.first);
+
+            visit(cellPair, [&](const Cell& cell)
+            {
+                append<uint64_t>(data, cell.size());
+                for (const char* d : cell)
+                {
+                    data.insert(data.end(), d, d + pointSize);
+                }
+            });
+        }
+    });
+
+    return data;
+}
+
+void Chunk::unpack(const std::vector<char>& data)
+{
+    const std::size_t pointSize(schema().pointSize());
+    BinaryPointTable table(schema());
+
+    const char* pos(data.data());
+    const char* end(data.data() + data.size());
+
+    while (pos < end)
+    {
+        const uint64_t blocks(extract<uint64_t>(pos));
+        const char* indexEnd(pos + blocks * sizeof(Id::Block));
+        const Id index(m_id + Id(pos, indexEnd));
+        pos = indexEnd;
+
+        Tube& tube(getTube(index));
+
+        const uint64_t cells(extract<uint64_t>(pos));
+        for (uint64_t c(0); c < cells; ++c)
+        {
+            const uint64_t tick(extract<uint64_t>(pos));
+            const uint64_t points(extract<uint64_t>(pos));
+
+            Cell::PooledNode cell(m_pointPool.cellPool().acquireOne());
+            Data::PooledStack dataStack(m_pointPool.dataPool().acquire(points));
+
+            // Pushing reverses the order of a cell's points, so push them
+            // from the back to restore the order in which they were packed.
+            for (uint64_t p(points); p-- > 0; )
+            {
+                const char* point(pos + p * pointSize);
+
+                Data::PooledNode dataNode(dataStack.popOne());
+                std::copy(point, point + pointSize, *dataNode);
+
+                if (cell->empty())
+                {
+                    table.setPoint(point);
+                    cell->set(table.ref(), std::move(dataNode));
+                }
+                else
+                {
+                    cell->push(std::move(dataNode));
+                }
+            }
+
+            pos += points * pointSize;
+
+            // These ticks are unique within the tube, so this insertion never
+            // has to be resolved against a resident.
+#ifdef ENTWINE_SLAB_TUBE
+            tube.insert(tick, cell->point(), cell, m_slab, m_pointPool);
+#else
+            tube.insert(tick, cell->point(), pointSize, cell);
+#endif
+        }
+    }
+}
+
+bool Chunk::save(
+        const Builder& builder,
+        const Id& id,
+        const CooledChunk& cooled)
+{
+    const Metadata& metadata(builder.metadata());
+    const Storage& storage(metadata.storage());
+
+    // Tiles are built from resident points, and storage types which are not
+    // pipelined can only write a chunk.
+    if (metadata.cesiumSettings() || !storage.pipelined()) return false;
+
+    const std::size_t pointSize(metadata.schema().pointSize());
+    const bool deferred(builder.deferHierarchy());
+
+    std::vector<char> points;
+    points.reserve(cooled.data.size());
+    CellCounts cells;
+
+    const char* pos(cooled.data.data());
+    const char* end(cooled.data.data() + cooled.data.size());
+
+    // Walk the layout of pack(), copying out the points of each cell in
+    // order, and counting them into the hierarchy as save() would have.
+    while (pos < end)
+    {
+        const uint64_t blocks(extract<uint64_t>(pos));
+        const char* indexEnd(pos + blocks * sizeof(Id::Block));
+        const Id index(id + Id(pos, indexEnd));
+        pos = indexEnd;
+
+        cells.clear();
+
+        const uint64_t numCells(extract<uint64_t>(pos));
+        for (uint64_t c(0); c < numCells; ++c)
+        {
+            const uint64_t tick(extract<uint64_t>(pos));
+            const uint64_t numPoints(extract<uint64_t>(pos));
+
+            points.insert(points.end(), pos, pos + numPoints * pointSize);
+            pos += numPoints * pointSize;
+
+            cells.emplace_back(tick, numPoints);
+        }
+
+        if (deferred) countTube(builder, index, cells, 1);
+    }
+
+    std::unique_ptr<PackedChunk> packed(
+            storage.pack(id, cooled.type, cooled.bounds, std::move(points)));
+
+    if (Serializer* serializer = builder.serializer())
+    {
+        serializer->save(std::move(packed));
+    }
+    else
+    {
+        storage.upload(builder.outEndpoint(), id, storage.encode(*packed));
+    }
+
+    return true;
 }
 
 Chunk::~Chunk()
@@ -146,15 +421,10 @@ Cell::PooledStack SparseChunk::acquire()
 {
     Cell::PooledStack cells(m_pointPool.cellPool());
 
-    for (auto& outer : m_tubes)
+    m_tubes.forEach([this, &cells](const Id&, Tube& tube)
     {
-        Tube& tube(outer.second);
-
-        for (auto& inner : tube)
-        {
-            cells.push(std::move(inner.second));
-        }
-    }
+        for (auto& inner : tube) cells.push(take(inner));
+    });
 
     return cells;
 }
@@ -165,15 +435,15 @@ cesium::TileInfo SparseChunk::info() const
     std::size_t cur(0);
     const std::size_t div(divisor());
 
-    for (const auto& tubePair : m_tubes)
+    m_tubes.forEach([&](const Id&, const Tube& tube)
     {
-        for (const auto& cellPair : tubePair.second)
+        for (const auto& cellPair : tube)
         {
             cur = cellPair.first / div;
-            if (ticks.count(cur)) ticks[cur] += cellPair.second->size();
-            else ticks[cur] = cellPair.second->size();
+            if (ticks.count(cur)) ticks[cur] += size(cellPair);
+            else ticks[cur] = size(cellPair);
         }
-    }
+    });
 
     Bounds b(m_bounds);
     if (const auto d = m_metadata.delta())
@@ -190,13 +460,16 @@ void SparseChunk::tile() const
     const auto endpoint(m_builder.outEndpoint().getSubEndpoint("cesium"));
     cesium::TileBuilder tileBuilder(m_metadata, tileInfo);
 
-    for (const auto& tubePair : m_tubes)
+    m_tubes.forEach([this, &tileBuilder](const Id&, const Tube& tube)
     {
-        for (const auto& cellPair : tubePair.second)
+        for (const auto& cellPair : tube)
         {
-            tileBuilder.push(cellPair.first, *cellPair.second);
+            visit(cellPair, [&](const Cell& cell)
+            {
+                tileBuilder.push(cellPair.first, cell);
+            });
         }
-    }
+    });
 
     for (const auto& tilePair : tileBuilder.data())
     {
@@ -212,6 +485,14 @@ void SparseChunk::tile() const
     }
 }
 
+void SparseChunk::forEachTube(const TubeFunction& f) const
+{
+    m_tubes.forEach([this, &f](const Id& id, const Tube& tube)
+    {
+        f(m_id + id, tube);
+    });
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 ContiguousChunk::ContiguousChunk(
@@ -238,10 +519,10 @@ Cell::PooledStack ContiguousChunk::acquire()
 {
     Cell::PooledStack cells(m_pointPool.cellPool());
 
-    for (Tube& tube : m_tubes)
+    m_tubes.forEach([this, &cells](Tube& tube)
     {
-        for (auto& inner : tube) cells.push(std::move(inner.second));
-    }
+        for (auto& inner : tube) cells.push(take(inner));
+    });
 
     return cells;
 }
@@ -253,15 +534,15 @@ cesium::TileInfo ContiguousChunk::info() const
     const std::size_t div(divisor());
     const bool inBase(m_depth < m_metadata.structure().coldDepthBegin());
 
-    for (const auto& tube : m_tubes)
+    m_tubes.forEach([&](const Tube& tube)
     {
         for (const auto& cellPair : tube)
         {
             if (!inBase) cur = cellPair.first / div;
-            if (ticks.count(cur)) ticks[cur] += cellPair.second->size();
-            else ticks[cur] = cellPair.second->size();
+            if (ticks.count(cur)) ticks[cur] += size(cellPair);
+            else ticks[cur] = size(cellPair);
         }
-    }
+    });
 
     Bounds b(m_bounds);
     if (const auto d = m_metadata.delta())
@@ -279,13 +560,16 @@ void ContiguousChunk::tile() const
     const bool inBase(m_depth < m_metadata.structure().coldDepthBegin());
     cesium::TileBuilder tileBuilder(m_metadata, tileInfo);
 
-    for (const auto& tube : m_tubes)
+    m_tubes.forEach([&](const Tube& tube)
     {
         for (const auto& cellPair : tube)
         {
-            tileBuilder.push(inBase ? 0 : cellPair.first, *cellPair.second);
+            visit(cellPair, [&](const Cell& cell)
+            {
+                tileBuilder.push(inBase ? 0 : cellPair.first, cell);
+            });
         }
-    }
+    });
 
     for (const auto& tilePair : tileBuilder.data())
     {
@@ -301,6 +585,14 @@ void ContiguousChunk::tile() const
     }
 }
 
+void ContiguousChunk::forEachTube(const TubeFunction& f) const
+{
+    m_tubes.forEachIndexed([this, &f](std::size_t i, const Tube& tube)
+    {
+        f(m_id + i, tube);
+    });
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 cesium::TileInfo BaseChunk::info() const
@@ -406,6 +698,15 @@ BaseChunk::BaseChunk(const Builder& builder, const bool exists)
     chunkCount = 1;
 }
 
+void BaseChunk::countHierarchy(const int sign)
+{
+    const auto& s(m_metadata.structure());
+    for (std::size_t d(s.baseDepthBegin()); d < m_chunks.size(); ++d)
+    {
+        m_chunks[d].countHierarchy(sign);
+    }
+}
+
 void BaseChunk::save()
 {
     const auto& s(m_metadata.structure());
@@ -12,9 +12,11 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <utility>
 #include <vector>
 
 #include <pdal/PointTable.hpp>
@@ -24,8 +26,11 @@
 #include <entwine/tree/climber.hpp>
 #include <entwine/types/dim-info.hpp>
 #include <entwine/types/point.hpp>
+#include <entwine/types/point-slab.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/tube.hpp>
+#include <entwine/types/tube-map.hpp>
+#include <entwine/types/tube-pages.hpp>
 
 namespace entwine
 {
@@ -33,6 +38,8 @@ namespace entwine
 namespace arbiter { class Endpoint; }
 
 class Builder;
+class Hierarchy;
+struct CooledChunk;
 class Metadata;
 class Unpacker;
 
@@ -68,6 +75,7 @@ public:
     const Metadata& metadata() const { return m_metadata; }
     const Storage& storage() const { return m_metadata.storage(); }
     const Bounds& bounds() const { return m_bounds; }
+    std::size_t depth() const { return m_depth; }
 
     virtual void save();
 
@@ -79,17 +87,95 @@ public:
 
     Tube::Insertion insert(const Climber& climber, Cell::PooledNode& cell)
     {
+#ifdef ENTWINE_SLAB_TUBE
+        return getTube(climber).insert(
+                climber,
+                cell,
+                getSlab(climber),
+                m_pointPool);
+#else
         return getTube(climber).insert(climber, cell);
+#endif
     }
 
+#ifdef ENTWINE_SLAB_TUBE
+    const PointSlab& slab() const { return m_slab; }
+#endif
+
     static std::size_t count();
 
     virtual cesium::TileInfo info() const = 0;
 
+    // For builds which defer hierarchy construction, count our resident
+    // points into the hierarchy, or with a negative sign, remove them.
+    virtual void countHierarchy(int sign);
+
+    // Number of points resident in this chunk.  Not valid for the base.
+    std::size_t numPoints() const;
+
+    // Pack our resident points, along with the tube index and tick of each
+    // cell, into a flat buffer.  A new empty chunk with our bounds may then be
+    // restored from it by unpack() without climbing the tree for any point.
+    // Not valid for the base.
+    std::vector<char> pack() const;
+    void unpack(const std::vector<char>& data);
+
+    // Save a chunk straight from the packed points of its cooled state, as
+    // save() would have saved the chunk itself, without unpacking it.  If our
+    // storage cannot do so, nothing is done and false is returned, in which
+    // case the chunk must be thawed to be saved.
+    static bool save(
+            const Builder& builder,
+            const Id& id,
+            const CooledChunk& cooled);
+
 protected:
     virtual void populate(Cell::PooledStack cells);
 
+    using TubeFunction = std::function<void(const Id& index, const Tube&)>;
+
+    // Call f with the global index of each of our tubes.
+    virtual void forEachTube(const TubeFunction& f) const = 0;
+
     virtual Tube& getTube(const Climber& climber) = 0;
+    virtual Tube& getTube(const Id& index) = 0;
+
+#ifdef ENTWINE_SLAB_TUBE
+    virtual PointSlab& getSlab(const Climber& climber) { return m_slab; }
+#endif
+
+    // Number of points resident in a tube entry.
+    template<typename Entry> std::size_t size(const Entry& entry) const
+    {
+#ifdef ENTWINE_SLAB_TUBE
+        return m_slab.chainSize(entry.second);
+#else
+        return entry.second->size();
+#endif
+    }
+
+    // Take the resident points of a tube entry as a cell.
+    template<typename Entry> Cell::PooledNode take(Entry& entry)
+    {
+#ifdef ENTWINE_SLAB_TUBE
+        return m_slab.load(entry.second, m_pointPool);
+#else
+        return std::move(entry.second);
+#endif
+    }
+
+    // Call f(const Cell&) with the resident points of a tube entry.
+    template<typename Entry, typename F>
+    void visit(const Entry& entry, F f) const
+    {
+#ifdef ENTWINE_SLAB_TUBE
+        Cell::PooledNode cell(m_slab.load(entry.second, m_pointPool));
+        f(*cell);
+        m_pointPool.release(std::move(cell));
+#else
+        f(*entry.second);
+#endif
+    }
 
     std::size_t divisor() const
     {
@@ -107,6 +193,16 @@ protected:
 
     Id endId() const { return m_id + m_maxPoints; }
 
+    // The offset of a fixed climber's index within this chunk, which skips
+    // the synchronization of its Id indices.  Since our ID is no greater than
+    // the climber's index, it fits as well.
+    FixedId fixedOffset(const Climber& climber) const
+    {
+        const FixedId begin(IdTraits<FixedId>::from(m_id));
+        assert(climber.fixedIndex() >= begin);
+        return climber.fixedIndex() - begin;
+    }
+
     virtual void tile() const { }
 
     const Builder& m_builder;
@@ -119,6 +215,21 @@ protected:
     Id m_id;
 
     Id m_maxPoints;
+
+#ifdef ENTWINE_SLAB_TUBE
+    PointSlab m_slab;
+#endif
+
+private:
+    // The number of points in each cell of a tube, by tick.
+    using CellCounts = std::vector<std::pair<uint64_t, std::size_t>>;
+
+    // Count the cells of the tube at this global index into the hierarchy.
+    static void countTube(
+            const Builder& builder,
+            const Id& index,
+            const CellCounts& cells,
+            int sign);
 };
 
 class SparseChunk : public Chunk
@@ -141,13 +252,21 @@ private:
     virtual Cell::PooledStack acquire() override;
 
     virtual void tile() const override;
+    virtual void forEachTube(const TubeFunction& f) const override;
 
     virtual Tube& getTube(const Climber& climber) override
     {
-        const Id norm(normalize(climber.index()));
+        if (climber.fixed())
+        {
+            return m_tubes.get(
+                    IdTraits<FixedId>::toId(fixedOffset(climber)));
+        }
+        else return getTube(climber.index());
+    }
 
-        std::lock_guard<std::mutex> lock(m_mutex);
-        return m_tubes[norm];
+    virtual Tube& getTube(const Id& index) override
+    {
+        return m_tubes.get(normalize(index));
     }
 
     Id normalize(const Id& rawIndex) const
@@ -158,8 +277,7 @@ private:
         return rawIndex - m_id;
     }
 
-    std::map<Id, Tube> m_tubes;
-    std::mutex m_mutex;
+    TubeMap m_tubes;
 };
 
 class ContiguousChunk : public Chunk
@@ -181,23 +299,26 @@ public:
 
     virtual cesium::TileInfo info() const override;
 
-    bool empty() const
-    {
-        for (const auto& tube : m_tubes)
-        {
-            if (!tube.empty()) return false;
-        }
-        return true;
-    }
+    bool empty() const { return m_tubes.empty(); }
 
 protected:
     virtual Cell::PooledStack acquire() override;
 
     virtual void tile() const override;
+    virtual void forEachTube(const TubeFunction& f) const override;
 
     virtual Tube& getTube(const Climber& climber) override
     {
-        return m_tubes.at(normalize(climber.index()));
+        if (climber.fixed())
+        {
+            return m_tubes.at(static_cast<std::size_t>(fixedOffset(climber)));
+        }
+        else return getTube(climber.index());
+    }
+
+    virtual Tube& getTube(const Id& index) override
+    {
+        return m_tubes.at(normalize(index));
     }
 
     std::size_t normalize(const Id& rawIndex) const
@@ -210,10 +331,19 @@ protected:
 
     void append(ContiguousChunk& other)
     {
-        m_tubes.insert(
-                m_tubes.end(),
-                std::make_move_iterator(other.m_tubes.begin()),
-                std::make_move_iterator(other.m_tubes.end()));
+#ifdef ENTWINE_SLAB_TUBE
+        // Offsets are local to their slab, so rebase them onto our own.
+        other.m_tubes.forEach([this, &other](Tube& tube)
+        {
+            for (auto& entry : tube)
+            {
+                entry.second = m_slab.copy(other.m_slab, entry.second);
+            }
+        });
+        other.m_slab.clear();
+#endif
+
+        m_tubes.append(other.m_tubes);
 
         m_maxPoints += other.maxPoints();
     }
@@ -223,9 +353,12 @@ protected:
         m_id = endId();
         m_tubes.clear();
         m_maxPoints = 0;
+#ifdef ENTWINE_SLAB_TUBE
+        m_slab.clear();
+#endif
     }
 
-    std::vector<Tube> m_tubes;
+    TubePages m_tubes;
 };
 
 class BaseChunk : public Chunk
@@ -240,6 +373,7 @@ public:
     std::vector<cesium::TileInfo> baseInfo() const;
 
     virtual void save() override;
+    virtual void countHierarchy(int sign) override;
 
 private:
     virtual Cell::PooledStack acquire() override
@@ -252,6 +386,11 @@ private:
         std::cout << "No BaseChunk::populate" << std::endl;
         throw std::runtime_error("No BaseChunk::populate");
     }
+    virtual void forEachTube(const TubeFunction& f) const override
+    {
+        std::cout << "No BaseChunk::forEachTube" << std::endl;
+        throw std::runtime_error("No BaseChunk::forEachTube");
+    }
 
     virtual void tile() const override;
 
@@ -260,6 +399,19 @@ private:
         return m_chunks.at(climber.depth()).getTube(climber);
     }
 
+    virtual Tube& getTube(const Id& index) override
+    {
+        std::cout << "No BaseChunk::getTube by index" << std::endl;
+        throw std::runtime_error("No BaseChunk::getTube by index");
+    }
+
+#ifdef ENTWINE_SLAB_TUBE
+    virtual PointSlab& getSlab(const Climber& climber) override
+    {
+        return m_chunks.at(climber.depth()).getSlab(climber);
+    }
+#endif
+
     std::vector<ContiguousChunk> m_chunks;
 };
 
@@ -10,14 +10,18 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 
 #include <entwine/tree/hierarchy.hpp>
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/dir.hpp>
+#include <entwine/types/fixed-id.hpp>
+#include <entwine/types/grid.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/point-pool.hpp>
 #include <entwine/types/structure.hpp>
@@ -26,6 +30,62 @@
 namespace entwine
 {
 
+// The indices tracked while climbing, along with the arithmetic to climb them.
+// Instantiated with FixedId for as long as the working depth allows, and with
+// Id for deeper trees.
+template<typename I>
+class ClimbIndex
+{
+public:
+    explicit ClimbIndex(const Structure& structure)
+        : index(0)
+        , chunkId(structure.nominalChunkIndex())
+        , chunkNum(0)
+        , pointsPerChunk(structure.basePointsPerChunk())
+    { }
+
+    void climb(const Structure& structure, Dir dir)
+    {
+        index <<= structure.dimensions();
+        ++index;
+        index += toIntegral(dir, structure.tubular());
+    }
+
+    void chunkClimb(
+            const Structure& structure,
+            const I& coldIndexBegin,
+            std::size_t workingDepth,
+            Dir dir)
+    {
+        if (workingDepth <= structure.sparseDepthBegin())
+        {
+            chunkId <<= structure.dimensions();
+            ++chunkId;
+
+            chunkId += toIntegral(dir) * pointsPerChunk;
+
+            if (workingDepth >= structure.coldDepthBegin())
+            {
+                chunkNum = (chunkId - coldIndexBegin) / pointsPerChunk;
+            }
+        }
+        else
+        {
+            chunkNum += structure.maxChunksPerDepth();
+
+            chunkId <<= structure.dimensions();
+            ++chunkId;
+
+            pointsPerChunk *= structure.factor();
+        }
+    }
+
+    I index;
+    I chunkId;
+    I chunkNum;
+    I pointsPerChunk;
+};
+
 class PointState
 {
 public:
@@ -36,20 +96,25 @@ public:
         : m_structure(structure)
         , m_boundsOriginal(bounds)
         , m_bounds(bounds)
-        , m_index(0)
         , m_depth(depth)
         , m_tick(0)
-        , m_chunkId(m_structure.nominalChunkIndex())
-        , m_chunkNum(0)
-        , m_pointsPerChunk(m_structure.basePointsPerChunk())
         , m_chunkBounds(bounds)
+        , m_grid(bounds)
+        , m_gridded(m_grid.valid())
+        , m_canFix(m_structure.coldDepthBegin() < m_structure.fixedDepthEnd())
+        , m_fixedColdIndexBegin(m_canFix ?
+                IdTraits<FixedId>::from(m_structure.coldIndexBegin()) : 0)
+        , m_isFixed(m_canFix)
+        , m_synced(!m_isFixed)
+        , m_fixed(structure)
+        , m_big(structure)
     { }
 
     virtual ~PointState() { }
 
     void climb(Dir dir)
     {
-        climb(m_bounds.get(dir).mid());
+        climb(bounds().get(dir).mid());
     }
 
     virtual void climb(const Point& point)
@@ -57,8 +122,18 @@ public:
         if (++m_depth <= m_structure.startDepth()) return;
 
         const std::size_t workingDepth(depth());
-        const Dir dir(getDirection(m_bounds.mid(), point));
-        m_bounds.go(dir);
+        Dir dir(Dir::swd);
+
+        if (gridded(point, m_cellDepth))
+        {
+            dir = gridClimb(m_cell, m_cellDepth, 3);
+            m_boundsSynced = false;
+        }
+        else
+        {
+            dir = getDirection(m_bounds.mid(), point);
+            m_bounds.go(dir);
+        }
 
         if (m_structure.tubular() && workingDepth <= Tube::maxTickDepth())
         {
@@ -66,9 +141,14 @@ public:
             if (isUp(dir)) ++m_tick;
         }
 
-        m_index <<= m_structure.dimensions();
-        ++m_index.data().front();
-        m_index += toIntegral(dir, m_structure.tubular());
+        unfix(workingDepth);
+
+        if (m_isFixed)
+        {
+            m_fixed.climb(m_structure, dir);
+            m_synced = false;
+        }
+        else m_big.climb(m_structure, dir);
 
         if (workingDepth > m_structure.nominalChunkDepth())
         {
@@ -86,78 +166,255 @@ public:
     virtual void reset()
     {
         m_bounds = m_boundsOriginal;
-        m_index = 0;
         m_depth = 0;
         m_tick = 0;
-
-        m_chunkId = m_structure.nominalChunkIndex();
-        m_chunkNum = 0;
-        m_pointsPerChunk = m_structure.basePointsPerChunk();
         m_chunkBounds = m_boundsOriginal;
+
+        m_gridded = m_grid.valid();
+        m_normalized = false;
+        std::fill(m_cell, m_cell + 3, 0);
+        std::fill(m_chunkCell, m_chunkCell + 2, 0);
+        m_cellDepth = 0;
+        m_chunkCellDepth = 0;
+        m_boundsSynced = true;
+        m_chunkBoundsSynced = true;
+
+        m_isFixed = m_canFix;
+        m_synced = !m_isFixed;
+        m_fixed = ClimbIndex<FixedId>(m_structure);
+        m_big = ClimbIndex<Id>(m_structure);
     }
 
-    const Bounds& bounds() const { return m_bounds; }
-    const Id& index() const     { return m_index; }
+    const Bounds& bounds() const
+    {
+        if (!m_boundsSynced)
+        {
+            m_grid.bounds(m_cell, m_cellDepth, m_bounds);
+            m_boundsSynced = true;
+        }
+
+        return m_bounds;
+    }
+
+    Point mid() const
+    {
+        if (m_boundsSynced) return m_bounds.mid();
+        else return m_grid.mid(m_cell, m_cellDepth);
+    }
+
+    const Id& index() const     { return big().index; }
     std::size_t depth() const   { return m_depth - m_structure.startDepth(); }
     std::size_t tick() const    { return m_tick; }
 
-    const Bounds& chunkBounds() const { return m_chunkBounds; }
-    const Id& chunkId() const   { return m_chunkId; }
-    const Id& pointsPerChunk() const    { return m_pointsPerChunk; }
+    const Bounds& chunkBounds() const
+    {
+        if (!m_chunkBoundsSynced)
+        {
+            m_grid.bounds(m_chunkCell, m_chunkCellDepth, m_chunkBounds, true);
+            m_chunkBoundsSynced = true;
+        }
+
+        return m_chunkBounds;
+    }
+
+    const Id& chunkId() const   { return big().chunkId; }
+    const Id& pointsPerChunk() const    { return big().pointsPerChunk; }
     std::size_t chunkNum() const
     {
-        if (m_chunkNum.trivial()) return m_chunkNum.getSimple();
+        if (m_isFixed)
+        {
+            if (m_fixed.chunkNum <= std::numeric_limits<std::size_t>::max())
+            {
+                return static_cast<std::size_t>(m_fixed.chunkNum);
+            }
+            else return std::numeric_limits<std::size_t>::max();
+        }
+
+        const Id& chunkNum(m_big.chunkNum);
+        if (chunkNum.trivial()) return chunkNum.getSimple();
         else return std::numeric_limits<std::size_t>::max();
     }
 
+    // While fixed(), our index is also available in fixed width, so callers
+    // in the insertion and counting paths may use it without synchronizing
+    // our Id indices.
+    bool fixed() const { return m_isFixed; }
+    const FixedId& fixedIndex() const
+    {
+        assert(m_isFixed);
+        return m_fixed.index;
+    }
+
     void climbTo(const Point& point, std::size_t requestedDepth)
     {
         while (depth() < requestedDepth) climb(point);
     }
 
+    // Move to the position of another state built from the same structure
+    // and bounds - e.g. to resume climbing from a cached ancestor rather than
+    // climbing from the root.
+    void jump(const PointState& other)
+    {
+        m_bounds = other.m_bounds;
+        m_depth = other.m_depth;
+        m_tick = other.m_tick;
+        m_chunkBounds = other.m_chunkBounds;
+
+        m_gridded = other.m_gridded;
+        m_normalized = other.m_normalized;
+        m_gridPoint = other.m_gridPoint;
+        std::copy(other.m_coords, other.m_coords + 3, m_coords);
+        std::copy(other.m_cell, other.m_cell + 3, m_cell);
+        std::copy(other.m_chunkCell, other.m_chunkCell + 2, m_chunkCell);
+        m_cellDepth = other.m_cellDepth;
+        m_chunkCellDepth = other.m_chunkCellDepth;
+        m_boundsSynced = other.m_boundsSynced;
+        m_chunkBoundsSynced = other.m_chunkBoundsSynced;
+
+        m_isFixed = other.m_isFixed;
+        m_synced = other.m_synced;
+        m_fixed = other.m_fixed;
+        m_big = other.m_big;
+    }
+
 protected:
     void chunkClimb(std::size_t workingDepth, const Point& point)
     {
+        Dir dir(Dir::swd);
+
         if (workingDepth <= m_structure.sparseDepthBegin())
         {
-            const Dir dir(getDirection(m_chunkBounds.mid(), point, true));
-            m_chunkBounds.go(dir, true);
+            if (gridded(point, m_chunkCellDepth))
+            {
+                dir = gridClimb(m_chunkCell, m_chunkCellDepth, 2);
+                m_chunkBoundsSynced = false;
+            }
+            else
+            {
+                dir = getDirection(m_chunkBounds.mid(), point, true);
+                m_chunkBounds.go(dir, true);
+            }
+        }
 
-            m_chunkId <<= m_structure.dimensions();
-            ++m_chunkId.data().front();
+        unfix(workingDepth);
 
-            m_chunkId += toIntegral(dir) * m_pointsPerChunk;
+        if (m_isFixed)
+        {
+            m_fixed.chunkClimb(
+                    m_structure,
+                    m_fixedColdIndexBegin,
+                    workingDepth,
+                    dir);
 
-            if (workingDepth >= m_structure.coldDepthBegin())
-            {
-                m_chunkNum =
-                    (m_chunkId - m_structure.coldIndexBegin()) /
-                    m_pointsPerChunk;
-            }
+            m_synced = false;
         }
         else
         {
-            m_chunkNum += m_structure.maxChunksPerDepth();
+            m_big.chunkClimb(
+                    m_structure,
+                    m_structure.coldIndexBegin(),
+                    workingDepth,
+                    dir);
+        }
+    }
+
+    // True if the next subdivision of a cell at this depth may be performed
+    // in integer space for this point.  Otherwise, our bounds are brought up
+    // to date and the remainder of this climb subdivides them directly.
+    bool gridded(const Point& point, std::size_t cellDepth)
+    {
+        if (!m_gridded) return false;
+
+        if (!m_normalized || !(point == m_gridPoint))
+        {
+            m_gridPoint = point;
+            m_normalized = m_grid.normalize(point, m_coords);
+        }
+
+        if (m_normalized && cellDepth + 1 < m_grid.depthEnd()) return true;
+
+        bounds();
+        chunkBounds();
+        m_gridded = false;
+        return false;
+    }
+
+    // Subdivide a cell along the given number of axes, returning the
+    // direction taken.
+    Dir gridClimb(Grid::Coord* cell, std::size_t& cellDepth, std::size_t axes)
+    {
+        ++cellDepth;
 
-            m_chunkId <<= m_structure.dimensions();
-            ++m_chunkId.data().front();
+        std::size_t dir(0);
+        for (std::size_t i(0); i < axes; ++i)
+        {
+            const bool upper(m_grid.upper(m_coords[i], cell[i], cellDepth));
+            cell[i] = (cell[i] << 1) | upper;
+            if (upper) dir |= 1 << i;
+        }
+
+        return static_cast<Dir>(dir);
+    }
+
+    // Once the indices at this depth may no longer fit in a FixedId, switch
+    // over to Id for the remainder of this climb.
+    void unfix(std::size_t workingDepth)
+    {
+        if (m_isFixed && workingDepth >= m_structure.fixedDepthEnd())
+        {
+            big();
+            m_isFixed = false;
+        }
+    }
 
-            m_pointsPerChunk *= m_structure.factor();
+    // The Id representation of our indices, which is only synchronized with
+    // the fixed-width representation on demand.
+    const ClimbIndex<Id>& big() const
+    {
+        if (!m_synced)
+        {
+            IdTraits<FixedId>::assign(m_big.index, m_fixed.index);
+            IdTraits<FixedId>::assign(m_big.chunkId, m_fixed.chunkId);
+            IdTraits<FixedId>::assign(m_big.chunkNum, m_fixed.chunkNum);
+            IdTraits<FixedId>::assign(
+                    m_big.pointsPerChunk,
+                    m_fixed.pointsPerChunk);
+
+            m_synced = true;
         }
+
+        return m_big;
     }
 
     const Structure& m_structure;
     const Bounds& m_boundsOriginal;
 
-    Bounds m_bounds;
-    Id m_index;
+    mutable Bounds m_bounds;
     std::size_t m_depth;
     std::size_t m_tick;
-
-    Id m_chunkId;
-    Id m_chunkNum;
-    Id m_pointsPerChunk;
-    Bounds m_chunkBounds;
+    mutable Bounds m_chunkBounds;
+
+    // While gridded, our bounds are derived from integral cell positions on
+    // demand rather than being subdivided at each depth.
+    Grid m_grid;
+    bool m_gridded;
+    bool m_normalized = false;
+    Point m_gridPoint;
+    Grid::Coord m_coords[3] = { 0, 0, 0 };
+    Grid::Coord m_cell[3] = { 0, 0, 0 };
+    Grid::Coord m_chunkCell[2] = { 0, 0 };
+    std::size_t m_cellDepth = 0;
+    std::size_t m_chunkCellDepth = 0;
+    mutable bool m_boundsSynced = true;
+    mutable bool m_chunkBoundsSynced = true;
+
+    bool m_canFix;
+    FixedId m_fixedColdIndexBegin;
+
+    bool m_isFixed;
+    mutable bool m_synced;
+    ClimbIndex<FixedId> m_fixed;
+    mutable ClimbIndex<Id> m_big;
 };
 
 class HierarchyState : public PointState
@@ -167,12 +424,20 @@ class HierarchyState : public PointState
     class ColdPosition
     {
     public:
-        ColdPosition() : m_id(0), m_tick(0), m_delta(0), m_cell(nullptr) { }
+        ColdPosition()
+            : m_fixed(false)
+            , m_fixedId(0)
+            , m_id(0)
+            , m_tick(0)
+            , m_delta(0)
+            , m_cell(nullptr)
+        { }
+
         ~ColdPosition() { count(); }
 
-        bool tryCount(const Id& id, std::size_t tick, int delta)
+        bool tryCount(const PointState& state, int delta)
         {
-            if (id == m_id && tick == m_tick)
+            if (state.tick() == m_tick && matches(state))
             {
                 assert(m_cell);
                 m_delta += delta;
@@ -184,16 +449,28 @@ class HierarchyState : public PointState
             }
         }
 
-        void set(const Id& id, std::size_t tick, HierarchyCell& cell)
+        void set(const PointState& state, HierarchyCell& cell)
         {
             count();
 
-            m_id = id;
-            m_tick = tick;
+            m_fixed = state.fixed();
+            if (m_fixed) m_fixedId = state.fixedIndex();
+            else m_id = state.index();
+
+            m_tick = state.tick();
             m_cell = &cell;
         }
 
     private:
+        bool matches(const PointState& state) const
+        {
+            if (state.fixed())
+            {
+                return m_fixed && state.fixedIndex() == m_fixedId;
+            }
+            else return !m_fixed && state.index() == m_id;
+        }
+
         void count()
         {
             if (m_cell && m_delta)
@@ -203,6 +480,8 @@ class HierarchyState : public PointState
             }
         }
 
+        bool m_fixed;
+        FixedId m_fixedId;
         Id m_id;
         std::size_t m_tick;
         int m_delta;
@@ -257,12 +536,9 @@ public:
                 {
                     ColdPosition& entry(m_coldCache[coldDepth]);
 
-                    if (!entry.tryCount(m_index, m_tick, delta))
+                    if (!entry.tryCount(*this, delta))
                     {
-                        entry.set(
-                                m_index,
-                                m_tick,
-                                m_hierarchy->count(*this, delta));
+                        entry.set(*this, m_hierarchy->count(*this, delta));
                     }
                 }
                 else
@@ -315,7 +591,7 @@ public:
     ChunkState getChunkClimb(Dir dir) const
     {
         ChunkState s(*this);
-        s.climb(m_chunkBounds.get(dir).mid());
+        s.climb(chunkBounds().get(dir).mid());
         return s;
     }
 };
@@ -351,6 +627,45 @@ public:
         while (m_pointState.depth() < depth) magnify(point);
     }
 
+    // A snapshot of the climbing position, without any hierarchy-counting
+    // state.  A climber may jump back to this position, which is equivalent
+    // to a reset() and magnifyTo(point, depth()) for any point for which
+    // contains(point) is true.
+    class Position
+    {
+        friend class Climber;
+
+    public:
+        bool contains(const Point& point) const
+        {
+            return
+                m_point.bounds().contains(point) &&
+                m_hierarchy.bounds().contains(point);
+        }
+
+        std::size_t depth() const { return m_point.depth(); }
+
+    private:
+        Position(const PointState& point, const PointState& hierarchy)
+            : m_point(point)
+            , m_hierarchy(hierarchy)
+        { }
+
+        PointState m_point;
+        PointState m_hierarchy;
+    };
+
+    Position position() const
+    {
+        return Position(m_pointState, m_hierarchyState);
+    }
+
+    void jump(const Position& position)
+    {
+        m_pointState.jump(position.m_point);
+        m_hierarchyState.jump(position.m_hierarchy);
+    }
+
     void magnifyTo(const Bounds& bounds)
     {
         Bounds norm(bounds.min(), bounds.max());
@@ -364,6 +679,10 @@ public:
     std::size_t tick()  const { return m_pointState.tick(); }
     std::size_t depth() const { return m_pointState.depth(); }
     const Bounds& bounds()  const { return m_pointState.bounds(); }
+    Point mid()             const { return m_pointState.mid(); }
+
+    bool fixed() const { return m_pointState.fixed(); }
+    const FixedId& fixedIndex() const { return m_pointState.fixedIndex(); }
 
     const Id& chunkId() const { return m_pointState.chunkId(); }
     const Id& pointsPerChunk() const { return m_pointState.pointsPerChunk(); }
@@ -16,12 +16,17 @@ namespace entwine
 
 void Clipper::clip()
 {
-    if (m_clips.size() < heuristics::clipCacheSize) return;
+    // With a chunk cache, releasing a chunk no longer serializes it, so there
+    // is no need to hold on to any which we are not using.
+    const std::size_t keep(
+            m_builder.chunkCache() ? 0 : heuristics::clipCacheSize);
+
+    if (m_clips.size() < keep) return;
 
     m_fastCache.assign(32, m_clips.end());
     bool done(false);
 
-    while (m_clips.size() > heuristics::clipCacheSize && !done)
+    while (m_clips.size() > keep && !done)
     {
         ClipInfo::Map::iterator& it(*m_order.rbegin());
 
@@ -40,6 +45,22 @@ void Clipper::clip()
     for (auto& p : m_clips) p.second.fresh = false;
 }
 
+void Clipper::evict()
+{
+    m_fastCache.assign(32, m_clips.end());
+
+    while (!m_order.empty() && !m_order.back()->second.fresh)
+    {
+        ClipInfo::Map::iterator& it(m_order.back());
+
+        m_builder.clip(it->first, it->second.chunkNum, m_id);
+        m_clips.erase(it);
+        m_order.pop_back();
+    }
+
+    for (auto& p : m_clips) p.second.fresh = false;
+}
+
 void Clipper::clip(const Id& chunkId)
 {
     m_builder.clip(chunkId, m_clips.at(chunkId).chunkNum, m_id, true);
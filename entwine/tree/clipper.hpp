@@ -11,12 +11,14 @@
 #pragma once
 
 #include <cstddef>
+#include <limits>
 #include <list>
 #include <set>
 #include <unordered_map>
 #include <vector>
 
 #include <entwine/tree/builder.hpp>
+#include <entwine/tree/climber.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/util/unique.hpp>
 
@@ -62,8 +64,11 @@ public:
         }
     }
 
-    bool insert(const Id& chunkId, std::size_t chunkNum, std::size_t depth)
+    bool insert(const Climber& climber)
     {
+        const std::size_t chunkNum(climber.chunkNum());
+        std::size_t depth(climber.depth());
+
         assert(depth >= m_startDepth);
         depth -= m_startDepth;
 
@@ -71,7 +76,13 @@ public:
         {
             auto& it(m_fastCache[depth]);
 
-            if (it != m_clips.end() && it->first == chunkId)
+            // Chunk numbers are unique where they fit, and are cheaper to
+            // compare than chunk IDs.
+            if (
+                    it != m_clips.end() &&
+                    (chunkNum != std::numeric_limits<std::size_t>::max() ?
+                        it->second.chunkNum == chunkNum :
+                        it->first == climber.chunkId()))
             {
                 it->second.fresh = true;
                 m_order.splice(
@@ -83,6 +94,7 @@ public:
             }
         }
 
+        const Id& chunkId(climber.chunkId());
         auto it(m_clips.find(chunkId));
 
         if (it != m_clips.end())
@@ -114,6 +126,10 @@ public:
 
     void clip();
     void clip(const Id& chunkId);
+
+    // Release every chunk which has not been touched since the last clip,
+    // regardless of how few we would be left holding.
+    void evict();
     std::size_t id() const { return m_id; }
     std::size_t size() const { return m_clips.size(); }
 
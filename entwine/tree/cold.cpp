@@ -18,6 +18,7 @@
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/climber.hpp>
 #include <entwine/tree/clipper.hpp>
+#include <entwine/tree/serializer.hpp>
 #include <entwine/tree/thread-pools.hpp>
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/point.hpp>
@@ -43,6 +44,7 @@ Cold::Cold(const Builder& builder, bool exists)
     : Splitter(builder.metadata().structure())
     , m_builder(builder)
     , m_pool(m_builder.threadPools().clipPool())
+    , m_residency(m_builder.metadata().schema().pointSize())
 {
     const Metadata& metadata(m_builder.metadata());
 
@@ -94,13 +96,13 @@ Tube::Insertion Cold::insert(
         return m_base.t->chunk->insert(climber, cell);
     }
 
-    auto& slot(getOrCreate(climber.chunkId(), climber.chunkNum()));
+    auto& slot(getOrCreate(climber));
     std::unique_ptr<CountedChunk>& countedChunk(slot.t);
 
     // With this insertion check into our single-threaded Clipper (which we
     // need to perform anyways), we can avoid locking this Chunk to check for
     // existence.
-    if (clipper.insert(climber.chunkId(), climber.chunkNum(), climber.depth()))
+    if (clipper.insert(climber))
     {
         UniqueSpin slotLock(slot.spinner);
 
@@ -111,12 +113,33 @@ Tube::Insertion Cold::insert(
 
         auto& refs(countedChunk->refs);
 
+        if (refs.empty() && countedChunk->chunk)
+        {
+            // Released by every origin, but not yet serialized.
+            m_residency.revive(climber.chunkId());
+        }
+
         if (!refs.count(clipper.id())) refs[clipper.id()] = 1;
         else ++refs[clipper.id()];
 
         if (!countedChunk->chunk)
         {
-            ensureChunk(climber, countedChunk->chunk, alreadyExists);
+            if (auto cooled = m_cooler.thaw(climber.chunkId()))
+            {
+                countedChunk->chunk = thaw(climber.chunkId(), *cooled);
+            }
+            else
+            {
+                // A previous write of this chunk may still be on its way out.
+                Serializer* serializer(m_builder.serializer());
+                if (alreadyExists && serializer)
+                {
+                    serializer->await(climber.chunkId());
+                }
+
+                ensureChunk(climber, countedChunk->chunk, alreadyExists);
+                if (alreadyExists) m_residency.reloaded();
+            }
         }
     }
 
@@ -257,24 +280,128 @@ void Cold::clip(
     auto& slot(at(chunkId, chunkNum));
     assert(slot.exists);
 
-    auto unref([this, chunkId, &slot, id]()
+    auto unref([this, chunkId, chunkNum, &slot, id]()
     {
-        SpinGuard lock(slot.spinner);
-        assert(slot.t);
+        const std::size_t target(m_builder.chunkCache());
 
-        if (m_builder.metadata().cesiumSettings() && slot.t->unique())
         {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            m_info[chunkId] = slot.t->chunk->info();
+            SpinGuard lock(slot.spinner);
+            assert(slot.t);
+
+            if (m_builder.metadata().cesiumSettings() && slot.t->unique())
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_info[chunkId] = slot.t->chunk->info();
+            }
+
+            if (!slot.t->unref(id)) return;
+
+            if (target)
+            {
+                m_residency.release(
+                        chunkId,
+                        chunkNum,
+                        slot.t->chunk->numPoints());
+            }
+            else
+            {
+                retire(chunkId, chunkNum, *slot.t);
+            }
         }
 
-        slot.t->unref(id);
+        shed(target, true);
+        age(m_builder.coolingBudget(), true);
     });
 
     if (!sync) m_pool.add(unref);
     else unref();
 }
 
+void Cold::shed(const std::size_t target, const bool sync)
+{
+    for (const auto& victim : m_residency.take(target))
+    {
+        if (sync) evict(victim);
+        else m_pool.add([this, victim]() { evict(victim); });
+    }
+}
+
+void Cold::age(const std::size_t target, const bool sync)
+{
+    for (const auto& victim : m_cooler.expired(target))
+    {
+        if (sync) write(victim);
+        else m_pool.add([this, victim]() { write(victim); });
+    }
+}
+
+void Cold::evict(const Residency::Victim& victim)
+{
+    auto& slot(at(victim.chunkId, victim.chunkNum));
+    SpinGuard lock(slot.spinner);
+
+    // This chunk may have been taken back since it was chosen.
+    if (slot.t && slot.t->chunk && slot.t->refs.empty())
+    {
+        retire(victim.chunkId, victim.chunkNum, *slot.t);
+        m_residency.forget(victim.chunkId);
+    }
+}
+
+void Cold::write(const Cooler::Victim& victim)
+{
+    auto& slot(at(victim.chunkId, victim.chunkNum));
+    SpinGuard lock(slot.spinner);
+
+    // This chunk may have been thawed, or written by another thread, since it
+    // was chosen.  If our storage allows, its packed points are written as
+    // they are, rather than restored into a chunk just to be gathered again.
+    if (auto cooled = m_cooler.take(victim.chunkId))
+    {
+        if (!Chunk::save(m_builder, victim.chunkId, *cooled))
+        {
+            thaw(victim.chunkId, *cooled)->save();
+        }
+
+        m_residency.saved();
+    }
+}
+
+void Cold::retire(
+        const Id& chunkId,
+        const std::size_t chunkNum,
+        CountedChunk& counted)
+{
+    if (m_builder.coolingBudget())
+    {
+        m_cooler.insert(
+                chunkId,
+                makeUnique<CooledChunk>(*counted.chunk, chunkNum));
+    }
+    else
+    {
+        counted.chunk->save();
+        m_residency.saved();
+    }
+
+    counted.chunk.reset();
+}
+
+std::unique_ptr<Chunk> Cold::thaw(const Id& chunkId, const CooledChunk& cooled)
+{
+    std::unique_ptr<Chunk> chunk(
+            Chunk::create(
+                m_builder,
+                cooled.bounds,
+                cooled.depth,
+                chunkId,
+                cooled.maxPoints,
+                false));
+
+    chunk->unpack(cooled.data);
+    return chunk;
+}
+
 void Cold::merge(const Cold& other)
 {
     if (m_base.t->chunk)
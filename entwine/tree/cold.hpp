@@ -22,6 +22,8 @@
 
 #include <entwine/formats/cesium/tile-info.hpp>
 #include <entwine/tree/chunk.hpp>
+#include <entwine/tree/cooler.hpp>
+#include <entwine/tree/residency.hpp>
 #include <entwine/tree/splitter.hpp>
 #include <entwine/types/point-pool.hpp>
 #include <entwine/types/tube.hpp>
@@ -52,17 +54,16 @@ struct CountedChunk
         return refs.size() == 1 && refs.begin()->second == 1;
     }
 
-    void unref(std::size_t id)
+    // Returns true if this released the last reference to our chunk.
+    bool unref(std::size_t id)
     {
         if (!--refs.at(id))
         {
             refs.erase(id);
-            if (refs.empty())
-            {
-                chunk->save();
-                chunk.reset();
-            }
+            return refs.empty();
         }
+
+        return false;
     }
 };
 
@@ -86,8 +87,20 @@ public:
             std::size_t id,
             bool sync);
 
+    // Serialize idle chunks, least valuable first, until no more than target
+    // bytes of them remain resident.  If not sync, the serialization happens
+    // on our pool.
+    void shed(std::size_t target, bool sync);
+
+    // Write out cooled chunks, oldest first, until no more than target bytes
+    // of them remain.  If not sync, the writing happens on our pool.
+    void age(std::size_t target, bool sync);
+
     void merge(const Cold& other);
 
+    const Residency& residency() const { return m_residency; }
+    const Cooler& cooler() const { return m_cooler; }
+
     std::size_t clipThreads() const;
 
     Chunk* base()
@@ -104,6 +117,19 @@ private:
 
     void saveCesiumMetadata(const arbiter::Endpoint& endpoint) const;
 
+    // Serialize this chunk if it is still idle.
+    void evict(const Residency::Victim& victim);
+
+    // Write out this chunk if it is still cooled.
+    void write(const Cooler::Victim& victim);
+
+    // Called with the slot locked, after the last reference to this chunk
+    // has been released.  Either cool it, if we have a cooling budget, or
+    // serialize it, and then drop it from memory.
+    void retire(const Id& chunkId, std::size_t chunkNum, CountedChunk& counted);
+
+    std::unique_ptr<Chunk> thaw(const Id& chunkId, const CooledChunk& cooled);
+
     using ChunkMap = std::unordered_map<Id, std::unique_ptr<CountedChunk>>;
 
     const Builder& m_builder;
@@ -111,6 +137,9 @@ private:
 
     std::map<Id, cesium::TileInfo> m_info;
     std::mutex m_mutex;
+
+    Residency m_residency;
+    Cooler m_cooler;
 };
 
 } // namespace entwine
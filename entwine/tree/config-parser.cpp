@@ -145,6 +145,8 @@ std::unique_ptr<Builder> ConfigParser::getBuilder(
                 std::cout << "Scanning for new files..." << std::endl;
             }
 
+            configure(*builder, json);
+
             // Only scan for files that aren't already in the index.
             fileInfo = builder->metadata().manifest().diff(fileInfo);
 
@@ -398,9 +400,28 @@ std::unique_ptr<Builder> ConfigParser::getBuilder(
             outerScope);
 
     if (verbose) builder->verbose(true);
+    configure(*builder, json);
     return builder;
 }
 
+void ConfigParser::configure(Builder& builder, const Json::Value& json)
+{
+    builder.sortedInsertion(json["sortedInsertion"].asBool());
+    builder.deferHierarchy(json["deferHierarchy"].asBool());
+    builder.pipelinedInput(json["pipelinedInput"].asBool());
+    builder.adaptiveThreads(json["adaptiveThreads"].asBool());
+    builder.memoryBudget(json["memoryBudget"].asUInt64());
+    builder.chunkCache(json["chunkCache"].asUInt64());
+    builder.coolingBudget(json["coolingBudget"].asUInt64());
+    builder.scheduling(json["scheduling"].asString());
+    builder.splitThreshold(json["splitThreshold"].asUInt64());
+    builder.prefetch(json["prefetch"].asUInt64());
+    builder.prefetchBudget(json["prefetchBudget"].asUInt64());
+    builder.compressThreads(json["compressThreads"].asUInt64());
+    builder.uploadThreads(json["uploadThreads"].asUInt64());
+    builder.packChunks(json["pack"].asUInt64());
+}
+
 std::unique_ptr<Builder> ConfigParser::tryGetExisting(
         const Json::Value& config,
         std::shared_ptr<arbiter::Arbiter> arbiter,
@@ -50,6 +50,10 @@ private:
             std::size_t workThreads,
             std::size_t clipThreads);
 
+    // Apply settings which only affect how this run of the build proceeds,
+    // and so are not persisted in its metadata.
+    static void configure(Builder& builder, const Json::Value& json);
+
     static std::unique_ptr<Subset> maybeAccommodateSubset(
             Json::Value& json,
             const Bounds& boundsConforming,
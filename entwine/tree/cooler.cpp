@@ -0,0 +1,112 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/cooler.hpp>
+
+#include <iterator>
+#include <stdexcept>
+
+#include <entwine/tree/chunk.hpp>
+
+namespace entwine
+{
+
+CooledChunk::CooledChunk(const Chunk& chunk, const std::size_t chunkNum)
+    : bounds(chunk.bounds())
+    , depth(chunk.depth())
+    , maxPoints(chunk.maxPoints())
+    , type(chunk.type())
+    , chunkNum(chunkNum)
+    , data(chunk.pack())
+{ }
+
+Cooler::Cooler()
+    : m_mutex()
+    , m_entries()
+    , m_order()
+    , m_bytes(0)
+    , m_cooled(0)
+    , m_thawed(0)
+    , m_written(0)
+{ }
+
+void Cooler::insert(const Id& chunkId, std::unique_ptr<CooledChunk> cooled)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_entries.count(chunkId))
+    {
+        throw std::runtime_error("Chunk already cooled: " + chunkId.str());
+    }
+
+    m_bytes += cooled->data.size();
+    m_order.push_back(chunkId);
+
+    Entry& entry(m_entries[chunkId]);
+    entry.cooled = std::move(cooled);
+    entry.orderIt = std::prev(m_order.end());
+
+    ++m_cooled;
+}
+
+std::unique_ptr<CooledChunk> Cooler::thaw(const Id& chunkId)
+{
+    std::unique_ptr<CooledChunk> cooled(remove(chunkId));
+    if (cooled) ++m_thawed;
+    return cooled;
+}
+
+std::unique_ptr<CooledChunk> Cooler::take(const Id& chunkId)
+{
+    std::unique_ptr<CooledChunk> cooled(remove(chunkId));
+    if (cooled) ++m_written;
+    return cooled;
+}
+
+std::unique_ptr<CooledChunk> Cooler::remove(const Id& chunkId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it(m_entries.find(chunkId));
+    if (it == m_entries.end()) return std::unique_ptr<CooledChunk>();
+
+    std::unique_ptr<CooledChunk> cooled(std::move(it->second.cooled));
+    m_bytes -= cooled->data.size();
+    m_order.erase(it->second.orderIt);
+    m_entries.erase(it);
+
+    return cooled;
+}
+
+std::vector<Cooler::Victim> Cooler::expired(const std::size_t target) const
+{
+    std::vector<Victim> victims;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::size_t bytes(m_bytes);
+    for (auto it(m_order.begin()); it != m_order.end() && bytes > target; ++it)
+    {
+        const CooledChunk& cooled(*m_entries.at(*it).cooled);
+        victims.emplace_back(*it, cooled.chunkNum);
+        bytes -= cooled.data.size();
+    }
+
+    return victims;
+}
+
+std::size_t Cooler::bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,100 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <entwine/tree/residency.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/storage-types.hpp>
+#include <entwine/types/structure.hpp>
+
+namespace entwine
+{
+
+class Chunk;
+
+// A chunk which has been evicted from memory, but not yet written out.  Its
+// points are held in the packed form of Chunk::pack.
+struct CooledChunk
+{
+    CooledChunk(const Chunk& chunk, std::size_t chunkNum);
+
+    Bounds bounds;
+    std::size_t depth;
+    Id maxPoints;
+    ChunkType type;
+    std::size_t chunkNum;
+    std::vector<char> data;
+};
+
+// A write-behind tier beneath the resident chunks.  Rather than serializing
+// an evicted chunk to the output endpoint, it may be packed and cooled here,
+// where it may be cheaply restored - without climbing the tree for each of
+// its points - if it is touched again.  Cooled chunks are only written out
+// when they age out of their budget, or when the build is saved.
+class Cooler
+{
+public:
+    using Victim = Residency::Victim;
+
+    Cooler();
+
+    // Like the Residency, these are called with the chunk's slot locked.
+    // Either of thaw, to restore the chunk, or take, to write it out, removes
+    // it from our tier, returning null if it is not here.
+    void insert(const Id& chunkId, std::unique_ptr<CooledChunk> cooled);
+    std::unique_ptr<CooledChunk> thaw(const Id& chunkId);
+    std::unique_ptr<CooledChunk> take(const Id& chunkId);
+
+    // The oldest cooled chunks, beyond which no more than target bytes of
+    // them remain.  They are not removed - each must be taken, with its slot
+    // locked, by whoever writes it out.
+    std::vector<Victim> expired(std::size_t target) const;
+
+    // Bytes held by cooled chunks.
+    std::size_t bytes() const;
+
+    // Counts of chunks which have been cooled, of those which have been
+    // restored from their cooled state, and of those taken to be written out.
+    std::size_t cooled() const { return m_cooled; }
+    std::size_t thawed() const { return m_thawed; }
+    std::size_t written() const { return m_written; }
+
+private:
+    using Order = std::list<Id>;
+
+    std::unique_ptr<CooledChunk> remove(const Id& chunkId);
+
+    struct Entry
+    {
+        std::unique_ptr<CooledChunk> cooled;
+        Order::iterator orderIt;
+    };
+
+    mutable std::mutex m_mutex;
+    std::map<Id, Entry> m_entries;
+    Order m_order;
+    std::size_t m_bytes;
+
+    std::atomic_size_t m_cooled;
+    std::atomic_size_t m_thawed;
+    std::atomic_size_t m_written;
+};
+
+} // namespace entwine
+
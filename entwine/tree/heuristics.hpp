@@ -29,6 +29,71 @@ const std::size_t clipCacheSize(64);
 // work threads to clip threads.
 const float defaultWorkToClipRatio(0.33);
 
+// With adaptive threading, the split between work and clip threads is
+// revisited at this interval, in milliseconds, and shifted by at most one
+// thread each time.
+const std::size_t rebalanceInterval(2000);
+
+// A pool which was busy for at least this fraction of its thread-time over the
+// last interval is considered saturated, and one busy for less than the low
+// fraction may give up a thread.
+const float rebalanceBusyHigh(0.9);
+const float rebalanceBusyLow(0.5);
+
+// With adaptive threading, when less than this fraction of the allocated point
+// pool is available, resident points are crowding out new ones, so clip
+// threads are favored.
+const float rebalancePoolPressure(0.5);
+
+// With a memory budget, pressure is applied once the estimated usage reaches
+// this fraction of the budget: every Clipper evicts its idle chunks, and the
+// free memory of the point pool is returned to the operating system.  This is
+// done at most once per budgetInterval milliseconds.
+const float budgetHighWater(0.9);
+const std::size_t budgetInterval(1000);
+
+// While over the memory budget, inserting threads wait between batches, polling
+// every budgetPoll milliseconds, for at most budgetWait milliseconds, and only
+// while each poll finds the usage lower than the last - their own chunks may
+// be all that is left to free.
+const std::size_t budgetPoll(50);
+const std::size_t budgetWait(5000);
+
+// Inputs prefetched ahead of their insertion are downloaded by at most this
+// many threads at once.  Failed downloads are retried up to inputRetryLimit
+// times, backing off by a second longer for each attempt.
+const std::size_t prefetchThreads(4);
+const std::size_t inputRetryLimit(16);
+
+// Remote inputs of known size are downloaded as a series of byte ranges of
+// this size, with up to rangeReadAhead of them requested beyond the one being
+// written to disk.
+const std::size_t rangeBlockSize(8 * 1024 * 1024);
+const std::size_t rangeReadAhead(4);
+
+// Each stage of a pipelined chunk write queues at most this many chunks per
+// worker thread of the stage, beyond which the stage before it blocks.  Packed
+// chunks waiting in these queues hold their points outside of the point pool.
+const std::size_t serializeQueueFactor(2);
+
+// Rough footprint of a live chunk beyond its pooled points, for the purposes
+// of the memory budget.
+const std::size_t chunkOverhead(64 * 1024);
+
+// The fixed cost, in bytes-equivalent, of serializing a chunk and later
+// fetching it back, independent of its size.  Weighed against the size of
+// idle chunks when choosing which to serialize - the higher this is, the more
+// small chunks are favored to remain resident.
+const std::size_t chunkReloadCost(4 * 1024 * 1024);
+
+// Input points are read into tables of pooled nodes, which are handed off for
+// insertion in batches of about this many bytes - enough to amortize the
+// hand-off, while small enough that a batch is likely still in cache when it
+// is inserted.  The number of points is kept within the min/max bounds.
+const std::size_t tableBytes(512 * 1024);
+const std::size_t tableMinPoints(1024);
+const std::size_t tableMaxPoints(65536);
+
 // Pooled point cells, data, and hierarchy nodes come from the splice pool,
 // which allocates them in blocks.  This sets the block size.
 const std::size_t poolBlockSize(1024 * 1024);
@@ -39,6 +104,37 @@ const std::size_t poolBlockSize(1024 * 1024);
 // blocks well past the point after which we expect the data to get sparse.
 const float hierarchySparseFactor(1.25);
 
+// Initial slot count of a FlatTube's table - must be a power of two.  Each
+// table that fills up chains a new one of twice the capacity behind it.
+const std::size_t flatTubeCapacity(8);
+
+// Number of independently-locked shards holding the tubes of each sparse
+// chunk.  More shards mean less contention between threads inserting into the
+// same chunk, at the cost of a larger footprint for every sparse chunk.
+const std::size_t tubeMapShards(32);
+
+// Number of tubes allocated together when any tube of a contiguous chunk is
+// first touched.  Larger pages mean fewer allocations, but more idle tubes in
+// chunks which are only sparsely occupied.
+const std::size_t tubePageSize(256);
+
+// Record capacity of the first block of a chunk's point slab.  Each further
+// block doubles in size, so this only bounds the footprint of tiny chunks.
+const std::size_t slabBlockSize(256);
+
+// The points of each cold chunk are grouped into the cells of a grid over the
+// chunk, which is indexed in the chunk's tail - see ChunkIndex.  The grid is
+// made as fine as allows about this many points per cell, up to this many
+// bits of resolution along each axis.
+const std::size_t chunkIndexCellPoints(256);
+const std::size_t chunkIndexMaxBits(4);
+
+// Packed chunks fetched together from a remote pack are coalesced into a
+// single range request if no more than this many bytes separate them, up to
+// this many bytes per request.
+const std::size_t packCoalesceGap(64 * 1024);
+const std::size_t packCoalesceMax(64 * 1024 * 1024);
+
 } // namespace heuristics
 } // namespace entwine
 
@@ -11,6 +11,7 @@
 #include <entwine/tree/hierarchy-block.hpp>
 
 #include <atomic>
+#include <thread>
 
 #include <entwine/types/metadata.hpp>
 #include <entwine/types/storage.hpp>
@@ -26,6 +27,11 @@ namespace entwine
 namespace
 {
     std::atomic_size_t chunkCount(0);
+
+    // Initial slot count of a HierarchyTicks table, which must be a power of
+    // two, and the length of the run of slots probed for a key in each table.
+    const std::size_t ticksCapacity(64);
+    const std::size_t ticksProbe(16);
 }
 
 std::size_t HierarchyBlock::count() { return chunkCount; }
@@ -154,6 +160,105 @@ void HierarchyBlock::save(const arbiter::Endpoint& ep, const std::string pf)
     io::ensurePut(ep, m_id.str() + pf, data);
 }
 
+HierarchyTicks::Table* HierarchyTicks::Table::grow()
+{
+    Table* next(m_next.load());
+    if (next) return next;
+
+    std::unique_ptr<Table> created(new Table(m_capacity * 2));
+
+    if (m_next.compare_exchange_strong(next, created.get()))
+    {
+        return created.release();
+    }
+
+    // Someone else beat us to it - theirs is now stored in "next".
+    return next;
+}
+
+HierarchyTicks::Table* HierarchyTicks::head()
+{
+    Table* table(m_table.load());
+    if (table) return table;
+
+    std::unique_ptr<Table> created(new Table(ticksCapacity));
+
+    if (m_table.compare_exchange_strong(table, created.get()))
+    {
+        return created.release();
+    }
+
+    return table;
+}
+
+HierarchyCell& HierarchyTicks::at(const uint64_t tube, const uint64_t tick)
+{
+    const std::size_t h(hash(tube, tick));
+    Table* table(head());
+
+    while (true)
+    {
+        const std::size_t mask(table->capacity() - 1);
+
+        for (std::size_t i(0); i < ticksProbe; ++i)
+        {
+            Slot& slot(table->slot((h + i) & mask));
+            int state(slot.state.load(std::memory_order_acquire));
+
+            if (state == Slot::Empty)
+            {
+                if (slot.state.compare_exchange_strong(
+                            state,
+                            Slot::Constructing,
+                            std::memory_order_acq_rel))
+                {
+                    slot.tube = tube;
+                    slot.tick = tick;
+                    slot.state.store(Slot::Ready, std::memory_order_release);
+                    return slot.cell;
+                }
+
+                // Lost the claim - the new state of this slot is now stored
+                // in "state", so fall through to see whose key it holds.
+            }
+
+            while (state == Slot::Constructing)
+            {
+                std::this_thread::yield();
+                state = slot.state.load(std::memory_order_acquire);
+            }
+
+            if (slot.tube == tube && slot.tick == tick) return slot.cell;
+        }
+
+        // Every slot of our run holds some other key, so an earlier insertion
+        // of this key could not have stopped here either.
+        table = table->grow();
+    }
+}
+
+const HierarchyCell* HierarchyTicks::find(
+        const uint64_t tube,
+        const uint64_t tick) const
+{
+    const std::size_t h(hash(tube, tick));
+
+    for (const Table* table(m_table.load()); table; table = table->next())
+    {
+        const std::size_t mask(table->capacity() - 1);
+
+        for (std::size_t i(0); i < ticksProbe; ++i)
+        {
+            const Slot& slot(table->slot((h + i) & mask));
+
+            if (slot.state.load() == Slot::Empty) return nullptr;
+            if (slot.tube == tube && slot.tick == tick) return &slot.cell;
+        }
+    }
+
+    return nullptr;
+}
+
 ContiguousBlock::ContiguousBlock(
         HierarchyCell::Pool& pool,
         const Metadata& metadata,
@@ -162,8 +267,8 @@ ContiguousBlock::ContiguousBlock(
         const std::size_t maxPoints,
         const std::vector<char>& data)
     : HierarchyBlock(pool, metadata, id, outEndpoint, maxPoints, data.size())
-    , m_tubes(maxPoints)
-    , m_spinners(maxPoints)
+    , m_span(maxPoints)
+    , m_dense(new HierarchyCell[m_span])
 {
     const char* pos(data.data());
     const char* end(data.data() + data.size());
@@ -176,7 +281,7 @@ ContiguousBlock::ContiguousBlock(
         tick = extract(pos, end);
         cell = extract(pos, end);
 
-        m_tubes.at(tube).insert(std::make_pair(tick, m_pool.acquireOne(cell)));
+        this->cell(tube, tick) = HierarchyCell(cell);
     }
 }
 
@@ -184,27 +289,21 @@ std::vector<char> ContiguousBlock::combine()
 {
     std::vector<char> data;
 
-    for (uint64_t tube(0); tube < m_tubes.size(); ++tube)
+    forEach([this, &data](uint64_t tube, uint64_t tick, uint64_t val)
     {
-        for (const auto& cell : m_tubes[tube])
-        {
-            push(data, tube);
-            push(data, cell.first);
-            push(data, cell.second->val());
-        }
-    }
+        push(data, tube);
+        push(data, tick);
+        push(data, val);
+    });
 
     return data;
 }
 
 bool ContiguousBlock::empty() const
 {
-    for (const auto& tube : m_tubes)
-    {
-        if (!tube.empty()) return false;
-    }
-
-    return true;
+    bool result(true);
+    forEach([&result](uint64_t, uint64_t, uint64_t) { result = false; });
+    return result;
 }
 
 SparseBlock::SparseBlock(
@@ -335,17 +434,17 @@ std::vector<char> BaseBlock::combine()
 
     for (const auto& block : m_blocks)
     {
-        const auto& tubes(block.tubes());
+        const uint64_t base(block.id().getSimple());
 
-        for (std::size_t tube(0); tube < tubes.size(); ++tube)
+        block.forEach([this, &data, base](
+                    uint64_t tube,
+                    uint64_t tick,
+                    uint64_t val)
         {
-            for (const auto& cell : tubes[tube])
-            {
-                push(data, (block.id() + tube).getSimple());
-                push(data, cell.first);
-                push(data, cell.second->val());
-            }
-        }
+            push(data, base + tube);
+            push(data, tick);
+            push(data, val);
+        });
     }
 
     return data;
@@ -378,13 +477,13 @@ std::set<Id> BaseBlock::merge(BaseBlock& other)
                 const Id id(block.id());
                 SparseBlock write(m_pool, m_metadata, id, m_ep, ppc);
 
-                for (std::size_t i(0); i < block.tubes().size(); ++i)
+                block.forEach([&write, &id](
+                            uint64_t tube,
+                            uint64_t tick,
+                            uint64_t val)
                 {
-                    for (const auto& c : block.tubes().at(i))
-                    {
-                        write.count(id + i, c.first, c.second->val());
-                    }
-                }
+                    write.count(id + tube, tick, val);
+                });
 
                 if (!write.tubes().empty())
                 {
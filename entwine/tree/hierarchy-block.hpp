@@ -11,14 +11,20 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <set>
 #include <stdexcept>
+#include <tuple>
+#include <vector>
 
 #include <entwine/third/splice-pool/splice-pool.hpp>
 #include <entwine/types/defs.hpp>
+#include <entwine/types/fixed-id.hpp>
 #include <entwine/types/storage-types.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/util/spin-lock.hpp>
@@ -35,31 +41,129 @@ public:
     using PooledNode = Pool::UniqueNodeType;
     using PooledStack = Pool::UniqueStackType;
 
-    HierarchyCell() : m_val(0), m_spinner() { }
-    HierarchyCell(uint64_t val) : m_val(val), m_spinner() { }
+    HierarchyCell() : m_val(0) { }
+    HierarchyCell(uint64_t val) : m_val(val) { }
 
     HierarchyCell& operator=(const HierarchyCell& other)
     {
-        m_val = other.val();
+        m_val.store(other.m_val.load(std::memory_order_relaxed));
         return *this;
     }
 
-    HierarchyCell& count(int delta)
+    HierarchyCell& count(int64_t delta)
     {
-        SpinGuard lock(m_spinner);
-        m_val = static_cast<int>(m_val) + delta;
+        m_val.fetch_add(delta, std::memory_order_relaxed);
         return *this;
     }
 
-    uint64_t val() const { return m_val; }
+    uint64_t val() const { return m_val.load(std::memory_order_relaxed); }
 
 private:
-    uint64_t m_val;
-    SpinLock m_spinner;
+    std::atomic<int64_t> m_val;
 };
 
 using HierarchyTube = std::map<uint64_t, HierarchyCell::PooledNode>;
 
+// Counters for the nonzero ticks of a contiguous block, keyed by normalized
+// tube and tick, in a flat open-addressing table.  Slots are claimed with a
+// CAS and never freed, and each key is probed for within a bounded run of
+// slots.  If that run is full of other keys, the search continues in a table
+// of twice the capacity chained behind - so a counter never moves once
+// created, and may be counted without locking.
+class HierarchyTicks
+{
+public:
+    HierarchyTicks() : m_table(nullptr) { }
+    ~HierarchyTicks() { delete m_table.load(); }
+
+    HierarchyTicks(HierarchyTicks&& other) noexcept
+        : m_table(other.m_table.exchange(nullptr))
+    { }
+
+    HierarchyTicks& operator=(HierarchyTicks&& other) noexcept
+    {
+        delete m_table.exchange(other.m_table.exchange(nullptr));
+        return *this;
+    }
+
+    // Returns the counter for this key, creating it if necessary.
+    HierarchyCell& at(uint64_t tube, uint64_t tick);
+
+    // Returns null if this key has never been counted.  Not safe to call
+    // concurrently with at().
+    const HierarchyCell* find(uint64_t tube, uint64_t tick) const;
+
+    // Calls f(uint64_t tube, uint64_t tick, uint64_t val) for each counter,
+    // in no particular order.  Not safe to call concurrently with at().
+    template<typename F> void forEach(F f) const
+    {
+        for (const Table* t(m_table.load()); t; t = t->next())
+        {
+            for (std::size_t i(0); i < t->capacity(); ++i)
+            {
+                const Slot& slot(t->slot(i));
+                if (slot.state.load() == Slot::Ready)
+                {
+                    f(slot.tube, slot.tick, slot.cell.val());
+                }
+            }
+        }
+    }
+
+private:
+    struct Slot
+    {
+        enum : int { Empty, Constructing, Ready };
+
+        Slot() : state(Empty), tube(0), tick(0), cell() { }
+
+        std::atomic_int state;
+        uint64_t tube;
+        uint64_t tick;
+        HierarchyCell cell;
+    };
+
+    class Table
+    {
+    public:
+        explicit Table(std::size_t capacity)
+            : m_capacity(capacity)
+            , m_slots(new Slot[capacity])
+            , m_next(nullptr)
+        { }
+
+        ~Table() { delete m_next.load(); }
+
+        std::size_t capacity() const { return m_capacity; }
+        Slot& slot(std::size_t i) { return m_slots[i]; }
+        const Slot& slot(std::size_t i) const { return m_slots[i]; }
+
+        // Returns the next table in the chain, creating it if necessary.
+        Table* grow();
+        const Table* next() const { return m_next.load(); }
+
+    private:
+        const std::size_t m_capacity;
+        std::unique_ptr<Slot[]> m_slots;
+        std::atomic<Table*> m_next;
+    };
+
+    static std::size_t hash(uint64_t tube, uint64_t tick)
+    {
+        uint64_t h(tube * 0x9E3779B97F4A7C15ULL + tick);
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ULL;
+        return h ^ (h >> 32);
+    }
+
+    Table* head();
+
+    std::atomic<Table*> m_table;
+
+    HierarchyTicks(const HierarchyTicks&) = delete;
+    HierarchyTicks& operator=(const HierarchyTicks&) = delete;
+};
+
 namespace arbiter { class Endpoint; }
 
 class Metadata;
@@ -99,6 +203,16 @@ public:
 
     // Only count must be thread-safe.  Get/save are single-threaded.
     virtual HierarchyCell& count(const Id& id, uint64_t tick, int delta) = 0;
+
+    // As count(), for an index which fits in a FixedId.
+    virtual HierarchyCell& countFixed(
+            const FixedId& id,
+            uint64_t tick,
+            int delta)
+    {
+        return count(IdTraits<FixedId>::toId(id), tick, delta);
+    }
+
     virtual uint64_t get(const Id& id, uint64_t tick) const = 0;
 
     const Id& id() const { return m_id; }
@@ -171,6 +285,8 @@ protected:
     const std::size_t m_size;
 };
 
+// Tick zero of every tube is counted in a dense array, which covers every
+// tube of non-tubular structures.  Other ticks live in a HierarchyTicks table.
 class ContiguousBlock : public HierarchyBlock
 {
     friend class BaseBlock;
@@ -185,8 +301,8 @@ public:
             const arbiter::Endpoint* outEndpoint,
             std::size_t maxPoints)
         : HierarchyBlock(pool, metadata, id, outEndpoint, maxPoints, 0)
-        , m_tubes(maxPoints)
-        , m_spinners(maxPoints)
+        , m_span(maxPoints)
+        , m_dense(new HierarchyCell[m_span])
     { }
 
     ContiguousBlock(
@@ -205,39 +321,80 @@ public:
             int delta) override
     {
         assert(global >= m_id && global < m_id + m_maxPoints);
+        return cell(normalize(global).getSimple(), tick).count(delta);
+    }
 
-        const std::size_t id(normalize(global).getSimple());
-
-        SpinGuard lock(m_spinners.at(id));
-        auto& tube(m_tubes.at(id));
-        auto it(tube.find(tick));
-        if (it == tube.end())
-        {
-            it = tube.insert(std::make_pair(tick, m_pool.acquireOne())).first;
-        }
-        return it->second->count(delta);
+    virtual HierarchyCell& countFixed(
+            const FixedId& global,
+            uint64_t tick,
+            int delta) override
+    {
+        const FixedId begin(IdTraits<FixedId>::from(m_id));
+        assert(global >= begin && global - begin < m_span);
+        const std::size_t tube(static_cast<std::size_t>(global - begin));
+        return cell(tube, tick).count(delta);
     }
 
     virtual uint64_t get(const Id& id, uint64_t tick) const override
     {
-        const HierarchyTube& tube(m_tubes.at(normalize(id).getSimple()));
-        const auto it(tube.find(tick));
-        if (it != tube.end()) return it->second->val();
+        const std::size_t tube(normalize(id).getSimple());
+        if (tube >= m_span) throw std::out_of_range("Invalid hierarchy id");
+
+        if (!tick) return m_dense[tube].val();
+        else if (const HierarchyCell* c = m_ticks.find(tube, tick))
+        {
+            return c->val();
+        }
         else return 0;
     }
 
+    // Adds the counts of another block which covers the same span.
     void merge(const ContiguousBlock& other)
     {
-        for (std::size_t tube(0); tube < other.m_tubes.size(); ++tube)
+        const std::size_t offset((other.id() - id()).getSimple());
+
+        for (std::size_t tube(0); tube < other.m_span; ++tube)
         {
-            for (const auto& cell : other.m_tubes[tube])
+            if (const uint64_t val = other.m_dense[tube].val())
             {
-                count(other.id() + tube, cell.first, cell.second->val());
+                m_dense[offset + tube].count(val);
             }
         }
+
+        other.m_ticks.forEach([this, offset](
+                    uint64_t tube,
+                    uint64_t tick,
+                    uint64_t val)
+        {
+            m_ticks.at(offset + tube, tick).count(val);
+        });
     }
 
-    const std::vector<HierarchyTube>& tubes() const { return m_tubes; }
+    // Calls f(std::size_t tube, uint64_t tick, uint64_t val) for each nonzero
+    // counter, ordered by normalized tube and then by tick.
+    template<typename F> void forEach(F f) const
+    {
+        using Entry = std::tuple<uint64_t, uint64_t, uint64_t>;
+        std::vector<Entry> ticks;
+
+        m_ticks.forEach([&ticks](uint64_t tube, uint64_t tick, uint64_t val)
+        {
+            if (val) ticks.emplace_back(tube, tick, val);
+        });
+
+        std::sort(ticks.begin(), ticks.end());
+        auto it(ticks.begin());
+
+        for (std::size_t tube(0); tube < m_span; ++tube)
+        {
+            if (const uint64_t val = m_dense[tube].val()) f(tube, 0, val);
+
+            for ( ; it != ticks.end() && std::get<0>(*it) == tube; ++it)
+            {
+                f(tube, std::get<1>(*it), std::get<2>(*it));
+            }
+        }
+    }
 
 protected:
     void append(ContiguousBlock& other)
@@ -247,28 +404,54 @@ protected:
             throw std::runtime_error("Hierarchy merge must be consecutive");
         }
 
-        m_maxPoints += other.tubes().size();
-        m_tubes.insert(
-                m_tubes.end(),
-                std::make_move_iterator(other.tubes().begin()),
-                std::make_move_iterator(other.tubes().end()));
+        const std::size_t offset(m_span);
+        std::unique_ptr<HierarchyCell[]> dense(
+                new HierarchyCell[m_span + other.m_span]);
+
+        for (std::size_t i(0); i < m_span; ++i) dense[i] = m_dense[i];
+        for (std::size_t i(0); i < other.m_span; ++i)
+        {
+            dense[offset + i] = other.m_dense[i];
+        }
+
+        other.m_ticks.forEach([this, offset](
+                    uint64_t tube,
+                    uint64_t tick,
+                    uint64_t val)
+        {
+            m_ticks.at(offset + tube, tick).count(val);
+        });
+
+        m_dense = std::move(dense);
+        m_span += other.m_span;
+        m_maxPoints += other.m_span;
+
+        other.clear();
     }
 
     void clear()
     {
         m_id = endId();
         m_maxPoints = 0;
-        m_tubes.clear();
+        m_span = 0;
+        m_dense.reset();
+        m_ticks = HierarchyTicks();
     }
 
 private:
     virtual std::vector<char> combine() override;
 
+    HierarchyCell& cell(std::size_t tube, uint64_t tick)
+    {
+        if (tube >= m_span) throw std::out_of_range("Invalid hierarchy id");
+        return tick ? m_ticks.at(tube, tick) : m_dense[tube];
+    }
+
     bool empty() const;
-    std::vector<HierarchyTube>& tubes() { return m_tubes; }
 
-    std::vector<HierarchyTube> m_tubes;
-    std::vector<SpinLock> m_spinners;
+    std::size_t m_span;
+    std::unique_ptr<HierarchyCell[]> m_dense;
+    HierarchyTicks m_ticks;
 };
 
 
@@ -297,6 +480,16 @@ public:
         return m_blocks.at(depth).count(id, tick, delta);
     }
 
+    virtual HierarchyCell& countFixed(
+            const FixedId& id,
+            uint64_t tick,
+            int delta) override
+    {
+        const std::size_t depth(
+                ChunkInfo::calcDepth(static_cast<std::size_t>(id)));
+        return m_blocks.at(depth).countFixed(id, tick, delta);
+    }
+
     virtual uint64_t get(const Id& id, uint64_t tick) const override
     {
         const std::size_t depth(ChunkInfo::calcDepth(id.getSimple()));
@@ -26,6 +26,24 @@ namespace
     const bool shallow(
             env("TESTING_SHALLOW") &&
             *env("TESTING_SHALLOW") == "true");
+
+    HierarchyCell& countIn(
+            HierarchyBlock& block,
+            const PointState& pointState,
+            const int delta)
+    {
+        if (pointState.fixed())
+        {
+            return block.countFixed(
+                    pointState.fixedIndex(),
+                    pointState.tick(),
+                    delta);
+        }
+        else
+        {
+            return block.count(pointState.index(), pointState.tick(), delta);
+        }
+    }
 }
 
 Hierarchy::Hierarchy(
@@ -88,11 +106,11 @@ HierarchyCell& Hierarchy::count(const PointState& pointState, const int delta)
 {
     if (m_structure.isWithinBase(pointState.depth()))
     {
-        return m_base.t->count(pointState.index(), pointState.tick(), delta);
+        return countIn(*m_base.t, pointState, delta);
     }
     else
     {
-        auto& slot(getOrCreate(pointState.chunkId(), pointState.chunkNum()));
+        auto& slot(getOrCreate(pointState));
         std::unique_ptr<HierarchyBlock>& block(slot.t);
 
         SpinGuard lock(slot.spinner);
@@ -122,7 +140,7 @@ HierarchyCell& Hierarchy::count(const PointState& pointState, const int delta)
             }
         }
 
-        return block->count(pointState.index(), pointState.tick(), delta);
+        return countIn(*block, pointState, delta);
     }
 }
 
@@ -293,24 +311,18 @@ void Hierarchy::rebase(const arbiter::Endpoint& ep, std::size_t depth)
     for (const auto& block : base.blocks())
     {
         const auto id(block.id());
-        for (std::size_t i(0); i < block.tubes().size(); ++i)
+        block.forEach([&](uint64_t tube, uint64_t tick, uint64_t val)
         {
-            for (const auto& entry : block.tubes().at(i))
+            if (curDepth < outMeta.hierarchyStructure().coldDepthBegin())
             {
-                if (curDepth < outMeta.hierarchyStructure().coldDepthBegin())
-                {
-                    outHier.countBase(
-                            id.getSimple() + i,
-                            entry.first,
-                            entry.second->val());
-                }
-                else
-                {
-                    ChunkInfo c(outMeta.hierarchyStructure(), id + i);
-                    outHier.count(c, entry.first, entry.second->val());
-                }
+                outHier.countBase(id.getSimple() + tube, tick, val);
             }
-        }
+            else
+            {
+                ChunkInfo c(outMeta.hierarchyStructure(), id + tube);
+                outHier.count(c, tick, val);
+            }
+        });
 
         ++curDepth;
     }
@@ -14,11 +14,13 @@
 
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/config-parser.hpp>
+#include <entwine/tree/heuristics.hpp>
 #include <entwine/tree/thread-pools.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/types/pooled-point-table.hpp>
 #include <entwine/util/executor.hpp>
 #include <entwine/util/matrix.hpp>
+#include <entwine/util/range-reader.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
@@ -187,7 +189,12 @@ void Inference::go()
                 m_pool->add([&f, this]()
                 {
                     auto localHandle(
-                        m_arbiter->getLocalHandle(f.path(), m_tmp));
+                        LocalFile::fetch(
+                            *m_arbiter,
+                            f.path(),
+                            m_tmp,
+                            heuristics::rangeBlockSize,
+                            heuristics::rangeReadAhead));
 
                     add(localHandle->localPath(), f);
                 });
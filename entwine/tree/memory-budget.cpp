@@ -0,0 +1,110 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/memory-budget.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include <entwine/tree/chunk.hpp>
+#include <entwine/tree/cooler.hpp>
+#include <entwine/tree/heuristics.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    int64_t nowMs()
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+MemoryBudget::MemoryBudget(
+        const std::size_t bytes,
+        PointPool& pointPool,
+        HierarchyCell::Pool& hierarchyPool,
+        const Cooler& cooler)
+    : m_bytes(bytes)
+    , m_pointPool(pointPool)
+    , m_hierarchyPool(hierarchyPool)
+    , m_cooler(cooler)
+    , m_epoch(0)
+    , m_trimmed(0)
+    , m_last(0)
+    , m_floored(false)
+{ }
+
+std::size_t MemoryBudget::usage() const
+{
+    const std::size_t pointSize(m_pointPool.schema().pointSize());
+
+    return
+        m_pointPool.dataPool().used() * (pointSize + sizeof(Data::RawNode)) +
+        m_pointPool.cellPool().used() * sizeof(Cell::RawNode) +
+        m_hierarchyPool.used() * sizeof(HierarchyCell::Pool::NodeType) +
+        Chunk::count() * heuristics::chunkOverhead +
+        m_cooler.bytes();
+}
+
+bool MemoryBudget::due()
+{
+    const int64_t now(nowMs());
+    int64_t last(m_last);
+
+    return
+        now - last >= static_cast<int64_t>(heuristics::budgetInterval) &&
+        m_last.compare_exchange_strong(last, now);
+}
+
+void MemoryBudget::apply()
+{
+    if (usage() >= m_bytes * heuristics::budgetHighWater && due())
+    {
+        ++m_epoch;
+        m_trimmed += m_pointPool.dataPool().trim();
+    }
+}
+
+void MemoryBudget::throttle() const
+{
+    const std::chrono::milliseconds poll(heuristics::budgetPoll);
+    std::size_t waited(0);
+    std::size_t last(usage());
+
+    while (last > m_bytes && waited < heuristics::budgetWait)
+    {
+        std::this_thread::sleep_for(poll);
+        waited += heuristics::budgetPoll;
+
+        // Once eviction stops lowering our usage, what remains is held by
+        // the build itself - resident chunks and hierarchy - so waiting for
+        // it would only stall us.
+        const std::size_t current(usage());
+        if (current >= last)
+        {
+            if (!m_floored.exchange(true))
+            {
+                std::cout << "Memory budget of " << m_bytes <<
+                    " bytes is below the " << current <<
+                    " held by the build - not waiting for it" << std::endl;
+            }
+            return;
+        }
+
+        last = current;
+    }
+}
+
+} // namespace entwine
+
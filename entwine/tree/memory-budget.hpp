@@ -0,0 +1,81 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include <entwine/tree/hierarchy-block.hpp>
+#include <entwine/types/point-pool.hpp>
+
+namespace entwine
+{
+
+class Cooler;
+
+// A builder-wide limit on the memory held by pooled points, cells, hierarchy
+// nodes, live chunks, and cooled chunks.  Since pools never shrink, the budget is enforced
+// by applying back-pressure to the inserting threads rather than by refusing
+// allocations:
+//
+//  - Near the budget, the pressure epoch is bumped, which every Clipper
+//    notices at its next batch and responds to by evicting its idle chunks.
+//    The free memory of the point pool is returned to the operating system.
+//
+//  - Over the budget, inserting threads wait before refilling their point
+//    tables until evicted chunks have been serialized and their points freed,
+//    for as long as doing so keeps lowering our usage.
+class MemoryBudget
+{
+public:
+    MemoryBudget(
+            std::size_t bytes,
+            PointPool& pointPool,
+            HierarchyCell::Pool& hierarchyPool,
+            const Cooler& cooler);
+
+    std::size_t bytes() const { return m_bytes; }
+
+    // Estimated bytes currently in use.
+    std::size_t usage() const;
+
+    // Incremented each time pressure is applied.
+    std::size_t epoch() const { return m_epoch; }
+
+    // Total bytes handed back to the operating system so far.
+    std::size_t trimmed() const { return m_trimmed; }
+
+    // Called by inserting threads between batches.  First, pressure is
+    // applied if we are near the budget.  After evicting their chunks if the
+    // epoch has changed, those threads then throttle, waiting while we are
+    // over the budget and our usage is falling.
+    void apply();
+    void throttle() const;
+
+private:
+    bool due();
+
+    const std::size_t m_bytes;
+    PointPool& m_pointPool;
+    HierarchyCell::Pool& m_hierarchyPool;
+    const Cooler& m_cooler;
+
+    std::atomic_size_t m_epoch;
+    std::atomic_size_t m_trimmed;
+    std::atomic<int64_t> m_last;
+
+    // Set once we have found our usage over the budget without falling.
+    mutable std::atomic<bool> m_floored;
+};
+
+} // namespace entwine
+
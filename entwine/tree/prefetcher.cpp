@@ -0,0 +1,195 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/prefetcher.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+
+Prefetcher::Prefetcher(
+        const arbiter::Arbiter& arbiter,
+        const arbiter::Endpoint& tmp,
+        const std::size_t depth,
+        const std::size_t budget,
+        const bool verbose)
+    : m_arbiter(arbiter)
+    , m_tmp(tmp)
+    , m_depth(depth)
+    , m_budget(budget)
+    , m_verbose(verbose)
+    , m_mutex()
+    , m_cv()
+    , m_entries()
+    , m_bytes(0)
+    , m_fetched(0)
+    , m_pool()
+{
+    if (m_depth)
+    {
+        m_pool.reset(
+                new Pool(
+                    std::min(m_depth, heuristics::prefetchThreads),
+                    m_depth));
+    }
+}
+
+Prefetcher::~Prefetcher()
+{
+    if (m_pool) m_pool->join();
+}
+
+void Prefetcher::push(const Origin origin, const std::string& path)
+{
+    if (!m_pool || !m_arbiter.isRemote(path)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_entries[origin];
+    }
+
+    m_pool->add([this, origin, path]()
+    {
+        Entry fetched;
+
+        try
+        {
+            fetched.handle = fetch(path);
+
+            if (auto size = m_arbiter.tryGetSize(fetched.handle->localPath()))
+            {
+                fetched.bytes = *size;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            fetched.error = e.what();
+        }
+        catch (...)
+        {
+            fetched.error = "Unknown error fetching " + path;
+        }
+
+        fetched.ready = true;
+        ++m_fetched;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_bytes += fetched.bytes;
+        m_entries.at(origin) = std::move(fetched);
+        m_cv.notify_all();
+    });
+}
+
+std::unique_ptr<LocalFile> Prefetcher::take(
+        const Origin origin,
+        const std::string& path)
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        auto it(m_entries.find(origin));
+
+        if (it != m_entries.end())
+        {
+            Entry& entry(it->second);
+            m_cv.wait(lock, [&entry]() { return entry.ready; });
+
+            if (!entry.handle) throw std::runtime_error(entry.error);
+            return std::move(entry.handle);
+        }
+    }
+
+    return fetch(path);
+}
+
+void Prefetcher::release(const Origin origin)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it(m_entries.find(origin));
+
+    if (it != m_entries.end())
+    {
+        m_bytes -= it->second.bytes;
+        m_entries.erase(it);
+        m_cv.notify_all();
+    }
+}
+
+bool Prefetcher::full() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return overBudget();
+}
+
+void Prefetcher::await() const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return !overBudget(); });
+}
+
+std::size_t Prefetcher::bytes() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_bytes;
+}
+
+std::unique_ptr<LocalFile> Prefetcher::fetch(
+        const std::string& path) const
+{
+    std::size_t tries(0);
+    std::unique_ptr<LocalFile> localHandle;
+
+    do
+    {
+        if (tries) std::this_thread::sleep_for(std::chrono::seconds(tries));
+
+        try
+        {
+            localHandle = LocalFile::fetch(
+                    m_arbiter,
+                    path,
+                    m_tmp,
+                    heuristics::rangeBlockSize,
+                    heuristics::rangeReadAhead);
+        }
+        catch (const std::exception& e)
+        {
+            if (m_verbose)
+            {
+                std::cout <<
+                    "Failed GET " << tries << " of " << path << ": " <<
+                    e.what() << std::endl;
+            }
+        }
+        catch (...)
+        {
+            if (m_verbose)
+            {
+                std::cout <<
+                    "Failed GET " << tries << " of " << path << ": " <<
+                    "unknown error" << std::endl;
+            }
+        }
+    }
+    while (!localHandle && ++tries < heuristics::inputRetryLimit);
+
+    if (!localHandle) throw std::runtime_error("No local handle: " + path);
+
+    return localHandle;
+}
+
+} // namespace entwine
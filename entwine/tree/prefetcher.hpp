@@ -0,0 +1,113 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/util/range-reader.hpp>
+
+namespace entwine
+{
+
+class Pool;
+
+// Downloads remote inputs into the temporary endpoint ahead of their
+// insertion, so inserting threads only pick up files which are already local.
+// Inputs are pushed as they are scheduled, and fetched in the background by
+// up to heuristics::prefetchThreads threads.  An input's local copy counts
+// against our budget from the time it is fetched until it is released after
+// insertion - the caller is expected to stop pushing while we are full.
+//
+// Local inputs, and any input when our depth is zero, are not prefetched -
+// they are fetched when taken.
+class Prefetcher
+{
+public:
+    Prefetcher(
+            const arbiter::Arbiter& arbiter,
+            const arbiter::Endpoint& tmp,
+            std::size_t depth,
+            std::size_t budget,
+            bool verbose = false);
+
+    ~Prefetcher();
+
+    // The number of inputs which may be fetched ahead of those being
+    // inserted, and the limit of bytes held by fetched inputs - zero if
+    // unlimited.
+    std::size_t depth() const { return m_depth; }
+    std::size_t budget() const { return m_budget; }
+
+    // Begin fetching this input in the background.
+    void push(Origin origin, const std::string& path);
+
+    // A local handle to this input, waiting for its fetch if it was pushed,
+    // or fetching it now otherwise.  Throws if it could not be fetched.
+    std::unique_ptr<LocalFile> take(
+            Origin origin,
+            const std::string& path);
+
+    // The local copy of this input has been consumed - its bytes no longer
+    // count against our budget.
+    void release(Origin origin);
+
+    // True if our fetched inputs hold at least our budget.  Once every pushed
+    // input has been handed out for insertion, await may be called to wait
+    // until enough of them are released.
+    bool full() const;
+    void await() const;
+
+    // Bytes held by fetched inputs.
+    std::size_t bytes() const;
+
+    // Count of inputs which were fetched in the background.
+    std::size_t fetched() const { return m_fetched; }
+
+private:
+    std::unique_ptr<LocalFile> fetch(
+            const std::string& path) const;
+
+    bool overBudget() const { return m_budget && m_bytes >= m_budget; }
+
+    struct Entry
+    {
+        Entry() : ready(false), handle(), error(), bytes(0) { }
+
+        bool ready;
+        std::unique_ptr<LocalFile> handle;
+        std::string error;
+        std::size_t bytes;
+    };
+
+    const arbiter::Arbiter& m_arbiter;
+    const arbiter::Endpoint& m_tmp;
+    const std::size_t m_depth;
+    const std::size_t m_budget;
+    const bool m_verbose;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    std::map<Origin, Entry> m_entries;
+    std::size_t m_bytes;
+    std::atomic_size_t m_fetched;
+
+    std::unique_ptr<Pool> m_pool;
+};
+
+} // namespace entwine
@@ -0,0 +1,117 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/residency.hpp>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/point-pool.hpp>
+
+namespace entwine
+{
+
+Residency::Residency(const std::size_t pointSize)
+    : m_pointSize(pointSize)
+    , m_mutex()
+    , m_entries()
+    , m_order()
+    , m_clock(0)
+    , m_idle(0)
+    , m_saves(0)
+    , m_reloads(0)
+    , m_revivals(0)
+{ }
+
+std::size_t Residency::bytes(const std::size_t numPoints) const
+{
+    return
+        numPoints *
+            (m_pointSize + sizeof(Data::RawNode) + sizeof(Cell::RawNode)) +
+        heuristics::chunkOverhead;
+}
+
+void Residency::release(
+        const Id& chunkId,
+        const std::size_t chunkNum,
+        const std::size_t points)
+{
+    const std::size_t size(bytes(points));
+
+    // A save followed by a reload moves the whole chunk twice, on top of the
+    // fixed latency of each request.
+    const double cost(2.0 * size + heuristics::chunkReloadCost);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it(m_entries.find(chunkId));
+    if (it != m_entries.end()) erase(it);
+
+    Entry entry;
+    entry.chunkNum = chunkNum;
+    entry.bytes = size;
+    entry.orderIt = m_order.insert(
+            std::make_pair(m_clock + cost / size, chunkId));
+
+    m_entries.insert(std::make_pair(chunkId, entry));
+    m_idle += size;
+}
+
+void Residency::revive(const Id& chunkId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it(m_entries.find(chunkId));
+    if (it != m_entries.end())
+    {
+        erase(it);
+        ++m_revivals;
+    }
+}
+
+void Residency::forget(const Id& chunkId)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it(m_entries.find(chunkId));
+    if (it != m_entries.end()) erase(it);
+}
+
+std::vector<Residency::Victim> Residency::take(const std::size_t target)
+{
+    std::vector<Victim> victims;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    while (m_idle > target && !m_order.empty())
+    {
+        m_clock = m_order.begin()->first;
+
+        auto it(m_entries.find(m_order.begin()->second));
+        victims.emplace_back(it->first, it->second.chunkNum);
+        erase(it);
+    }
+
+    return victims;
+}
+
+std::size_t Residency::idle() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_idle;
+}
+
+void Residency::erase(const std::map<Id, Entry>::iterator it)
+{
+    m_idle -= it->second.bytes;
+    m_order.erase(it->second.orderIt);
+    m_entries.erase(it);
+}
+
+} // namespace entwine
+
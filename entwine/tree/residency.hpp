@@ -0,0 +1,107 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <entwine/types/structure.hpp>
+
+namespace entwine
+{
+
+// Tracks, across every origin, the chunks which are still resident in memory
+// even though no Clipper holds a reference to them.  Rather than serializing
+// a chunk as soon as its last reference is released, it stays resident so a
+// neighboring origin which touches it soon afterward may take it back without
+// a save and reload.
+//
+// When the idle chunks outgrow their memory target, the least valuable ones
+// are chosen for serialization by a GreedyDual-Size policy.  The priority of
+// an idle chunk is the clock value at its release, plus the cost of reloading
+// it relative to its size.  Evicting a chunk advances the clock to its
+// priority, so chunks which have sat idle for a long time lose out to those
+// released recently, and small chunks, whose reload is dominated by a fixed
+// per-chunk latency, are kept over large ones.
+class Residency
+{
+public:
+    struct Victim
+    {
+        Victim(const Id& chunkId, std::size_t chunkNum)
+            : chunkId(chunkId)
+            , chunkNum(chunkNum)
+        { }
+
+        Id chunkId;
+        std::size_t chunkNum;
+    };
+
+    explicit Residency(std::size_t pointSize);
+
+    // Estimated memory footprint of a resident chunk of this many points.
+    std::size_t bytes(std::size_t numPoints) const;
+
+    // Called with the chunk's slot locked, as its last reference is released
+    // or as it is taken back.  Both are no-ops for chunks we do not track.
+    void release(const Id& chunkId, std::size_t chunkNum, std::size_t points);
+    void revive(const Id& chunkId);
+
+    // Called with the chunk's slot locked, after it has been serialized.
+    void forget(const Id& chunkId);
+
+    // Remove and return the least valuable idle chunks until no more than
+    // target bytes of them remain.  The caller must still check, with the
+    // slot locked, that each victim has not been taken back in the meantime.
+    std::vector<Victim> take(std::size_t target);
+
+    // Bytes held by idle chunks.
+    std::size_t idle() const;
+
+    // Counts of chunk serializations, loads of serialized chunks, and idle
+    // chunks which were taken back before they needed to be serialized.
+    void saved() { ++m_saves; }
+    void reloaded() { ++m_reloads; }
+
+    std::size_t saves() const { return m_saves; }
+    std::size_t reloads() const { return m_reloads; }
+    std::size_t revivals() const { return m_revivals; }
+
+private:
+    using Order = std::multimap<double, Id>;
+
+    struct Entry
+    {
+        std::size_t chunkNum;
+        std::size_t bytes;
+        Order::iterator orderIt;
+    };
+
+    void erase(std::map<Id, Entry>::iterator it);
+
+    const std::size_t m_pointSize;
+
+    mutable std::mutex m_mutex;
+    std::map<Id, Entry> m_entries;
+    Order m_order;
+    double m_clock;
+    std::size_t m_idle;
+
+    std::atomic_size_t m_saves;
+    std::atomic_size_t m_reloads;
+    std::atomic_size_t m_revivals;
+};
+
+} // namespace entwine
+
@@ -10,7 +10,12 @@
 
 #include <entwine/tree/sequence.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <utility>
 
 #include <entwine/types/bounds.hpp>
 #include <entwine/types/metadata.hpp>
@@ -21,47 +26,174 @@
 namespace entwine
 {
 
+namespace
+{
+    // Resolution, per axis, of the Hilbert curve used for scheduling.
+    const uint64_t hilbertSize(1 << 16);
+
+    uint64_t hilbertIndex(uint64_t x, uint64_t y)
+    {
+        uint64_t d(0);
+
+        for (uint64_t s(hilbertSize / 2); s > 0; s /= 2)
+        {
+            const uint64_t rx((x & s) > 0);
+            const uint64_t ry((y & s) > 0);
+
+            d += s * s * ((3 * rx) ^ ry);
+
+            if (!ry)
+            {
+                if (rx)
+                {
+                    x = hilbertSize - 1 - x;
+                    y = hilbertSize - 1 - y;
+                }
+
+                std::swap(x, y);
+            }
+        }
+
+        return d;
+    }
+
+    uint64_t hilbertIndex(const Bounds& bounds, const Point& p)
+    {
+        auto scale([](double v, double min, double max)
+        {
+            const double n((v - min) / (max - min));
+            return static_cast<uint64_t>(
+                    std::min(std::max(n, 0.0), 1.0) * (hilbertSize - 1));
+        });
+
+        return hilbertIndex(
+                scale(p.x, bounds.min().x, bounds.max().x),
+                scale(p.y, bounds.min().y, bounds.max().y));
+    }
+}
+
 Sequence::Sequence(Builder& builder)
     : m_metadata(*builder.m_metadata)
     , m_manifest(m_metadata.manifestPtr())
     , m_mutex(builder.mutex())
-    , m_origin(0)
-    , m_end(m_manifest ? m_manifest->size() : 0)
+    , m_order()
+    , m_index(0)
+    , m_end(0)
     , m_added(0)
-    , m_overlaps()
 {
     if (!m_manifest) return;
 
+    // Unless told otherwise, continue with the schedule of our previous run.
+    std::string scheduling(builder.scheduling());
+    if (scheduling.empty()) scheduling = m_manifest->scheduling();
+    if (scheduling.empty()) scheduling = "manifest";
+
+    m_order = schedule(scheduling);
+    m_end = m_order.size();
+
+    // Our own order needs no record, and replaces any stored one.
+    if (scheduling == "manifest") m_manifest->order(OriginList(), "");
+    else m_manifest->order(m_order, scheduling);
+
     const Bounds activeBounds(
             m_metadata.subset() ?
                 *m_metadata.boundsNativeSubset() :
                 m_metadata.boundsNativeCubic());
 
-    for (Origin i(m_origin); i < m_end; ++i)
+    std::vector<std::size_t> overlaps;
+
+    for (std::size_t i(0); i < m_order.size(); ++i)
     {
-        const FileInfo& f(m_manifest->get(i));
+        const FileInfo& f(m_manifest->get(m_order[i]));
         const Bounds* b(f.boundsEpsilon());
 
         if (!b || activeBounds.overlaps(*b, true))
         {
-            m_overlaps.push_back(i);
+            overlaps.push_back(i);
         }
     }
 
     if (builder.verbose() && m_metadata.subset())
     {
-        std::cout << "Overlaps: " << m_overlaps.size() << std::endl;
+        std::cout << "Overlaps: " << overlaps.size() << std::endl;
+    }
+
+    m_index = overlaps.empty() ? m_end : overlaps.front();
+}
+
+OriginList Sequence::schedule(const std::string& scheduling) const
+{
+    const std::size_t size(m_manifest->size());
+
+    OriginList order;
+    std::vector<bool> ordered(size, false);
+
+    if (scheduling == m_manifest->scheduling())
+    {
+        for (const Origin o : m_manifest->order())
+        {
+            if (o < size && !ordered[o])
+            {
+                order.push_back(o);
+                ordered[o] = true;
+            }
+        }
+    }
+
+    OriginList rest;
+    for (Origin o(0); o < size; ++o)
+    {
+        if (!ordered[o]) rest.push_back(o);
+    }
+
+    if (scheduling == "hilbert")
+    {
+        const Bounds& bounds(m_metadata.boundsNativeCubic());
+
+        // Origins without bounds go last.
+        const uint64_t none(std::numeric_limits<uint64_t>::max());
+        std::vector<uint64_t> keys(size, none);
+
+        for (const Origin o : rest)
+        {
+            if (const Bounds* b = m_manifest->get(o).bounds())
+            {
+                keys[o] = hilbertIndex(bounds, b->mid());
+            }
+        }
+
+        std::stable_sort(
+                rest.begin(),
+                rest.end(),
+                [&keys](Origin a, Origin b) { return keys[a] < keys[b]; });
+    }
+    else if (scheduling == "largest")
+    {
+        std::stable_sort(
+                rest.begin(),
+                rest.end(),
+                [this](Origin a, Origin b)
+                {
+                    return
+                        m_manifest->get(a).numPoints() >
+                        m_manifest->get(b).numPoints();
+                });
+    }
+    else if (scheduling != "manifest")
+    {
+        throw std::runtime_error("Invalid scheduling: " + scheduling);
     }
 
-    m_origin = m_overlaps.empty() ? m_end : m_overlaps.front();
+    order.insert(order.end(), rest.begin(), rest.end());
+    return order;
 }
 
 std::unique_ptr<Origin> Sequence::next(std::size_t max)
 {
     auto lock(getLock());
-    while (m_origin < m_end && (!max || m_added < max))
+    while (m_index < m_end && (!max || m_added < max))
     {
-        const Origin active(m_origin++);
+        const Origin active(m_order[m_index++]);
 
         if (checkInfo(active))
         {
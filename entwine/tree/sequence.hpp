@@ -22,6 +22,18 @@ class Builder;
 class Executor;
 class Metadata;
 
+// Hands out the origins of the manifest for insertion.  The order in which
+// they are handed out is chosen by the builder's scheduling policy:
+//
+//  - "manifest" (the default) - the order in which they appear in the
+//    manifest.
+//  - "hilbert" - along a Hilbert curve through the XY midpoints of their
+//    bounds, so consecutive origins tend to share chunks.
+//  - "largest" - in decreasing order of their point counts, so the largest
+//    files are not left to run alone at the end of the build.
+//
+// Any order other than that of the manifest is written into the manifest, so
+// a continued build resumes it unless given another policy.
 class Sequence
 {
     friend class Builder;
@@ -30,7 +42,7 @@ public:
     Sequence(Builder& builder);
 
     std::unique_ptr<Origin> next(std::size_t max);
-    bool done() const { auto l(getLock()); return m_origin < m_end; }
+    bool done() const { auto l(getLock()); return m_index < m_end; }
 
     // Stop this build as soon as possible.  All partially inserted paths will
     // be completed, and non-inserted paths can be added by continuing this
@@ -38,7 +50,7 @@ public:
     void stop()
     {
         auto l(getLock());
-        m_end = std::min(m_end, m_origin + 1);
+        m_end = std::min(m_end, m_index + 1);
         std::cout << "Stopping - setting end at " << m_end << std::endl;
     }
 
@@ -48,6 +60,10 @@ private:
         return std::unique_lock<std::mutex>(m_mutex);
     }
 
+    // Order the origins of our manifest according to this scheduling policy,
+    // keeping those already ordered by it, if any, at the front.
+    OriginList schedule(const std::string& scheduling) const;
+
     bool checkInfo(Origin origin);
 
     bool checkBounds(
@@ -59,11 +75,11 @@ private:
     Manifest* m_manifest;
     std::mutex& m_mutex;
 
-    Origin m_origin;
-    Origin m_end;
+    // Our schedule, and our position within it.
+    OriginList m_order;
+    std::size_t m_index;
+    std::size_t m_end;
     std::size_t m_added;
-
-    std::vector<Origin> m_overlaps;
 };
 
 } // namespace entwine
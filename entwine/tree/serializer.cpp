@@ -0,0 +1,197 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/tree/serializer.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/chunk.hpp>
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/storage.hpp>
+#include <entwine/util/pool.hpp>
+#include <entwine/util/time.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    using Micros = std::chrono::microseconds;
+
+    std::unique_ptr<Pool> makePool(const std::size_t threads)
+    {
+        const std::size_t n(std::max<std::size_t>(threads, 1));
+        return std::unique_ptr<Pool>(
+                new Pool(n, n * heuristics::serializeQueueFactor));
+    }
+}
+
+Serializer::Serializer(
+        const Storage& storage,
+        const arbiter::Endpoint& out,
+        const std::size_t compressThreads,
+        const std::size_t uploadThreads)
+    : m_storage(storage)
+    , m_out(out)
+    , m_mutex()
+    , m_cv()
+    , m_inFlight()
+    , m_error()
+    , m_compressed()
+    , m_uploaded()
+    , m_uploadPool(makePool(uploadThreads))
+    , m_compressPool(makePool(compressThreads))
+{ }
+
+Serializer::~Serializer()
+{
+    m_compressPool->join();
+    m_uploadPool->join();
+}
+
+void Serializer::save(Chunk& chunk)
+{
+    if (!m_storage.pipelined())
+    {
+        m_storage.serialize(chunk);
+        return;
+    }
+
+    save(m_storage.pack(chunk));
+}
+
+void Serializer::save(std::unique_ptr<PackedChunk> owned)
+{
+    // Shared, since our pools' tasks must be copyable.
+    std::shared_ptr<PackedChunk> packed(std::move(owned));
+    const Id id(packed->id);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_inFlight[id];
+    }
+
+    const TimePoint queued(now());
+
+    m_compressPool->add([this, packed, id, queued]()
+    {
+        std::shared_ptr<std::vector<char>> data;
+
+        try
+        {
+            data = std::make_shared<std::vector<char>>(
+                    m_storage.encode(*packed));
+        }
+        catch (const std::exception& e)
+        {
+            finish(id, e.what());
+            return;
+        }
+        catch (...)
+        {
+            finish(id, "Unknown error");
+            return;
+        }
+
+        m_compressed.latency += since<Micros>(queued);
+        ++m_compressed.done;
+
+        const TimePoint encoded(now());
+
+        m_uploadPool->add([this, data, id, encoded]()
+        {
+            try
+            {
+                m_storage.upload(m_out, id, *data);
+            }
+            catch (const std::exception& e)
+            {
+                finish(id, e.what());
+                return;
+            }
+            catch (...)
+            {
+                finish(id, "Unknown error");
+                return;
+            }
+
+            m_uploaded.latency += since<Micros>(encoded);
+            ++m_uploaded.done;
+
+            finish(id);
+        });
+    });
+}
+
+void Serializer::finish(const Id& chunkId, const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (!error.empty() && m_error.empty())
+    {
+        m_error = "Could not write chunk " + chunkId.str() + ": " + error;
+    }
+
+    auto it(m_inFlight.find(chunkId));
+    if (!--it->second) m_inFlight.erase(it);
+    m_cv.notify_all();
+}
+
+void Serializer::await(const Id& chunkId) const
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this, &chunkId]() { return !m_inFlight.count(chunkId); });
+}
+
+void Serializer::flush()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.wait(lock, [this]() { return m_inFlight.empty(); });
+
+    if (!m_error.empty()) throw std::runtime_error(m_error);
+}
+
+std::size_t Serializer::compressThreads() const
+{
+    return m_compressPool->numThreads();
+}
+
+std::size_t Serializer::uploadThreads() const
+{
+    return m_uploadPool->numThreads();
+}
+
+Serializer::Stage Serializer::compressStage() const
+{
+    return stage(*m_compressPool, m_compressed);
+}
+
+Serializer::Stage Serializer::uploadStage() const
+{
+    return stage(*m_uploadPool, m_uploaded);
+}
+
+Serializer::Stage Serializer::stage(
+        const Pool& pool,
+        const Counter& counter) const
+{
+    Stage stage;
+    stage.queued = pool.queued();
+    stage.active = pool.active();
+    stage.done = counter.done;
+    stage.latency = Micros(stage.done ? counter.latency / stage.done : 0);
+    return stage;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,113 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <entwine/types/structure.hpp>
+
+namespace entwine
+{
+
+namespace arbiter { class Endpoint; }
+
+class Chunk;
+class Pool;
+class Storage;
+struct PackedChunk;
+
+// Writes out chunks in stages, each with its own bounded queue, rather than
+// serializing each one from start to finish on the thread that releases it.
+// A chunk is packed on the calling thread, which hands its points back to the
+// point pool, then encoded - including any compression - by our compression
+// workers, and finally uploaded by our upload workers.
+//
+// Storage types which are not pipelined are serialized synchronously.
+class Serializer
+{
+public:
+    // Progress through one of our stages.  Latency is the mean time from a
+    // chunk entering the stage's queue to the stage being done with it.
+    struct Stage
+    {
+        std::size_t queued;
+        std::size_t active;
+        std::size_t done;
+        std::chrono::microseconds latency;
+    };
+
+    Serializer(
+            const Storage& storage,
+            const arbiter::Endpoint& out,
+            std::size_t compressThreads,
+            std::size_t uploadThreads);
+
+    ~Serializer();
+
+    // Called with the chunk's slot locked, so the chunk may be destroyed as
+    // soon as this returns.  Blocks while the compression queue is full.
+    void save(Chunk& chunk);
+
+    // Queue a chunk whose points have already been packed, which is only
+    // valid if our storage is pipelined.
+    void save(std::unique_ptr<PackedChunk> packed);
+
+    // Wait until this chunk, if it is being written, has been uploaded - its
+    // slot must be locked so it is not saved again meanwhile.
+    void await(const Id& chunkId) const;
+
+    // Wait until every chunk has been uploaded, throwing if any of them
+    // could not be.
+    void flush();
+
+    std::size_t compressThreads() const;
+    std::size_t uploadThreads() const;
+
+    Stage compressStage() const;
+    Stage uploadStage() const;
+
+private:
+    struct Counter
+    {
+        Counter() : done(0), latency(0) { }
+
+        std::atomic_size_t done;
+        std::atomic<std::chrono::microseconds::rep> latency;
+    };
+
+    Stage stage(const Pool& pool, const Counter& counter) const;
+    void finish(const Id& chunkId, const std::string& error = "");
+
+    const Storage& m_storage;
+    const arbiter::Endpoint& m_out;
+
+    mutable std::mutex m_mutex;
+    mutable std::condition_variable m_cv;
+    std::map<Id, std::size_t> m_inFlight;
+    std::string m_error;
+
+    Counter m_compressed;
+    Counter m_uploaded;
+
+    // Our compression tasks feed the upload pool, so it must outlive them.
+    std::unique_ptr<Pool> m_uploadPool;
+    std::unique_ptr<Pool> m_compressPool;
+};
+
+} // namespace entwine
+
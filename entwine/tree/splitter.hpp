@@ -81,6 +81,16 @@ public:
         }
     }
 
+    // As above, for a climbing state, whose chunk ID is only needed if its
+    // chunk number is beyond our fast slots.
+    template<typename State>
+    Slot& getOrCreate(const State& state)
+    {
+        const std::size_t chunkNum(state.chunkNum());
+        if (chunkNum < m_fast.size()) return m_fast[chunkNum];
+        else return getOrCreate(state.chunkId(), chunkNum);
+    }
+
     Slot& at(const Id& chunkId, std::size_t chunkNum)
     {
         if (chunkNum < m_fast.size())
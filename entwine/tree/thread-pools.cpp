@@ -12,16 +12,145 @@
 
 #include <entwine/tree/thread-pools.hpp>
 
+#include <entwine/types/point-pool.hpp>
+
 namespace entwine
 {
 
 ThreadPools::ThreadPools(
         const std::size_t workThreads,
         const std::size_t clipThreads)
-    : m_workPool(std::max<std::size_t>(1, workThreads))
-    , m_clipPool(std::max<std::size_t>(4, clipThreads))
+    : m_workThreads(std::max<std::size_t>(1, workThreads))
+    , m_clipThreads(std::max<std::size_t>(4, clipThreads))
+    , m_workPool(m_workThreads)
+    , m_clipPool(m_clipThreads)
+    , m_stop(false)
 { }
 
+ThreadPools::~ThreadPools()
+{
+    stop();
+}
+
+void ThreadPools::adapt(std::shared_ptr<PointPool> pointPool)
+{
+    if (!pointPool && !adaptive()) return;
+
+    stop();
+
+    if (pointPool)
+    {
+        m_workPool.resize(size());
+        m_clipPool.resize(size());
+
+        m_workPool.limit(m_workThreads);
+        m_clipPool.limit(m_clipThreads);
+
+        m_stop = false;
+        m_monitor = std::thread([this, pointPool]() { monitor(*pointPool); });
+    }
+    else
+    {
+        m_workPool.resize(m_workThreads);
+        m_clipPool.resize(m_clipThreads);
+    }
+}
+
+void ThreadPools::stop()
+{
+    if (!m_monitor.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_cv.notify_all();
+    m_monitor.join();
+}
+
+void ThreadPools::monitor(PointPool& pointPool)
+{
+    using Clock = std::chrono::steady_clock;
+    const std::chrono::milliseconds interval(heuristics::rebalanceInterval);
+
+    auto last(Clock::now());
+    auto workBusy(m_workPool.busy());
+    auto clipBusy(m_clipPool.busy());
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_cv.wait_for(lock, interval, [this]() { return m_stop; }))
+    {
+        const auto now(Clock::now());
+        const auto workNow(m_workPool.busy());
+        const auto clipNow(m_clipPool.busy());
+
+        rebalance(
+                pointPool,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    now - last),
+                workNow - workBusy,
+                clipNow - clipBusy);
+
+        last = now;
+        workBusy = workNow;
+        clipBusy = clipNow;
+    }
+}
+
+void ThreadPools::rebalance(
+        PointPool& pointPool,
+        const std::chrono::nanoseconds elapsed,
+        const std::chrono::nanoseconds workBusy,
+        const std::chrono::nanoseconds clipBusy)
+{
+    // While joined, for example during saving or merging, leave things be.
+    if (!m_workPool.running() || !m_clipPool.running()) return;
+    if (!elapsed.count()) return;
+
+    const std::size_t work(m_workPool.limit());
+    const std::size_t clip(m_clipPool.limit());
+
+    // Fraction of each pool's thread-time spent running tasks.
+    const double span(elapsed.count());
+    const double workLoad(workBusy.count() / (span * work));
+    const double clipLoad(clipBusy.count() / (span * clip));
+
+    const auto& dataPool(pointPool.dataPool());
+    const double allocated(dataPool.allocated());
+    const bool pressure(
+            allocated &&
+            dataPool.available() / allocated < heuristics::rebalancePoolPressure);
+
+    // Blocked producers mean a pool's queue is full.
+    const bool clipSaturated(
+            m_clipPool.blocked() ||
+            clipLoad >= heuristics::rebalanceBusyHigh ||
+            (pressure && clipLoad >= heuristics::rebalanceBusyLow));
+
+    const bool workSaturated(
+            m_workPool.blocked() ||
+            workLoad >= heuristics::rebalanceBusyHigh);
+
+    if (clipSaturated && work > 1 && (!workSaturated || pressure))
+    {
+        // Serialization is falling behind - if memory is tight, insertion
+        // would stall waiting for it anyway.
+        m_clipPool.limit(clip + 1);
+        m_workPool.limit(work - 1);
+    }
+    else if (
+            workSaturated &&
+            !pressure &&
+            clipLoad < heuristics::rebalanceBusyLow &&
+            clip > 1)
+    {
+        m_workPool.limit(work + 1);
+        m_clipPool.limit(clip - 1);
+    }
+}
+
 std::size_t ThreadPools::getWorkThreads(
         const std::size_t total,
         const double workToClipRatio)
@@ -10,16 +10,26 @@
 
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 #include <entwine/tree/heuristics.hpp>
 #include <entwine/util/pool.hpp>
 
 namespace entwine
 {
 
+class PointPool;
+
 class ThreadPools
 {
 public:
     ThreadPools(std::size_t workThreads, std::size_t clipThreads);
+    ~ThreadPools();
 
     Pool& workPool() { return m_workPool; }
     Pool& clipPool() { return m_clipPool; }
@@ -29,7 +39,7 @@ public:
 
     std::size_t size() const
     {
-        return m_workPool.numThreads() + m_clipPool.numThreads();
+        return m_workThreads + m_clipThreads;
     }
 
     void join()
@@ -50,6 +60,14 @@ public:
         go();
     }
 
+    // If a point pool is given, let our threads move between the work and
+    // clip pools according to the load of each and the utilization of that
+    // point pool.  Both pools are then sized to our total thread count, and
+    // their limits determine the split, which starts out as given at
+    // construction.  With a null point pool, that static split is restored.
+    void adapt(std::shared_ptr<PointPool> pointPool);
+    bool adaptive() const { return m_monitor.joinable(); }
+
     static std::size_t getWorkThreads(
             const std::size_t total,
             double workToClipRatio = heuristics::defaultWorkToClipRatio);
@@ -59,8 +77,27 @@ public:
             double workToClipRatio = heuristics::defaultWorkToClipRatio);
 
 private:
+    void monitor(PointPool& pointPool);
+    void stop();
+
+    // Shift at most one thread between our pools, given the time each spent
+    // running tasks during the last interval.
+    void rebalance(
+            PointPool& pointPool,
+            std::chrono::nanoseconds elapsed,
+            std::chrono::nanoseconds workBusy,
+            std::chrono::nanoseconds clipBusy);
+
+    const std::size_t m_workThreads;
+    const std::size_t m_clipThreads;
+
     Pool m_workPool;
     Pool m_clipPool;
+
+    std::thread m_monitor;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stop;
 };
 
 } // namespace entwine
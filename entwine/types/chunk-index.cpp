@@ -0,0 +1,261 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/chunk-index.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <pdal/PointRef.hpp>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/binary-point-table.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/util/morton.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Larger values in a serialized index can only come from corrupt data.
+    const std::size_t maxBits(8);
+
+    std::size_t numCells(const std::size_t bits)
+    {
+        return std::size_t(1) << (3 * bits);
+    }
+
+    template<typename T>
+    void put(std::vector<char>& out, const T v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        out.insert(out.end(), pos, pos + sizeof(T));
+    }
+
+    template<typename T>
+    T get(const char* pos)
+    {
+        T v;
+        std::copy(pos, pos + sizeof(T), reinterpret_cast<char*>(&v));
+        return v;
+    }
+}
+
+ChunkIndex::ChunkIndex(
+        const Bounds& bounds,
+        const std::size_t bits,
+        std::vector<uint32_t> ends)
+    : m_bounds(bounds)
+    , m_bits(bits)
+    , m_ends(std::move(ends))
+{
+    if (m_bits > maxBits || m_ends.size() != numCells(m_bits))
+    {
+        throw std::runtime_error("Invalid chunk index size");
+    }
+
+    if (!std::is_sorted(m_ends.begin(), m_ends.end()))
+    {
+        throw std::runtime_error("Invalid chunk index offsets");
+    }
+}
+
+ChunkIndex ChunkIndex::build(
+        const Schema& schema,
+        const Bounds& bounds,
+        const std::size_t numPoints,
+        std::vector<char>& data)
+{
+    const std::size_t pointSize(schema.pointSize());
+
+    if (data.size() != numPoints * pointSize)
+    {
+        throw std::runtime_error("Invalid chunk data for index");
+    }
+    if (numPoints > UINT32_MAX)
+    {
+        throw std::runtime_error("Too many points to index chunk");
+    }
+
+    std::size_t bits(0);
+    while (
+            bits < heuristics::chunkIndexMaxBits &&
+            numCells(bits + 1) * heuristics::chunkIndexCellPoints <= numPoints)
+    {
+        ++bits;
+    }
+
+    ChunkIndex index(bounds, bits, std::vector<uint32_t>(numCells(bits), 0));
+
+    if (!bits)
+    {
+        index.m_ends.back() = numPoints;
+        return index;
+    }
+
+    BinaryPointTable table(schema);
+    pdal::PointRef pointRef(table, 0);
+
+    std::vector<uint32_t> cells(numPoints);
+    std::vector<uint32_t>& offsets(index.m_ends);
+
+    const char* pos(data.data());
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        table.setPoint(pos);
+
+        cells[i] = index.cell(
+                Point(
+                    pointRef.getFieldAs<double>(pdal::Dimension::Id::X),
+                    pointRef.getFieldAs<double>(pdal::Dimension::Id::Y),
+                    pointRef.getFieldAs<double>(pdal::Dimension::Id::Z)));
+
+        ++offsets[cells[i]];
+        pos += pointSize;
+    }
+
+    // Turn the counts into the offset at which each cell begins.
+    uint32_t begin(0);
+    for (uint32_t& offset : offsets)
+    {
+        const uint32_t count(offset);
+        offset = begin;
+        begin += count;
+    }
+
+    // Keep any spare capacity, which the caller may have reserved for a tail.
+    std::vector<char> sorted;
+    sorted.reserve(data.capacity());
+    sorted.resize(data.size());
+
+    pos = data.data();
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        std::copy(
+                pos,
+                pos + pointSize,
+                sorted.data() + offsets[cells[i]]++ * pointSize);
+        pos += pointSize;
+    }
+
+    // Having advanced past their points, each offset is now its cell's end.
+    data.swap(sorted);
+    return index;
+}
+
+ChunkIndex ChunkIndex::extract(const char* data, std::size_t& size)
+{
+    if (!size) throw std::runtime_error("Invalid chunk index size");
+
+    const std::size_t bits(static_cast<unsigned char>(data[size - 1]));
+    if (bits > maxBits || ChunkIndex::size(bits) > size)
+    {
+        throw std::runtime_error("Invalid chunk index size");
+    }
+
+    size -= ChunkIndex::size(bits);
+    const char* pos(data + size);
+
+    std::vector<uint32_t> ends(numCells(bits));
+    for (uint32_t& end : ends)
+    {
+        end = get<uint32_t>(pos);
+        pos += sizeof(uint32_t);
+    }
+
+    Point min, max;
+    for (std::size_t i(0); i < 3; ++i, pos += sizeof(double))
+    {
+        min[i] = get<double>(pos);
+    }
+    for (std::size_t i(0); i < 3; ++i, pos += sizeof(double))
+    {
+        max[i] = get<double>(pos);
+    }
+
+    return ChunkIndex(Bounds(min, max), bits, std::move(ends));
+}
+
+std::vector<char> ChunkIndex::toBytes() const
+{
+    std::vector<char> out;
+    out.reserve(size());
+
+    for (const uint32_t end : m_ends) put(out, end);
+    for (std::size_t i(0); i < 3; ++i) put(out, m_bounds.min()[i]);
+    for (std::size_t i(0); i < 3; ++i) put(out, m_bounds.max()[i]);
+    out.push_back(static_cast<char>(m_bits));
+
+    return out;
+}
+
+std::size_t ChunkIndex::size(const std::size_t bits)
+{
+    return numCells(bits) * sizeof(uint32_t) + 6 * sizeof(double) + 1;
+}
+
+std::vector<ChunkIndex::Range> ChunkIndex::ranges(const Bounds& query) const
+{
+    std::size_t lo[3];
+    std::size_t hi[3];
+    for (std::size_t i(0); i < 3; ++i)
+    {
+        lo[i] = cell(query.min()[i], i);
+        hi[i] = cell(query.max()[i], i);
+    }
+
+    std::vector<uint64_t> codes;
+    for (std::size_t z(lo[2]); z <= hi[2]; ++z)
+    {
+        for (std::size_t y(lo[1]); y <= hi[1]; ++y)
+        {
+            for (std::size_t x(lo[0]); x <= hi[0]; ++x)
+            {
+                codes.push_back(morton::encode(x, y, z));
+            }
+        }
+    }
+
+    std::sort(codes.begin(), codes.end());
+
+    std::vector<Range> result;
+    for (const uint64_t code : codes)
+    {
+        const std::size_t begin(code ? m_ends[code - 1] : 0);
+        const std::size_t end(m_ends[code]);
+        if (begin == end) continue;
+
+        if (!result.empty() && result.back().second == begin)
+        {
+            result.back().second = end;
+        }
+        else result.emplace_back(begin, end);
+    }
+
+    return result;
+}
+
+std::size_t ChunkIndex::cell(const double v, const std::size_t axis) const
+{
+    // Quantization is monotonic, so a point within a query box always falls
+    // in a cell between those of the box's corners.
+    const uint64_t q(
+            morton::quantize(v, m_bounds.min()[axis], m_bounds.max()[axis]));
+    return q >> (morton::bitsPerDim - m_bits);
+}
+
+std::size_t ChunkIndex::cell(const Point& p) const
+{
+    return morton::encode(cell(p.x, 0), cell(p.y, 1), cell(p.z, 2));
+}
+
+} // namespace entwine
+
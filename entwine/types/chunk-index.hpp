@@ -0,0 +1,85 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+
+namespace entwine
+{
+
+class Schema;
+
+// A coarse spatial index of the points of a chunk.  The bounds of the chunk
+// are split into a grid of 2^bits cells along each axis, and the points are
+// stored grouped by cell, with the cells in Morton order, so the points of
+// any run of consecutive cells are contiguous.  We hold the end offset of
+// each cell, so the points within any box may be found without looking at the
+// points themselves.
+//
+// Serialized as the cell ends, as 32-bit values, followed by the bounds and
+// then a byte holding the bit count, so it may be extracted from the end of a
+// chunk's tail.
+class ChunkIndex
+{
+public:
+    // Offsets of a run of points, as [begin, end).
+    using Range = std::pair<std::size_t, std::size_t>;
+
+    ChunkIndex(
+            const Bounds& bounds,
+            std::size_t bits,
+            std::vector<uint32_t> ends);
+
+    // Sort the packed points, in the given schema, into cell order and
+    // return their index.  The sort is stable, so points within a cell keep
+    // their relative order.
+    static ChunkIndex build(
+            const Schema& schema,
+            const Bounds& bounds,
+            std::size_t numPoints,
+            std::vector<char>& data);
+
+    // Extract an index from the end of the data, shrinking its size to
+    // exclude the index.
+    static ChunkIndex extract(const char* data, std::size_t& size);
+
+    std::vector<char> toBytes() const;
+
+    // Serialized size, in bytes, of an index of the given resolution.
+    static std::size_t size(std::size_t bits);
+    std::size_t size() const { return size(m_bits); }
+
+    const Bounds& bounds() const { return m_bounds; }
+    std::size_t bits() const { return m_bits; }
+    std::size_t numPoints() const { return m_ends.empty() ? 0 : m_ends.back(); }
+
+    // Runs of points whose cells overlap the query bounds, in offset order,
+    // with adjacent runs merged.  Every point within the query bounds lies
+    // within one of these runs, although not every point in them is within
+    // the query bounds.
+    std::vector<Range> ranges(const Bounds& query) const;
+
+private:
+    std::size_t cell(double v, std::size_t axis) const;
+    std::size_t cell(const Point& p) const;
+
+    Bounds m_bounds;
+    std::size_t m_bits;
+    std::vector<uint32_t> m_ends;
+};
+
+} // namespace entwine
+
@@ -10,10 +10,12 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
+#include <entwine/util/mapped-file.hpp>
 
 namespace entwine
 {
@@ -28,7 +30,8 @@ public:
         {
             m_tailFields = std::vector<TailField>{
                 TailField::NumPoints,
-                TailField::NumBytes
+                TailField::NumBytes,
+                TailField::Index
             };
         }
         else
@@ -42,43 +45,89 @@ public:
 
     virtual void write(Chunk& chunk) const override
     {
-        auto data(buildData(chunk));
-        const auto& schema(chunk.schema());
-        const std::size_t numPoints(data.size() / schema.pointSize());
-        append(data, buildTail(chunk, numPoints));
-        ensurePut(chunk, m_metadata.basename(chunk.id()), data);
+        auto packed(pack(chunk));
+        upload(chunk.builder().outEndpoint(), chunk.id(), encode(*packed));
+    }
+
+    virtual bool pipelined() const override { return true; }
+
+    virtual std::unique_ptr<PackedChunk> pack(Chunk& chunk) const override
+    {
+        return pack(chunk.id(), chunk.type(), chunk.bounds(), buildData(chunk));
+    }
+
+    virtual std::unique_ptr<PackedChunk> pack(
+            const Id& id,
+            const ChunkType type,
+            const Bounds& bounds,
+            std::vector<char> data) const override
+    {
+        const Schema& schema(m_metadata.schema());
+
+        std::unique_ptr<PackedChunk> packed(makeUnique<PackedChunk>());
+        packed->id = id;
+        packed->type = type;
+        packed->data = std::move(data);
+        packed->numPoints = packed->data.size() / schema.pointSize();
+
+        if (indexed())
+        {
+            // Base chunks are read by depth rather than by area, so are left
+            // in their order, as a single cell.
+            if (id >= m_metadata.structure().coldIndexBegin())
+            {
+                packed->index = std::make_shared<ChunkIndex>(
+                        ChunkIndex::build(
+                            schema,
+                            bounds,
+                            packed->numPoints,
+                            packed->data));
+            }
+            else
+            {
+                packed->index = std::make_shared<ChunkIndex>(
+                        bounds,
+                        0,
+                        std::vector<uint32_t>(1, packed->numPoints));
+            }
+        }
+
+        return packed;
+    }
+
+    virtual std::vector<char> encode(PackedChunk& packed) const override
+    {
+        std::vector<char> data(std::move(packed.data));
+        append(
+                data,
+                buildTail(
+                    packed.type,
+                    packed.numPoints,
+                    0,
+                    packed.index.get()));
+        return data;
     }
 
     virtual Cell::PooledStack read(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             PointPool& pool,
-            const Id& id) const override
+            const Id& id,
+            std::shared_ptr<const ChunkIndex>* index) const override
     {
-        auto data(io::ensureGet(out, m_metadata.basename(id)));
-        const Tail tail(*data, m_tailFields);
-        const char* pos(data->data());
-
         const Schema& schema(pool.schema());
         const std::size_t pointSize(schema.pointSize());
-        const std::size_t numPoints(data->size() / pointSize);
-        const std::size_t numBytes(data->size() + tail.size());
+
+        const auto file(view(out, id));
+        std::size_t size(file->size());
+        const Tail tail(strip(file->data(), size, pointSize));
+        if (index) *index = tail.index();
+
+        const std::size_t numPoints(size / pointSize);
+        const char* pos(file->data());
         BinaryPointTable table(schema);
         pdal::PointRef pointRef(table, 0);
 
-        if (pointSize * numPoints != data->size())
-        {
-            throw std::runtime_error("Invalid binary chunk size");
-        }
-        if (tail.numPoints() && tail.numPoints() != numPoints)
-        {
-            throw std::runtime_error("Invalid binary chunk numPoints");
-        }
-        if (tail.numBytes() && tail.numBytes() != numBytes)
-        {
-            throw std::runtime_error("Invalid binary chunk numBytes");
-        }
-
         Data::PooledStack dataStack(pool.dataPool().acquire(numPoints));
         Cell::PooledStack cellStack(pool.cellPool().acquire(numPoints));
 
@@ -96,6 +145,29 @@ public:
         return cellStack;
     }
 
+    virtual std::unique_ptr<MappedChunk> map(
+            const arbiter::Endpoint& out,
+            const Id& id) const override
+    {
+        std::unique_ptr<MappedChunk> chunk;
+
+        if (!out.isLocal()) return chunk;
+
+        auto file(view(out, id));
+        if (!file->mapped()) return chunk;
+
+        const std::size_t pointSize(m_metadata.schema().pointSize());
+        std::size_t size(file->size());
+        const Tail tail(strip(file->data(), size, pointSize));
+
+        chunk = makeUnique<MappedChunk>();
+        chunk->numPoints = size / pointSize;
+        chunk->index = tail.index();
+        chunk->data = file->data();
+        chunk->file = std::move(file);
+        return chunk;
+    }
+
     virtual Json::Value toJson() const override
     {
         Json::Value json;
@@ -104,8 +176,63 @@ public:
     }
 
 protected:
+    bool indexed() const
+    {
+        return
+            std::find(
+                m_tailFields.begin(),
+                m_tailFields.end(),
+                TailField::Index) != m_tailFields.end();
+    }
+
+    // Validates the tail of an uncompressed chunk, shrinking the size to
+    // exclude it, and returns the tail.
+    Tail strip(
+            const char* data,
+            std::size_t& size,
+            const std::size_t pointSize) const
+    {
+        const Tail tail(data, size, m_tailFields);
+
+        const std::size_t numPoints(size / pointSize);
+        const std::size_t numBytes(size + tail.size());
+
+        if (pointSize * numPoints != size)
+        {
+            throw std::runtime_error("Invalid binary chunk size");
+        }
+        if (tail.numPoints() && tail.numPoints() != numPoints)
+        {
+            throw std::runtime_error("Invalid binary chunk numPoints");
+        }
+        if (tail.numBytes() && tail.numBytes() != numBytes)
+        {
+            throw std::runtime_error("Invalid binary chunk numBytes");
+        }
+
+        return tail;
+    }
+
     std::vector<char> buildData(Chunk& chunk) const
     {
+#ifdef ENTWINE_SLAB_TUBE
+        // Without any dead records, the slab is already in our format.
+        const PointSlab& slab(chunk.slab());
+        if (!slab.dead())
+        {
+            std::vector<char> data;
+            data.reserve(
+                    slab.size() * slab.pointSize() + tailSize(0));
+
+            slab.forEachBlock([&data, &slab](const char* d, std::size_t n)
+            {
+                data.insert(data.end(), d, d + n * slab.pointSize());
+            });
+
+            return data;
+        }
+#endif
+
         Cell::PooledStack cellStack(chunk.acquire());
         Data::PooledStack dataStack(chunk.pool().dataPool());
         for (Cell& cell : cellStack) dataStack.push(cell.acquire());
@@ -115,8 +242,7 @@ protected:
 
         std::vector<char> data;
         data.reserve(
-                dataStack.size() * pointSize +
-                buildTail(chunk, dataStack.size()).size());
+                dataStack.size() * pointSize + tailSize(0));
 
         for (const char* d : dataStack)
         {
@@ -126,38 +252,49 @@ protected:
         return data;
     }
 
-    std::vector<char> buildTail(
-            const Chunk& chunk,
-            const std::size_t numPoints,
-            std::size_t numBytes = 0) const
+    // The size of our tail, given the size of its index if it has one.
+    std::size_t tailSize(const std::size_t indexSize) const
     {
-        using Data = std::vector<char>;
-        Data tail;
-
-        std::size_t tailSize(0);
+        std::size_t size(0);
         for (TailField field : m_tailFields)
         {
             switch (field)
             {
                 case TailField::ChunkType:
-                    ++tailSize;
+                    ++size;
                     break;
                 case TailField::NumPoints:
                 case TailField::NumBytes:
-                    tailSize += 8;
+                    size += 8;
+                    break;
+                case TailField::Index:
+                    size += indexSize;
                     break;
             }
         }
 
-        if (!numBytes) numBytes = numPoints * chunk.schema().pointSize();
-        numBytes += tailSize;
+        return size;
+    }
+
+    // If our fields include an Index, the index must be given.
+    std::vector<char> buildTail(
+            const ChunkType type,
+            const std::size_t numPoints,
+            std::size_t numBytes = 0,
+            const ChunkIndex* index = nullptr) const
+    {
+        using Data = std::vector<char>;
+        Data tail;
+
+        if (!numBytes) numBytes = numPoints * m_metadata.schema().pointSize();
+        numBytes += tailSize(index ? index->size() : 0);
 
         for (TailField field : m_tailFields)
         {
             switch (field)
             {
                 case TailField::ChunkType:
-                    append(tail, Data{ static_cast<char>(chunk.type()) });
+                    append(tail, Data{ static_cast<char>(type) });
                     break;
                 case TailField::NumPoints:
                     append(tail, numPoints);
@@ -165,6 +302,10 @@ protected:
                 case TailField::NumBytes:
                     append(tail, numBytes);
                     break;
+                case TailField::Index:
+                    if (!index) throw std::runtime_error("Missing chunk index");
+                    append(tail, index->toBytes());
+                    break;
             }
         }
 
@@ -11,6 +11,7 @@
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
 
 #include <entwine/types/chunk-storage/binary.hpp>
+#include <entwine/types/chunk-storage/columnar.hpp>
 #include <entwine/types/chunk-storage/lazperf.hpp>
 #include <entwine/types/chunk-storage/laszip.hpp>
 #include <entwine/util/unique.hpp>
@@ -28,9 +29,25 @@ std::unique_ptr<ChunkStorage> ChunkStorage::create(
         case ChunkStorageType::LazPerf: return makeUnique<LazPerfStorage>(m, j);
         case ChunkStorageType::LasZip: return makeUnique<LasZipStorage>(m, j);
         case ChunkStorageType::Binary: return makeUnique<BinaryStorage>(m, j);
+        case ChunkStorageType::Columnar:
+            return makeUnique<ColumnarStorage>(m, j);
         default: throw std::runtime_error("Invalid chunk compression type");
     }
 }
 
+std::unique_ptr<FileView> ChunkStorage::view(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        const std::size_t tail) const
+{
+    if (const Packs* packs = m_metadata.storage().packs())
+    {
+        if (auto file = packs->view(out, id, tail)) return file;
+    }
+
+    if (tail) return FileView::last(out, filename(id), tail);
+    return makeUnique<FileView>(out, filename(id));
+}
+
 } // namespace entwine
 
@@ -14,9 +14,12 @@
 
 #include <entwine/tree/builder.hpp>
 #include <entwine/tree/chunk.hpp>
+#include <entwine/types/packs.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/types/storage.hpp>
 #include <entwine/types/storage-types.hpp>
 #include <entwine/util/io.hpp>
+#include <entwine/util/mapped-file.hpp>
 
 namespace entwine
 {
@@ -33,11 +36,95 @@ public:
             const Json::Value& json = Json::nullValue);
 
     virtual void write(Chunk& chunk) const = 0;
+
+    // The stages of write, which may be run separately, only supported by
+    // storage types for which pipelined() is true.  Packing gathers the
+    // chunk's points, handing them back to the point pool, and encoding
+    // consumes the packed data to produce the serialized chunk.
+    virtual bool pipelined() const { return false; }
+
+    virtual std::unique_ptr<PackedChunk> pack(Chunk& chunk) const
+    {
+        throw std::runtime_error("Chunk storage cannot be pipelined");
+    }
+
+    virtual std::vector<char> encode(PackedChunk& packed) const
+    {
+        throw std::runtime_error("Chunk storage cannot be pipelined");
+    }
+
+    // Like pack, for points which have already been gathered, in our native
+    // schema, from a chunk of the given type and bounds.
+    virtual std::unique_ptr<PackedChunk> pack(
+            const Id& id,
+            ChunkType type,
+            const Bounds& bounds,
+            std::vector<char> data) const
+    {
+        throw std::runtime_error("Chunk storage cannot be pipelined");
+    }
+
+    // Chunks are uploaded to their own files, unless they are packed.
+    void upload(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            const std::vector<char>& data) const
+    {
+        if (Packs* packs = m_metadata.storage().packs())
+        {
+            packs->put(out, id, data);
+        }
+        else
+        {
+            io::ensurePut(out, filename(id), data);
+        }
+    }
+
+    // Storage types which index their chunks sort the points of each cold
+    // chunk spatially, and store the index in its tail.  If index is given,
+    // it is set to the index parsed while reading, or nullptr if the chunk
+    // has none.
     virtual Cell::PooledStack read(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             PointPool& pool,
-            const Id& id) const = 0;
+            const Id& id,
+            std::shared_ptr<const ChunkIndex>* index) const = 0;
+
+    // Storage types for which projects() is true may read only some of the
+    // dimensions of a chunk, leaving the others zeroed, and fill in others
+    // later.  The cells to be filled must be in the order in which they were
+    // read.  Other types read every dimension.
+    virtual bool projects() const { return false; }
+
+    virtual Cell::PooledStack project(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const DimNames& dims,
+            std::shared_ptr<const ChunkIndex>* index) const
+    {
+        return read(out, tmp, pool, id, index);
+    }
+
+    virtual void fill(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            const DimNames& dims,
+            Cell::PooledStack& cells) const
+    {
+        throw std::runtime_error("Chunk storage cannot be projected");
+    }
+
+    // Storage types whose serialized points are in our native schema may
+    // serve them in place from a mapping of a local chunk.
+    virtual std::unique_ptr<MappedChunk> map(
+            const arbiter::Endpoint& out,
+            const Id& id) const
+    {
+        return std::unique_ptr<MappedChunk>();
+    }
 
     virtual Json::Value toJson() const { return Json::nullValue; }
     virtual std::string filename(const Id& id) const
@@ -46,6 +133,13 @@ public:
     }
 
 protected:
+    // The serialized chunk, from its pack if it has one.  If tail is non-zero,
+    // only the last tail bytes are needed, although more may be viewed.
+    std::unique_ptr<FileView> view(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            std::size_t tail = 0) const;
+
     void ensurePut(
             const Chunk& chunk,
             const std::string& path,
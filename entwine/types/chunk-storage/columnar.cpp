@@ -0,0 +1,300 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/chunk-storage/columnar.hpp>
+
+#include <algorithm>
+
+namespace entwine
+{
+
+namespace
+{
+    // Each directory entry is a codec byte and a 64-bit stream size.
+    const std::size_t entrySize(1 + sizeof(uint64_t));
+
+    bool isSigned(const DimInfo& dim)
+    {
+        return
+            pdal::Dimension::base(dim.type()) !=
+            pdal::Dimension::BaseType::Unsigned;
+    }
+
+    std::size_t offsetOf(const Schema& schema, const DimInfo& dim)
+    {
+        return schema.pdalLayout().dimOffset(dim.id());
+    }
+}
+
+ColumnarStorage::ColumnarStorage(const Metadata& m, const Json::Value& json)
+    : BinaryStorage(m, json)
+{
+    if (
+            std::find(
+                m_tailFields.begin(),
+                m_tailFields.end(),
+                TailField::NumPoints) == m_tailFields.end())
+    {
+        throw std::runtime_error("Columnar storage requires numPoints tail");
+    }
+}
+
+ColumnCodec ColumnarStorage::codec(const DimInfo& dim)
+{
+    const std::string name(dim.name());
+    const bool integral(
+            pdal::Dimension::base(dim.type()) !=
+            pdal::Dimension::BaseType::Floating);
+
+    if ((name == "X" || name == "Y" || name == "Z") && integral)
+    {
+        return ColumnCodec::Delta;
+    }
+    if (name == "GpsTime") return ColumnCodec::Delta;
+    if (name == "Classification") return ColumnCodec::RunLength;
+    return ColumnCodec::Lzma;
+}
+
+std::vector<char> ColumnarStorage::encode(PackedChunk& packed) const
+{
+    const std::vector<char> data(std::move(packed.data));
+    const Schema& schema(m_metadata.schema());
+    const std::size_t pointSize(schema.pointSize());
+    const std::size_t numPoints(packed.numPoints);
+
+    std::vector<char> out;
+    std::vector<char> directory;
+    std::vector<char> column;
+
+    for (const DimInfo& dim : schema.dims())
+    {
+        const std::size_t size(dim.size());
+        const char* pos(data.data() + offsetOf(schema, dim));
+
+        column.resize(numPoints * size);
+        for (std::size_t i(0); i < numPoints; ++i)
+        {
+            std::copy(pos, pos + size, column.data() + i * size);
+            pos += pointSize;
+        }
+
+        const ColumnCodec c(codec(dim));
+        const std::vector<char> stream(
+                ColumnCompression::encode(c, column, size, isSigned(dim)));
+
+        append(out, stream);
+        directory.push_back(static_cast<char>(c));
+        append(directory, stream.size());
+    }
+
+    append(out, directory);
+    append(out, schema.dims().size());
+    append(
+            out,
+            buildTail(packed.type, numPoints, out.size(), packed.index.get()));
+    return out;
+}
+
+Cell::PooledStack ColumnarStorage::read(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& id,
+        std::shared_ptr<const ChunkIndex>* index) const
+{
+    DimNames all;
+    for (const DimInfo& dim : m_metadata.schema().dims())
+    {
+        all.insert(dim.name());
+    }
+
+    return project(out, tmp, pool, id, all, index);
+}
+
+Cell::PooledStack ColumnarStorage::project(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& id,
+        const DimNames& dims,
+        std::shared_ptr<const ChunkIndex>* index) const
+{
+    const Schema& schema(pool.schema());
+    const std::size_t pointSize(schema.pointSize());
+
+    if (pointSize != m_metadata.schema().pointSize())
+    {
+        throw std::runtime_error("Invalid columnar chunk schema");
+    }
+
+    std::unique_ptr<FileView> file;
+    std::size_t numPoints(0);
+    const std::vector<Stream> s(streams(out, id, file, numPoints, index));
+
+    // Cells need their coordinates, regardless of what was asked for.
+    DimNames wanted(dims);
+    wanted.insert("X");
+    wanted.insert("Y");
+    wanted.insert("Z");
+
+    const bool partial(wanted.size() < schema.dims().size());
+
+    Data::PooledStack dataStack(pool.dataPool().acquire(numPoints));
+
+    std::vector<char*> points;
+    points.reserve(numPoints);
+
+    for (char* d : dataStack)
+    {
+        if (partial) std::fill(d, d + pointSize, 0);
+        points.push_back(d);
+    }
+
+    decode(s, &wanted, points);
+
+    Cell::PooledStack cellStack(pool.cellPool().acquire(numPoints));
+    BinaryPointTable table(schema);
+    pdal::PointRef pointRef(table, 0);
+
+    for (Cell& cell : cellStack)
+    {
+        Data::PooledNode dataNode(dataStack.popOne());
+        table.setPoint(*dataNode);
+        cell.set(pointRef, std::move(dataNode));
+    }
+
+    assert(dataStack.empty());
+    return cellStack;
+}
+
+void ColumnarStorage::fill(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        const DimNames& dims,
+        Cell::PooledStack& cells) const
+{
+    std::unique_ptr<FileView> file;
+    std::size_t numPoints(0);
+    const std::vector<Stream> s(streams(out, id, file, numPoints));
+
+    std::vector<char*> points;
+    points.reserve(numPoints);
+    for (Cell& cell : cells) points.push_back(cell.uniqueData());
+
+    if (points.size() != numPoints)
+    {
+        throw std::runtime_error("Invalid columnar chunk fill");
+    }
+
+    decode(s, &dims, points);
+}
+
+std::vector<ColumnarStorage::Stream> ColumnarStorage::streams(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        std::unique_ptr<FileView>& file,
+        std::size_t& numPoints,
+        std::shared_ptr<const ChunkIndex>* index) const
+{
+    file = view(out, id);
+    const char* data(file->data());
+    std::size_t size(file->size());
+
+    const Tail tail(data, size, m_tailFields);
+    const std::size_t numBytes(size + tail.size());
+    numPoints = tail.numPoints();
+    if (index) *index = tail.index();
+
+    if (tail.numBytes() && tail.numBytes() != numBytes)
+    {
+        throw std::runtime_error("Invalid columnar chunk numBytes");
+    }
+
+    const Schema& schema(m_metadata.schema());
+    const std::size_t numDims(schema.dims().size());
+
+    uint64_t count(0);
+    if (size < sizeof(uint64_t) + numDims * entrySize)
+    {
+        throw std::runtime_error("Invalid columnar chunk size");
+    }
+
+    const char* end(data + size - sizeof(uint64_t));
+    std::copy(end, end + sizeof(uint64_t), reinterpret_cast<char*>(&count));
+
+    if (count != numDims)
+    {
+        throw std::runtime_error("Invalid columnar chunk dimension count");
+    }
+
+    const char* entry(end - numDims * entrySize);
+    const char* pos(data);
+
+    std::vector<Stream> result;
+    result.reserve(numDims);
+
+    for (std::size_t i(0); i < numDims; ++i)
+    {
+        uint64_t size(0);
+        std::copy(
+                entry + 1,
+                entry + entrySize,
+                reinterpret_cast<char*>(&size));
+
+        result.push_back(Stream{ static_cast<ColumnCodec>(*entry), pos, size });
+        pos += size;
+        entry += entrySize;
+    }
+
+    if (pos != end - numDims * entrySize)
+    {
+        throw std::runtime_error("Invalid columnar chunk stream sizes");
+    }
+
+    return result;
+}
+
+void ColumnarStorage::decode(
+        const std::vector<Stream>& streams,
+        const DimNames* wanted,
+        std::vector<char*>& points) const
+{
+    const Schema& schema(m_metadata.schema());
+    const auto& dims(schema.dims());
+
+    for (std::size_t i(0); i < dims.size(); ++i)
+    {
+        const DimInfo& dim(dims[i]);
+        if (wanted && !wanted->count(dim.name())) continue;
+
+        const Stream& stream(streams.at(i));
+        const std::size_t size(dim.size());
+        const std::size_t offset(offsetOf(schema, dim));
+
+        const std::vector<char> column(
+                ColumnCompression::decode(
+                    stream.codec,
+                    stream.data,
+                    stream.size,
+                    points.size(),
+                    size,
+                    isSigned(dim)));
+
+        const char* pos(column.data());
+        for (char* point : points)
+        {
+            std::copy(pos, pos + size, point + offset);
+            pos += size;
+        }
+    }
+}
+
+} // namespace entwine
+
@@ -0,0 +1,92 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <entwine/types/chunk-storage/binary.hpp>
+#include <entwine/util/column-compression.hpp>
+
+namespace entwine
+{
+
+// Stores each dimension of a chunk as its own stream, in schema order, each
+// encoded by the codec suited to it - see ColumnCompression.  The streams are
+// followed by a directory of their codecs and sizes, the number of streams,
+// and the usual tail fields, so a reader may decode only the dimensions it
+// needs.
+class ColumnarStorage : public BinaryStorage
+{
+public:
+    ColumnarStorage(
+            const Metadata& m,
+            const Json::Value& json = Json::nullValue);
+
+    virtual std::vector<char> encode(PackedChunk& packed) const override;
+
+    virtual Cell::PooledStack read(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            std::shared_ptr<const ChunkIndex>* index) const override;
+
+    virtual bool projects() const override { return true; }
+
+    virtual Cell::PooledStack project(
+            const arbiter::Endpoint& out,
+            const arbiter::Endpoint& tmp,
+            PointPool& pool,
+            const Id& id,
+            const DimNames& dims,
+            std::shared_ptr<const ChunkIndex>* index) const override;
+
+    virtual void fill(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            const DimNames& dims,
+            Cell::PooledStack& cells) const override;
+
+    // Our streams must be decoded, so cannot be served in place, although
+    // local chunks are decoded straight from a mapping of their file.
+    virtual std::unique_ptr<MappedChunk> map(
+            const arbiter::Endpoint& out,
+            const Id& id) const override
+    {
+        return std::unique_ptr<MappedChunk>();
+    }
+
+    static ColumnCodec codec(const DimInfo& dim);
+
+private:
+    struct Stream
+    {
+        ColumnCodec codec;
+        const char* data;
+        std::size_t size;
+    };
+
+    // Fetch a chunk and locate its streams, which point into the file.
+    std::vector<Stream> streams(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            std::unique_ptr<FileView>& file,
+            std::size_t& numPoints,
+            std::shared_ptr<const ChunkIndex>* index = nullptr) const;
+
+    // Decode the wanted streams into the points, whose remaining dimensions
+    // are left untouched.
+    void decode(
+            const std::vector<Stream>& streams,
+            const DimNames* wanted,
+            std::vector<char*>& points) const;
+};
+
+} // namespace entwine
+
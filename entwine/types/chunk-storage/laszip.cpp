@@ -98,7 +98,8 @@ Cell::PooledStack LasZipStorage::read(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         PointPool& pool,
-        const Id& id) const
+        const Id& id,
+        std::shared_ptr<const ChunkIndex>* index) const
 {
     const std::string basename(m_metadata.basename(id) + ".laz");
     std::string localFile(out.prefixedRoot() + basename);
@@ -28,7 +28,8 @@ public:
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             PointPool& pool,
-            const Id& id) const override;
+            const Id& id,
+            std::shared_ptr<const ChunkIndex>* index) const override;
 
     virtual std::string filename(const Id& id) const override
     {
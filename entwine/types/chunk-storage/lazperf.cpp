@@ -15,27 +15,42 @@ namespace entwine
 
 void LazPerfStorage::write(Chunk& chunk) const
 {
-    const std::vector<char> data(buildData(chunk));
-    const auto& schema(chunk.schema());
+    auto packed(pack(chunk));
+    upload(chunk.builder().outEndpoint(), chunk.id(), encode(*packed));
+}
+
+std::vector<char> LazPerfStorage::encode(PackedChunk& packed) const
+{
+    const std::vector<char> data(std::move(packed.data));
+    const Schema& schema(m_metadata.schema());
 
     auto comp(Compression::compress(data.data(), data.size(), schema));
 
-    const std::size_t numPoints(data.size() / schema.pointSize());
-    append(*comp, buildTail(chunk, numPoints, comp->size()));
-    ensurePut(chunk, m_metadata.basename(chunk.id()), *comp);
+    append(
+            *comp,
+            buildTail(
+                packed.type,
+                packed.numPoints,
+                comp->size(),
+                packed.index.get()));
+    return std::move(*comp);
 }
 
 Cell::PooledStack LazPerfStorage::read(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         PointPool& pool,
-        const Id& id) const
+        const Id& id,
+        std::shared_ptr<const ChunkIndex>* index) const
 {
-    auto compressed(io::ensureGet(out, m_metadata.basename(id)));
-    const Tail tail(*compressed, m_tailFields);
+    // Local chunks are decompressed straight from a mapping of their file.
+    const auto file(view(out, id));
+    std::size_t size(file->size());
+    const Tail tail(file->data(), size, m_tailFields);
+    if (index) *index = tail.index();
 
     const std::size_t numPoints(tail.numPoints());
-    const std::size_t numBytes(compressed->size() + tail.size());
+    const std::size_t numBytes(size + tail.size());
 
     if (id >= m_metadata.structure().coldIndexBegin() && !numPoints)
     {
@@ -47,7 +62,7 @@ Cell::PooledStack LazPerfStorage::read(
         throw std::runtime_error("Invalid lazperf chunk numBytes");
     }
 
-    return Compression::decompress(*compressed, numPoints, pool);
+    return Compression::decompress(file->data(), size, numPoints, pool);
 }
 
 } // namespace entwine
@@ -24,12 +24,22 @@ public:
     { }
 
     virtual void write(Chunk& chunk) const override;
+    virtual std::vector<char> encode(PackedChunk& packed) const override;
 
     virtual Cell::PooledStack read(
             const arbiter::Endpoint& out,
             const arbiter::Endpoint& tmp,
             PointPool& pool,
-            const Id& id) const override;
+            const Id& id,
+            std::shared_ptr<const ChunkIndex>* index) const override;
+
+    // Our points must be decompressed, so cannot be served in place.
+    virtual std::unique_ptr<MappedChunk> map(
+            const arbiter::Endpoint& out,
+            const Id& id) const override
+    {
+        return std::unique_ptr<MappedChunk>();
+    }
 };
 
 } // namespace entwine
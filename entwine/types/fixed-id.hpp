@@ -0,0 +1,123 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include <entwine/types/defs.hpp>
+
+namespace entwine
+{
+
+// The widest native unsigned integer available.  Indices which fit within
+// this type may skip the arbitrary-precision Id arithmetic entirely.
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 FixedId;
+#else
+typedef uint64_t FixedId;
+#endif
+
+// Uniform operations over the index types that the climbing and chunk math
+// may be instantiated with: native unsigned integers, or Id for trees which
+// are too deep to fit in a native type.
+template<typename I>
+struct IdTraits
+{
+    static constexpr std::size_t bits = sizeof(I) * CHAR_BIT;
+    static constexpr std::size_t blocks = sizeof(I) / sizeof(Id::Block);
+
+    // Maximum working depth, exclusive, at which an index of a tree with the
+    // given number of dimensions may be climbed without overflowing.
+    static constexpr std::size_t depthEnd(std::size_t dimensions)
+    {
+        return bits / dimensions - 1;
+    }
+
+    // Matches Id::log2, which is computed from the most significant block.
+    static std::size_t log2(I val)
+    {
+        std::size_t offset(0);
+        while (I high = shiftBlockDown(val))
+        {
+            val = high;
+            offset += Id::bitsPerBlock;
+        }
+        return std::log2(static_cast<Id::Block>(val)) + offset;
+    }
+
+    // Throws std::overflow_error if the value does not fit.
+    static I from(const Id& id)
+    {
+        const auto& data(id.data());
+        if (data.size() > blocks)
+        {
+            throw std::overflow_error("Id is too large for fixed-width type");
+        }
+
+        I result(0);
+        for (std::size_t i(data.size()); i; --i)
+        {
+            result = shiftBlock(result);
+            result |= data[i - 1];
+        }
+        return result;
+    }
+
+    // Assign into an existing Id, which avoids the reallocation of a
+    // temporary for values that fit in its inline storage.
+    static void assign(Id& dst, I val)
+    {
+        auto& data(dst.data());
+        data.resize(1);
+        data.front() = static_cast<Id::Block>(val);
+
+        while ((val = shiftBlockDown(val)))
+        {
+            data.push_back(static_cast<Id::Block>(val));
+        }
+    }
+
+    static Id toId(I val)
+    {
+        Id result;
+        assign(result, val);
+        return result;
+    }
+
+private:
+    // Written as two half-width shifts so that a single-block type doesn't
+    // shift by its own width.
+    static I shiftBlock(I val)
+    {
+        return (val << (Id::bitsPerBlock / 2)) << (Id::bitsPerBlock / 2);
+    }
+
+    static I shiftBlockDown(I val)
+    {
+        return (val >> (Id::bitsPerBlock / 2)) >> (Id::bitsPerBlock / 2);
+    }
+};
+
+template<>
+struct IdTraits<Id>
+{
+    static std::size_t log2(const Id& val) { return Id::log2(val); }
+    static const Id& from(const Id& id) { return id; }
+    static void assign(Id& dst, const Id& val) { dst = val; }
+    static const Id& toId(const Id& val) { return val; }
+};
+
+} // namespace entwine
+
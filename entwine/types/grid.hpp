@@ -0,0 +1,159 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/point.hpp>
+
+namespace entwine
+{
+
+// Integer-space subdivision of bounds with integral extents, as the scaled
+// cubic bounds are when a Delta is present.  A point with integral
+// coordinates is normalized once to a fixed-point fraction of the bounds
+// width, after which its direction at any depth is found with a shift and a
+// comparison rather than by subdividing a Bounds per depth.
+//
+// Only depths at which the floating point subdivision of these bounds is
+// exact are covered, so results match the floating point climb exactly.
+class Grid
+{
+public:
+    using Coord = uint64_t;
+
+    explicit Grid(const Bounds& bounds)
+        : m_min(bounds.min())
+        , m_max(bounds.max())
+    {
+        std::size_t bits(0);
+
+        for (std::size_t i(0); i < 3; ++i)
+        {
+            const double min(m_min[i]);
+            const double max(m_max[i]);
+
+            if (
+                    std::floor(min) != min || std::floor(max) != max ||
+                    max <= min || std::abs(min) >= maxExtent ||
+                    std::abs(max) >= maxExtent)
+            {
+                return;
+            }
+
+            m_width[i] = max - min;
+
+            Coord extent(std::max(std::abs(min), std::abs(max)));
+            std::size_t axisBits(0);
+            while (extent) { extent >>= 1; ++axisBits; }
+            bits = std::max(bits, axisBits);
+        }
+
+        // With every coordinate less than 2^bits, a boundary at depth d of
+        // these bounds is exactly representable as a double while
+        // bits + d + 1 <= 53 - the extra bit leaves room for midpoints.
+        if (bits + 2 < mantissaBits) m_shift = mantissaBits - 2 - bits;
+    }
+
+    // False if these bounds can't be climbed in integer space at all.
+    bool valid() const { return m_shift; }
+
+    // Depths less than this value may be climbed in integer space.
+    std::size_t depthEnd() const { return m_shift ? m_shift + 1 : 0; }
+
+    // Normalize a point to fixed-point fractions of the bounds width.
+    // Returns false if the point is not integral, or is not within these
+    // bounds, in which case the result must not be used.
+    bool normalize(const Point& p, Coord* out) const
+    {
+        for (std::size_t i(0); i < 3; ++i)
+        {
+            const double v(p[i]);
+            if (std::floor(v) != v || v < m_min[i] || v >= m_max[i])
+            {
+                return false;
+            }
+
+            const Coord offset(v - m_min[i]);
+            out[i] = (offset << m_shift) / m_width[i];
+        }
+
+        return true;
+    }
+
+    // True if a normalized coordinate lies in the upper half of the given
+    // cell, along the same axis, where the cell is at the depth preceding the
+    // given depth.  Equivalent to a comparison against the cell midpoint.
+    bool upper(Coord v, Coord cell, std::size_t depth) const
+    {
+        return (v >> (m_shift - depth)) >= ((cell << 1) | 1);
+    }
+
+    // Coordinate of the lower boundary of the given cell along an axis.
+    double position(std::size_t axis, Coord cell, std::size_t depth) const
+    {
+        return
+            m_min[axis] +
+            static_cast<double>(m_width[axis] * cell) /
+                static_cast<double>(Coord(1) << depth);
+    }
+
+    Point mid(const Coord* cell, std::size_t depth) const
+    {
+        return Point(
+                position(0, (cell[0] << 1) | 1, depth + 1),
+                position(1, (cell[1] << 1) | 1, depth + 1),
+                position(2, (cell[2] << 1) | 1, depth + 1));
+    }
+
+    // Bounds of the given cell.  If force2d is set, only the X and Y axes are
+    // subdivided.
+    void bounds(
+            const Coord* cell,
+            std::size_t depth,
+            Bounds& out,
+            bool force2d = false) const
+    {
+        const std::size_t axes(force2d ? 2 : 3);
+        Point min(m_min);
+        Point max(m_max);
+
+        for (std::size_t i(0); i < axes; ++i)
+        {
+            min[i] = position(i, cell[i], depth);
+            max[i] = position(i, cell[i] + 1, depth);
+        }
+
+        out.set(min, max);
+    }
+
+    // Equivalent to Tube::calcTick for a normalized point.
+    std::size_t tick(const Coord* coords, std::size_t depth) const
+    {
+        return coords[2] >> (m_shift - depth);
+    }
+
+private:
+    static constexpr std::size_t mantissaBits = 53;
+    static constexpr double maxExtent = 1ULL << 40;
+
+    Point m_min;
+    Point m_max;
+    Coord m_width[3] = { 1, 1, 1 };
+    std::size_t m_shift = 0;
+};
+
+} // namespace entwine
+
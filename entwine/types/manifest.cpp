@@ -69,6 +69,9 @@ Manifest::Manifest(
     const bool remote(json["remote"].asBool());
     m_remote.resize(m_fileInfo.size(), remote);
 
+    m_order = extract<Origin>(json["order"]);
+    m_scheduling = json["scheduling"].asString();
+
     // If we have fileStats and pointStats, then we're dealing with a full
     // manifest from Manifest::toJson (a previous build).  Otherwise, we have
     // a simplified manifest from Manifest::toInferenceJson.
@@ -87,6 +90,8 @@ Manifest::Manifest(const Manifest& other)
     , m_pointStats(other.m_pointStats)
     , m_endpoint(other.m_endpoint)
     , m_chunkSize(other.m_chunkSize)
+    , m_order(other.m_order)
+    , m_scheduling(other.m_scheduling)
 { }
 
 Origin Manifest::find(const std::string& search) const
@@ -194,9 +199,26 @@ Json::Value Manifest::toJson() const
     if (!m_fileStats.empty())   json["fileStats"] = m_fileStats.toJson();
     if (!m_pointStats.empty())  json["pointStats"] = m_pointStats.toJson();
 
+    saveOrder(json);
+
     return json;
 }
 
+void Manifest::saveOrder(Json::Value& json) const
+{
+    if (m_order.empty()) return;
+
+    json["scheduling"] = m_scheduling;
+
+    Json::Value& order(json["order"]);
+    order.resize(m_order.size());
+
+    for (Json::ArrayIndex i(0); i < m_order.size(); ++i)
+    {
+        order[i] = static_cast<Json::UInt64>(m_order[i]);
+    }
+}
+
 void Manifest::awakenAll(Pool& pool) const
 {
     for (std::size_t i(0); i < m_fileInfo.size(); i += m_chunkSize)
@@ -254,6 +276,7 @@ void Manifest::save(const bool primary, const std::string postfix) const
     json["fileStats"] = m_fileStats.toJson();
     json["pointStats"] = m_pointStats.toJson();
     Json::Value& fileInfo(json["fileInfo"]);
+    saveOrder(json);
 
     // If we have a postfix (and therefore we're a subset), we'll just write
     // everything out together even if it's huge.  The split-up metadata is a
@@ -62,9 +62,11 @@ public:
 
     void add(Origin origin, const PointStats& stats)
     {
-        get(origin).add(stats);
+        // A split file's stats are added from several threads at once.
+        FileInfo& info(get(origin));
 
         std::lock_guard<std::mutex> lock(m_mutex);
+        info.add(stats);
         m_pointStats.add(stats);
     }
 
@@ -116,8 +118,19 @@ public:
 
     const std::vector<FileInfo>& fileInfo() const { return m_fileInfo; }
 
+    // The order in which our origins are scheduled for insertion, and the
+    // name of the policy which chose it, if other than our own order.
+    const OriginList& order() const { return m_order; }
+    const std::string& scheduling() const { return m_scheduling; }
+    void order(const OriginList& order, const std::string& scheduling)
+    {
+        m_order = order;
+        m_scheduling = scheduling;
+    }
+
 private:
     void awaken(Origin origin) const;
+    void saveOrder(Json::Value& json) const;
 
     void countStatus(FileInfo::Status status)
     {
@@ -140,6 +153,9 @@ private:
     const arbiter::Endpoint m_endpoint;
     std::size_t m_chunkSize = 0;
 
+    OriginList m_order;
+    std::string m_scheduling;
+
     mutable std::mutex m_mutex;
 };
 
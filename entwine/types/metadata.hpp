@@ -162,7 +162,7 @@ private:
     // These are aggregated as the Builder runs.
     Manifest& manifest() { return *m_manifest; }
     Manifest* manifestPtr() { return m_manifest.get(); }
-    // Storage& storage() { return *m_storage; }
+    Storage& storage() { return *m_storage; }
     std::string& srs() { return m_srs; }
 
     std::unique_ptr<Delta> m_delta;
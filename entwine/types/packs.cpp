@@ -0,0 +1,486 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/packs.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/compression.hpp>
+#include <entwine/util/io.hpp>
+#include <entwine/util/mapped-file.hpp>
+#include <entwine/util/range-reader.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    const std::string indexPath("entwine-packs");
+
+    void append(std::vector<char>& data, const uint64_t v)
+    {
+        const char* pos(reinterpret_cast<const char*>(&v));
+        data.insert(data.end(), pos, pos + sizeof(uint64_t));
+    }
+
+    void append(std::vector<char>& data, const std::string& s)
+    {
+        append(data, s.size());
+        data.insert(data.end(), s.begin(), s.end());
+    }
+
+    class Extractor
+    {
+    public:
+        Extractor(const std::vector<char>& data)
+            : m_pos(data.data())
+            , m_end(data.data() + data.size())
+        { }
+
+        uint64_t number()
+        {
+            uint64_t v(0);
+            const char* begin(take(sizeof(uint64_t)));
+            std::copy(
+                    begin,
+                    begin + sizeof(uint64_t),
+                    reinterpret_cast<char*>(&v));
+            return v;
+        }
+
+        std::string string()
+        {
+            const std::size_t size(number());
+            const char* begin(take(size));
+            return std::string(begin, begin + size);
+        }
+
+    private:
+        const char* take(const std::size_t size)
+        {
+            if (static_cast<std::size_t>(m_end - m_pos) < size)
+            {
+                throw std::runtime_error("Invalid pack index");
+            }
+
+            const char* begin(m_pos);
+            m_pos += size;
+            return begin;
+        }
+
+        const char* m_pos;
+        const char* const m_end;
+    };
+}
+
+Packs::Packs(const Metadata& metadata, const std::size_t chunksPerPack)
+    : m_metadata(metadata)
+    , m_chunksPerPack(chunksPerPack)
+    , m_tmp(nullptr)
+    , m_mutex()
+    , m_loaded(false)
+    , m_packs()
+    , m_packIndex()
+    , m_generations()
+    , m_entries()
+    , m_staged()
+    , m_prefetched()
+{
+    if (!m_chunksPerPack) throw std::runtime_error("Invalid pack size");
+}
+
+Packs::~Packs() { }
+
+std::string Packs::packName(const Id& id) const
+{
+    const Structure& structure(m_metadata.structure());
+    if (id < structure.coldIndexBegin()) return "pack-base";
+
+    const ChunkInfo info(structure, id);
+    return "pack-" + std::to_string(info.chunkNum() / m_chunksPerPack);
+}
+
+void Packs::stage(const arbiter::Endpoint& tmp)
+{
+    if (!tmp.isLocal())
+    {
+        throw std::runtime_error("Packs must be staged locally");
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tmp = &tmp;
+}
+
+void Packs::put(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        const std::vector<char>& data)
+{
+    std::size_t pack(0);
+    std::size_t offset(0);
+    std::string path;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_tmp) throw std::runtime_error("Packs have not been staged");
+
+        load(out);
+
+        pack = packIndex(packName(id));
+        path = arbiter::fs::expandTilde(m_tmp->fullPath(stagedName(pack)));
+
+        // Any staging file left behind by a previous run is stale.
+        if (!m_staged.count(pack))
+        {
+            std::ofstream file(
+                    path,
+                    std::ofstream::binary | std::ofstream::out |
+                        std::ofstream::trunc);
+
+            if (!file) throw std::runtime_error("Could not stage to " + path);
+        }
+
+        std::size_t& staged(m_staged[pack]);
+        offset = staged;
+        staged += data.size();
+    }
+
+    // Our range of the staging file is reserved, so we may write it without
+    // holding up the other puts.
+    std::fstream file(
+            path,
+            std::fstream::binary | std::fstream::in | std::fstream::out);
+
+    file.seekp(offset);
+    file.write(data.data(), data.size());
+    file.close();
+
+    if (!file) throw std::runtime_error("Could not stage chunk to " + path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Entry& entry(m_entries[id]);
+    entry.pack = pack;
+    entry.offset = offset;
+    entry.size = data.size();
+    entry.staged = true;
+}
+
+void Packs::save(const arbiter::Endpoint& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    load(out);
+
+    // Our state is only replaced once each of its packs has been written.
+    std::map<Id, Entry> entries(m_entries);
+    std::vector<std::size_t> generations(m_generations);
+
+    for (const auto& p : m_staged)
+    {
+        const std::size_t pack(p.first);
+        const std::string previous(fileName(pack, m_generations[pack]));
+
+        const auto staged(io::ensureGet(*m_tmp, stagedName(pack)));
+        std::unique_ptr<std::vector<char>> existing;
+
+        // Our entries are ordered by ID, and so are the chunks of the pack.
+        std::vector<char> data;
+
+        for (auto& e : entries)
+        {
+            Entry& entry(e.second);
+            if (entry.pack != pack) continue;
+
+            if (!entry.staged && !existing)
+            {
+                existing = io::ensureGet(out, previous);
+            }
+
+            const std::vector<char>& from(entry.staged ? *staged : *existing);
+
+            if (entry.offset + entry.size > from.size())
+            {
+                throw std::runtime_error(
+                        "Invalid pack entry: " + e.first.str());
+            }
+
+            const char* pos(from.data() + entry.offset);
+
+            entry.offset = data.size();
+            entry.staged = false;
+
+            data.insert(data.end(), pos, pos + entry.size);
+        }
+
+        io::ensurePut(out, fileName(pack, ++generations[pack]), data);
+    }
+
+    const std::vector<std::size_t> replaced(m_generations);
+
+    // Nothing refers to the packs we have written until our index does.
+    m_entries = std::move(entries);
+    m_generations = std::move(generations);
+    io::ensurePut(out, indexPath, *Compression::compressLzma(toBytes()));
+
+    for (const auto& p : m_staged)
+    {
+        const std::size_t pack(p.first);
+
+        arbiter::fs::remove(
+                arbiter::fs::expandTilde(m_tmp->fullPath(stagedName(pack))));
+
+        // Only local files may be removed, so the previous generations of
+        // remote packs are left in place.
+        if (out.isLocal() && replaced[pack])
+        {
+            arbiter::fs::remove(
+                    arbiter::fs::expandTilde(
+                        out.fullPath(fileName(pack, replaced[pack]))));
+        }
+    }
+
+    m_staged.clear();
+}
+
+bool Packs::contains(const arbiter::Endpoint& out, const Id& id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    load(out);
+    return m_entries.count(id);
+}
+
+std::unique_ptr<FileView> Packs::view(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        const std::size_t tail) const
+{
+    std::unique_ptr<FileView> result;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    load(out);
+
+    const auto it(m_entries.find(id));
+    if (it == m_entries.end()) return result;
+
+    const Entry entry(it->second);
+    const std::size_t skip(tail && tail < entry.size ? entry.size - tail : 0);
+    const std::size_t size(entry.size - skip);
+
+    const auto pre(m_prefetched.find(id));
+    if (pre != m_prefetched.end())
+    {
+        const Prefetched& p(pre->second);
+        return makeUnique<FileView>(p.data, p.offset + skip, size);
+    }
+
+    const std::string name(
+            entry.staged ?
+                stagedName(entry.pack) :
+                fileName(entry.pack, m_generations.at(entry.pack)));
+
+    lock.unlock();
+
+    const arbiter::Endpoint& ep(entry.staged ? *m_tmp : out);
+    return makeUnique<FileView>(ep, name, entry.offset + skip, size);
+}
+
+void Packs::prefetch(const arbiter::Endpoint& out, const std::vector<Id>& ids)
+{
+    if (out.isLocal() || !out.isHttpDerived()) return;
+
+    using Run = std::vector<std::pair<Id, Entry>>;
+
+    // The committed chunks we have not already fetched, by pack and offset.
+    std::map<std::size_t, std::map<std::size_t, std::pair<Id, Entry>>> wanted;
+    std::map<std::size_t, std::string> names;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        load(out);
+
+        for (const Id& id : ids)
+        {
+            auto pre(m_prefetched.find(id));
+            if (pre != m_prefetched.end())
+            {
+                ++pre->second.refs;
+                continue;
+            }
+
+            const auto it(m_entries.find(id));
+            if (it == m_entries.end() || it->second.staged) continue;
+
+            const Entry& entry(it->second);
+            wanted[entry.pack][entry.offset] = std::make_pair(id, entry);
+            names[entry.pack] = fileName(entry.pack, m_generations[entry.pack]);
+        }
+    }
+
+    std::vector<std::pair<std::size_t, Run>> runs;
+
+    for (const auto& p : wanted)
+    {
+        Run run;
+        std::size_t begin(0);
+        std::size_t end(0);
+
+        for (const auto& c : p.second)
+        {
+            const Entry& entry(c.second.second);
+
+            if (
+                    run.empty() ||
+                    entry.offset > end + heuristics::packCoalesceGap ||
+                    entry.offset + entry.size - begin >
+                        heuristics::packCoalesceMax)
+            {
+                if (run.size() > 1) runs.emplace_back(p.first, run);
+                run.clear();
+                begin = entry.offset;
+            }
+
+            run.push_back(c.second);
+            end = entry.offset + entry.size;
+        }
+
+        if (run.size() > 1) runs.emplace_back(p.first, run);
+    }
+
+    // Lone chunks are left to be fetched on their own, alongside the others.
+    for (const auto& r : runs)
+    {
+        const Run& run(r.second);
+        const std::size_t begin(run.front().second.offset);
+        const std::size_t end(
+                run.back().second.offset + run.back().second.size);
+
+        RangeReader reader(out, names.at(r.first), begin, end, end - begin, 0);
+        std::shared_ptr<const std::vector<char>> data(
+                std::make_shared<std::vector<char>>(reader.next()));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& c : run)
+        {
+            Prefetched& p(m_prefetched[c.first]);
+            if (!p.refs++)
+            {
+                p.data = data;
+                p.offset = c.second.offset - begin;
+            }
+        }
+    }
+}
+
+void Packs::drop(const std::vector<Id>& ids)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (const Id& id : ids)
+    {
+        auto it(m_prefetched.find(id));
+        if (it != m_prefetched.end() && !--it->second.refs)
+        {
+            m_prefetched.erase(it);
+        }
+    }
+}
+
+void Packs::load(const arbiter::Endpoint& out) const
+{
+    if (m_loaded) return;
+
+    if (auto compressed = out.tryGetBinary(indexPath))
+    {
+        const auto data(Compression::decompressLzma(*compressed));
+        Extractor extractor(*data);
+
+        const std::size_t numPacks(extractor.number());
+        for (std::size_t i(0); i < numPacks; ++i)
+        {
+            m_packs.push_back(extractor.string());
+            m_packIndex[m_packs.back()] = i;
+            m_generations.push_back(extractor.number());
+        }
+
+        const std::size_t numEntries(extractor.number());
+        for (std::size_t i(0); i < numEntries; ++i)
+        {
+            const Id id(extractor.string());
+
+            Entry& entry(m_entries[id]);
+            entry.pack = extractor.number();
+            entry.offset = extractor.number();
+            entry.size = extractor.number();
+
+            if (entry.pack >= m_packs.size())
+            {
+                throw std::runtime_error("Invalid pack index");
+            }
+        }
+    }
+
+    m_loaded = true;
+}
+
+std::size_t Packs::packIndex(const std::string& name)
+{
+    const auto it(m_packIndex.find(name));
+    if (it != m_packIndex.end()) return it->second;
+
+    m_packs.push_back(name);
+    m_generations.push_back(0);
+    return m_packIndex[name] = m_packs.size() - 1;
+}
+
+std::string Packs::stagedName(const std::size_t pack) const
+{
+    return "staged-" + m_packs.at(pack);
+}
+
+std::string Packs::fileName(
+        const std::size_t pack,
+        const std::size_t generation) const
+{
+    return m_packs.at(pack) + "-" + std::to_string(generation);
+}
+
+std::vector<char> Packs::toBytes() const
+{
+    std::vector<char> data;
+
+    append(data, m_packs.size());
+    for (std::size_t i(0); i < m_packs.size(); ++i)
+    {
+        append(data, m_packs[i]);
+        append(data, m_generations[i]);
+    }
+
+    append(data, m_entries.size());
+    for (const auto& e : m_entries)
+    {
+        const Entry& entry(e.second);
+        append(data, e.first.str());
+        append(data, entry.pack);
+        append(data, entry.offset);
+        append(data, entry.size);
+    }
+
+    return data;
+}
+
+} // namespace entwine
+
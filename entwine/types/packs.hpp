@@ -0,0 +1,127 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <entwine/types/defs.hpp>
+
+namespace entwine
+{
+
+namespace arbiter { class Endpoint; }
+
+class FileView;
+class Metadata;
+
+// Groups the chunks of a build into larger pack files, so that deep, sparse
+// trees are not written as one small object per chunk.  The base chunks share
+// a single pack, and each other pack holds a run of chunksPerPack cold chunks
+// in their global order - see ChunkInfo::chunkNum - which keeps siblings
+// together, along with the neighboring subtrees of their depth.
+//
+// Chunks put during a build are appended to local staging files, and
+// assembled into their packs when we are saved, along with an index,
+// entwine-packs, locating each chunk by its pack, offset, and size.  Each save
+// writes its packs under new names and publishes the index last, so the
+// previous index remains valid until it is replaced.
+class Packs
+{
+public:
+    Packs(const Metadata& metadata, std::size_t chunksPerPack);
+    ~Packs();
+
+    std::size_t chunksPerPack() const { return m_chunksPerPack; }
+    std::string packName(const Id& id) const;
+
+    // Must be called, with a local endpoint, before any chunks are put.
+    void stage(const arbiter::Endpoint& tmp);
+
+    // A chunk put more than once replaces its previous data.  Puts to the
+    // same pack may run concurrently.
+    void put(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            const std::vector<char>& data);
+
+    // Write out every pack with chunks put since we were last saved, and
+    // then our index.  Packs are rewritten in full, as a new generation of
+    // their files, and local files of the previous generation are removed
+    // once they are no longer indexed.
+    void save(const arbiter::Endpoint& out);
+
+    bool contains(const arbiter::Endpoint& out, const Id& id) const;
+
+    // Returns nullptr if the chunk is in no pack.  If tail is non-zero, only
+    // the last tail bytes of the chunk are needed.
+    std::unique_ptr<FileView> view(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            std::size_t tail = 0) const;
+
+    // For remote endpoints, fetch those of the given chunks which are near
+    // each other within a pack with a single range request per run of them.
+    // They are then viewed from memory until they are dropped.
+    void prefetch(const arbiter::Endpoint& out, const std::vector<Id>& ids);
+    void drop(const std::vector<Id>& ids);
+
+private:
+    struct Entry
+    {
+        std::size_t pack = 0;
+        std::size_t offset = 0;
+        std::size_t size = 0;
+
+        // If set, the offset is within the pack's staging file.
+        bool staged = false;
+    };
+
+    struct Prefetched
+    {
+        std::shared_ptr<const std::vector<char>> data;
+        std::size_t offset = 0;
+        std::size_t refs = 0;
+    };
+
+    // Called with our mutex locked.
+    void load(const arbiter::Endpoint& out) const;
+    std::size_t packIndex(const std::string& name);
+    std::string stagedName(std::size_t pack) const;
+    std::string fileName(std::size_t pack, std::size_t generation) const;
+
+    std::vector<char> toBytes() const;
+
+    const Metadata& m_metadata;
+    const std::size_t m_chunksPerPack;
+    const arbiter::Endpoint* m_tmp;
+
+    mutable std::mutex m_mutex;
+    mutable bool m_loaded;
+    mutable std::vector<std::string> m_packs;
+    mutable std::map<std::string, std::size_t> m_packIndex;
+
+    // The number of times each pack has been written, which names its file.
+    mutable std::vector<std::size_t> m_generations;
+    mutable std::map<Id, Entry> m_entries;
+
+    // Bytes reserved so far in the staging file of each dirty pack.
+    std::map<std::size_t, std::size_t> m_staged;
+
+    std::map<Id, Prefetched> m_prefetched;
+};
+
+} // namespace entwine
+
@@ -136,6 +136,12 @@ public:
         for (auto& cell : cells) dataStack.push(cell.acquire());
     }
 
+    void release(Cell::PooledNode cell)
+    {
+        Data::PooledStack dataStack(dataPool());
+        dataStack.push(cell->acquire());
+    }
+
 private:
     const Schema& m_schema;
     const Delta* m_delta;
@@ -0,0 +1,285 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/types/point-slab.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <entwine/types/schema.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Index of the block holding the given offset.
+    std::size_t blockOf(std::size_t offset, std::size_t blockSize)
+    {
+        const std::size_t i(offset / blockSize + 1);
+        std::size_t k(0);
+        while (i >> (k + 1)) ++k;
+        return k;
+    }
+
+    template<typename T> double as(const char* pos)
+    {
+        T v;
+        std::memcpy(&v, pos, sizeof(T));
+        return static_cast<double>(v);
+    }
+
+    PointSlab::Field field(const Schema& schema, pdal::Dimension::Id id)
+    {
+        const pdal::PointLayout& layout(schema.pdalLayout());
+        return PointSlab::Field(layout.dimOffset(id), layout.dimType(id));
+    }
+
+    void validate(const PointSlab::Field& f, std::size_t pointSize)
+    {
+        using Type = pdal::Dimension::Type;
+
+        switch (f.type)
+        {
+            case Type::Signed32: case Type::Signed64:
+            case Type::Unsigned32: case Type::Unsigned64:
+            case Type::Float: case Type::Double:
+                break;
+            default:
+                throw std::runtime_error("Invalid coordinate type");
+        }
+
+        if (f.offset + pdal::Dimension::size(f.type) > pointSize)
+        {
+            throw std::runtime_error("Invalid coordinate offset");
+        }
+    }
+}
+
+constexpr PointSlab::Offset PointSlab::none;
+constexpr std::size_t PointSlab::maxBlocks;
+
+PointSlab::PointSlab(
+        const std::size_t pointSize,
+        const Field& x,
+        const Field& y,
+        const Field& z,
+        const std::size_t blockSize)
+    : m_pointSize(pointSize)
+    , m_blockSize(std::max<std::size_t>(blockSize, 1))
+    , m_x(x)
+    , m_y(y)
+    , m_z(z)
+    , m_size(0)
+    , m_dead(0)
+{
+    for (auto& b : m_blocks) b.store(nullptr);
+
+    for (const Field* f : { &m_x, &m_y, &m_z }) validate(*f, m_pointSize);
+}
+
+PointSlab::PointSlab(const Schema& schema)
+    : PointSlab(
+            schema.pointSize(),
+            field(schema, pdal::Dimension::Id::X),
+            field(schema, pdal::Dimension::Id::Y),
+            field(schema, pdal::Dimension::Id::Z))
+{ }
+
+PointSlab::PointSlab(PointSlab&& other)
+    : m_pointSize(other.m_pointSize)
+    , m_blockSize(other.m_blockSize)
+    , m_x(other.m_x)
+    , m_y(other.m_y)
+    , m_z(other.m_z)
+    , m_size(other.m_size.exchange(0))
+    , m_dead(other.m_dead.exchange(0))
+{
+    for (std::size_t k(0); k < maxBlocks; ++k)
+    {
+        m_blocks[k].store(other.m_blocks[k].exchange(nullptr));
+    }
+}
+
+PointSlab::~PointSlab()
+{
+    clear();
+}
+
+void PointSlab::clear()
+{
+    for (auto& b : m_blocks) delete b.exchange(nullptr);
+    m_size = 0;
+    m_dead = 0;
+}
+
+PointSlab::Offset PointSlab::reserve(const std::size_t count)
+{
+    const std::size_t begin(m_size.fetch_add(count));
+
+    if (!count) return begin;
+
+    if (begin + count > none)
+    {
+        throw std::overflow_error("Point slab offsets exhausted");
+    }
+
+    const std::size_t last(blockOf(begin + count - 1, m_blockSize));
+    for (std::size_t k(blockOf(begin, m_blockSize)); k <= last; ++k)
+    {
+        block(k);
+    }
+
+    return begin;
+}
+
+PointSlab::Block& PointSlab::block(const std::size_t k)
+{
+    if (Block* b = m_blocks[k].load()) return *b;
+
+    // Blocks are large, so serialize their creation rather than racing to
+    // allocate one and discarding the losers.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (Block* b = m_blocks[k].load()) return *b;
+
+    Block* b(new Block(blockCapacity(k), m_pointSize));
+    m_blocks[k].store(b);
+    return *b;
+}
+
+std::pair<char*, PointSlab::Offset*> PointSlab::locate(
+        const Offset offset) const
+{
+    const std::size_t k(blockOf(offset, m_blockSize));
+    const std::size_t pos(offset - m_blockSize * ((std::size_t(1) << k) - 1));
+
+    Block& b(*m_blocks[k].load());
+    return std::make_pair(
+            b.data.get() + pos * m_pointSize,
+            b.links.get() + pos);
+}
+
+double PointSlab::read(const char* record, const Field& f) const
+{
+    using Type = pdal::Dimension::Type;
+
+    const char* pos(record + f.offset);
+
+    // Types are validated at construction.
+    switch (f.type)
+    {
+        case Type::Signed32: return as<int32_t>(pos);
+        case Type::Signed64: return as<int64_t>(pos);
+        case Type::Unsigned32: return as<uint32_t>(pos);
+        case Type::Unsigned64: return as<uint64_t>(pos);
+        case Type::Float: return as<float>(pos);
+        default: return as<double>(pos);
+    }
+}
+
+Point PointSlab::point(const Offset offset) const
+{
+    const char* record(data(offset));
+    return Point(read(record, m_x), read(record, m_y), read(record, m_z));
+}
+
+std::size_t PointSlab::chainSize(Offset head) const
+{
+    std::size_t n(0);
+    for ( ; head != none; head = next(head)) ++n;
+    return n;
+}
+
+PointSlab::Offset PointSlab::store(const Cell& cell, Offset reuse)
+{
+    Offset head(none);
+    Offset prev(none);
+    Offset fresh(none);
+    std::size_t remaining(cell.size());
+
+    for (const char* d : cell)
+    {
+        Offset curr(reuse);
+
+        if (reuse != none) reuse = next(reuse);
+        else
+        {
+            if (fresh == none) fresh = reserve(remaining);
+            curr = fresh++;
+        }
+
+        std::copy(d, d + m_pointSize, data(curr));
+
+        if (prev != none) link(prev, curr);
+        else head = curr;
+
+        prev = curr;
+        --remaining;
+    }
+
+    if (prev != none) link(prev, none);
+
+    // Whatever is left of the overwritten chain is no longer reachable.
+    m_dead += chainSize(reuse);
+
+    return head;
+}
+
+void PointSlab::prepend(Offset& head, const Cell& cell)
+{
+    if (cell.empty()) return;
+
+    const Offset added(store(cell));
+
+    Offset tail(added);
+    while (next(tail) != none) tail = next(tail);
+
+    link(tail, head);
+    head = added;
+}
+
+PointSlab::Offset PointSlab::copy(const PointSlab& other, Offset head)
+{
+    const std::size_t n(other.chainSize(head));
+    if (!n) return none;
+
+    const Offset begin(reserve(n));
+
+    for (Offset o(begin); head != none; ++o, head = other.next(head))
+    {
+        const char* src(other.data(head));
+        std::copy(src, src + m_pointSize, data(o));
+        link(o, o + 1 < begin + n ? o + 1 : none);
+    }
+
+    return begin;
+}
+
+Cell::PooledNode PointSlab::load(const Offset head, PointPool& pool) const
+{
+    Cell::PooledNode cell(pool.cellPool().acquireOne());
+    Data::PooledStack dataStack(pool.dataPool().acquire(chainSize(head)));
+
+    cell->point() = point(head);
+
+    for (Offset o(head); o != none; o = next(o))
+    {
+        Data::PooledNode node(dataStack.popOne());
+        const char* src(data(o));
+        std::copy(src, src + m_pointSize, *node);
+        cell->push(std::move(node));
+    }
+
+    return cell;
+}
+
+} // namespace entwine
+
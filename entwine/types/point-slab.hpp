@@ -0,0 +1,167 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include <pdal/Dimension.hpp>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/point.hpp>
+#include <entwine/types/point-pool.hpp>
+
+namespace entwine
+{
+
+class Schema;
+
+// Chunk-local, append-only storage of packed point records, addressed by
+// 32-bit offsets.  Records are stored back to back exactly as they are
+// serialized, and each record carries a link to the next record with the same
+// coordinates, so a tube may refer to all of its resident points at a tick
+// with a single offset.
+//
+// Storage grows in blocks of geometrically increasing size, with block k
+// holding blockSize * 2^k records, so records never move once written and may
+// be read without locking.  Reserving records is thread-safe - writing and
+// linking them is left to the owner of those records.
+class PointSlab
+{
+public:
+    using Offset = uint32_t;
+    static constexpr Offset none = std::numeric_limits<Offset>::max();
+
+    // The location of a coordinate within a packed record.
+    struct Field
+    {
+        Field(std::size_t offset = 0, pdal::Dimension::Type type =
+                pdal::Dimension::Type::Double)
+            : offset(offset)
+            , type(type)
+        { }
+
+        std::size_t offset;
+        pdal::Dimension::Type type;
+    };
+
+    PointSlab(
+            std::size_t pointSize,
+            const Field& x,
+            const Field& y,
+            const Field& z,
+            std::size_t blockSize = heuristics::slabBlockSize);
+
+    explicit PointSlab(const Schema& schema);
+
+    PointSlab(PointSlab&& other);
+    ~PointSlab();
+
+    // Reserve "count" consecutive records, returning the offset of the first.
+    // Their links are unset.
+    Offset reserve(std::size_t count);
+
+    char* data(Offset offset) { return locate(offset).first; }
+    const char* data(Offset offset) const
+    {
+        return const_cast<PointSlab&>(*this).data(offset);
+    }
+
+    Offset next(Offset offset) const { return *locate(offset).second; }
+    void link(Offset offset, Offset next) { *locate(offset).second = next; }
+
+    // Coordinates of a record, as they would be read through a PointRef.
+    Point point(Offset offset) const;
+
+    // Number of records in the chain beginning at "head".
+    std::size_t chainSize(Offset head) const;
+
+    // Write the records of "cell" as a chain, overwriting the chain at
+    // "reuse", if any, before reserving new records.  Returns the new head.
+    Offset store(const Cell& cell, Offset reuse = none);
+
+    // Link the records of "cell" into the front of the chain at "head".
+    void prepend(Offset& head, const Cell& cell);
+
+    // Copy the chain at "head" from another slab into this one.
+    Offset copy(const PointSlab& other, Offset head);
+
+    // Materialize the chain at "head" as a cell drawn from "pool".  The
+    // records themselves are left as they are.
+    Cell::PooledNode load(Offset head, PointPool& pool) const;
+
+    // Number of records reserved, including dead ones.
+    std::size_t size() const { return m_size.load(); }
+
+    // Number of records which are no longer part of any chain.  While this
+    // is zero, the records of this slab are exactly its resident points.
+    std::size_t dead() const { return m_dead.load(); }
+
+    std::size_t pointSize() const { return m_pointSize; }
+
+    // Calls f(const char* data, std::size_t numRecords) for each block of
+    // records in offset order.  Not safe to call concurrently with reserve.
+    template<typename F> void forEachBlock(F f) const
+    {
+        std::size_t remaining(size());
+
+        for (std::size_t k(0); remaining; ++k)
+        {
+            const std::size_t n(std::min(remaining, blockCapacity(k)));
+            f(m_blocks[k].load()->data.get(), n);
+            remaining -= n;
+        }
+    }
+
+    void clear();
+
+private:
+    static constexpr std::size_t maxBlocks = 32;
+
+    struct Block
+    {
+        Block(std::size_t records, std::size_t pointSize)
+            : data(new char[records * pointSize])
+            , links(new Offset[records])
+        { }
+
+        std::unique_ptr<char[]> data;
+        std::unique_ptr<Offset[]> links;
+    };
+
+    std::size_t blockCapacity(std::size_t k) const { return m_blockSize << k; }
+
+    std::pair<char*, Offset*> locate(Offset offset) const;
+    Block& block(std::size_t k);
+
+    double read(const char* record, const Field& field) const;
+
+    const std::size_t m_pointSize;
+    const std::size_t m_blockSize;
+    const Field m_x;
+    const Field m_y;
+    const Field m_z;
+
+    std::atomic<Block*> m_blocks[maxBlocks];
+    std::atomic_size_t m_size;
+    std::atomic_size_t m_dead;
+    std::mutex m_mutex;
+
+    PointSlab(const PointSlab&) = delete;
+    PointSlab& operator=(const PointSlab&) = delete;
+};
+
+} // namespace entwine
+
@@ -10,22 +10,82 @@
 
 #include <entwine/types/pooled-point-table.hpp>
 
+#include <algorithm>
+
+#include <entwine/tree/heuristics.hpp>
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/delta.hpp>
+#include <entwine/util/pool.hpp>
 #include <entwine/util/unique.hpp>
 
 namespace entwine
 {
 
+namespace
+{
+    // Processes a batch on our pipeline thread.  Since the batch is only
+    // movable, it is carried in here rather than captured by a lambda.
+    struct Batch
+    {
+        Cell::PooledStack operator()() { return (*process)(std::move(cells)); }
+
+        PooledPointTable::Process* process;
+        Cell::PooledStack cells;
+    };
+
+    // Bring a stack of nodes to exactly the given size.
+    template<typename Stack, typename SplicePool>
+    void fit(Stack& stack, SplicePool& pool, const std::size_t size)
+    {
+        if (stack.size() < size) stack.push(pool.acquire(size - stack.size()));
+        else if (stack.size() > size) stack.pop(stack.size() - size);
+    }
+}
+
+PooledPointTable::PooledPointTable(
+        PointPool& pointPool,
+        Process process,
+        const Origin origin,
+        const Schema& outwardSchema,
+        const bool pipelined)
+    : pdal::StreamPointTable(outwardSchema.pdalLayout())
+    , m_pointPool(pointPool)
+    , m_schema(pointPool.schema())
+    , m_capacity(batchSize(pointPool.schema()))
+    , m_process(process)
+    , m_dataNodes(pointPool.dataPool())
+    , m_cellNodes(pointPool.cellPool())
+    , m_refs()
+    , m_origin(origin)
+    , m_index(0)
+    , m_outstanding(0)
+    , m_pool(pipelined ? makeUnique<Pool>(1) : nullptr)
+    , m_pending()
+{
+    m_refs.reserve(capacity());
+    allocate();
+}
+
+PooledPointTable::~PooledPointTable()
+{
+    // Our batch in flight refers to our processing function.
+    if (m_pending.valid()) m_pending.wait();
+}
+
 std::unique_ptr<PooledPointTable> PooledPointTable::create(
         PointPool& pointPool,
         Process process,
         const Delta* delta,
-        const Origin origin)
+        const Origin origin,
+        const bool pipelined)
 {
     if (!delta)
     {
-        return makeUnique<PooledPointTable>(pointPool, process, origin);
+        return makeUnique<PooledPointTable>(
+                pointPool,
+                process,
+                origin,
+                pipelined);
     }
     else
     {
@@ -34,10 +94,24 @@ std::unique_ptr<PooledPointTable> PooledPointTable::create(
                 process,
                 origin,
                 *delta,
-                makeUnique<Schema>(Schema::normalize(pointPool.schema())));
+                makeUnique<Schema>(Schema::normalize(pointPool.schema())),
+                pipelined);
     }
 }
 
+std::size_t PooledPointTable::batchSize(const Schema& schema)
+{
+    // Each point occupies its data, its data node, and its cell node.
+    const std::size_t pointBytes(
+            schema.pointSize() + sizeof(Data::RawNode) + sizeof(Cell::RawNode));
+
+    const std::size_t points(heuristics::tableBytes / pointBytes);
+
+    return std::min(
+            std::max(points, heuristics::tableMinPoints),
+            heuristics::tableMaxPoints);
+}
+
 void PooledPointTable::reset()
 {
     BinaryPointTable table(m_schema);
@@ -61,22 +135,43 @@ void PooledPointTable::reset()
         cell.set(pointRef, std::move(data));
     }
 
-    cells = m_process(std::move(cells));
-    for (auto& cell : cells) m_dataNodes.push(cell.acquire());
-    m_cellNodes.push(std::move(cells));
+    if (m_pool)
+    {
+        // Our previous batch must be done before this one is handed off, and
+        // whatever it left over may be reused for the next.
+        flush();
+
+        Batch batch { &m_process, std::move(cells) };
+        m_pending = m_pool->submit(std::move(batch));
+    }
+    else
+    {
+        recycle(m_process(std::move(cells)));
+    }
 
     allocate();
 }
 
-void PooledPointTable::allocate()
+void PooledPointTable::flush()
+{
+    if (m_pending.valid()) recycle(m_pending.get());
+}
+
+void PooledPointTable::recycle(Cell::PooledStack cells)
 {
-    const std::size_t d(capacity() - m_dataNodes.size());
-    const std::size_t c(capacity() - m_cellNodes.size());
-    if (!d && !c) return;
+    for (auto& cell : cells) m_dataNodes.push(cell.acquire());
+    m_cellNodes.push(std::move(cells));
+}
 
-    m_dataNodes.push(m_pointPool.dataPool().acquire(d));
-    m_cellNodes.push(m_pointPool.cellPool().acquire(c));
+void PooledPointTable::allocate()
+{
+    // If pipelined, the batch recycled by reset() may have left over more
+    // nodes than the one it handed off took, so we may be above capacity.
+    fit(m_dataNodes, m_pointPool.dataPool(), capacity());
+    fit(m_cellNodes, m_pointPool.cellPool(), capacity());
 
+    // Even at capacity, our nodes have changed with every batch, so our
+    // references must follow them.
     m_refs.clear();
     for (char*& d : m_dataNodes) m_refs.push_back(d);
 }
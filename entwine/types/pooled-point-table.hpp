@@ -12,6 +12,8 @@
 
 #include <array>
 #include <cassert>
+#include <future>
+#include <memory>
 
 #include <pdal/Dimension.hpp>
 #include <pdal/PointTable.hpp>
@@ -27,6 +29,18 @@
 namespace entwine
 {
 
+class Pool;
+
+// A streaming table whose points are written directly into pooled nodes,
+// which are handed off in batches to a processing function.  Its capacity is
+// sized so that a batch stays roughly within heuristics::tableBytes.
+//
+// If pipelined, each batch is processed on a thread of our own while the
+// reader fills the next one, so decoding and insertion overlap.  This thread
+// is in addition to those of the builder's pools.  At most one
+// batch is processed at a time, so a slow processing function still holds
+// back the reader.  The final batch is only certain to have been processed
+// once flush() has returned.
 class PooledPointTable : public pdal::StreamPointTable
 {
 public:
@@ -37,41 +51,46 @@ public:
     PooledPointTable(
             PointPool& pointPool,
             Process process,
-            Origin origin = invalidOrigin)
-        : PooledPointTable(pointPool, process, origin, pointPool.schema())
+            Origin origin = invalidOrigin,
+            bool pipelined = false)
+        : PooledPointTable(
+                pointPool,
+                process,
+                origin,
+                pointPool.schema(),
+                pipelined)
     { }
 
     PooledPointTable(
             PointPool& pointPool,
             Process process,
             Origin origin,
-            const Schema& outwardSchema)
-        : pdal::StreamPointTable(outwardSchema.pdalLayout())
-        , m_pointPool(pointPool)
-        , m_schema(pointPool.schema())
-        , m_process(process)
-        , m_dataNodes(pointPool.dataPool())
-        , m_cellNodes(pointPool.cellPool())
-        , m_refs()
-        , m_origin(origin)
-        , m_index(0)
-        , m_outstanding(0)
-    {
-        m_refs.reserve(capacity());
-        allocate();
-    }
+            const Schema& outwardSchema,
+            bool pipelined = false);
 
-    virtual ~PooledPointTable() { }
+    virtual ~PooledPointTable();
 
     static std::unique_ptr<PooledPointTable> create(
             PointPool& pointPool,
             Process process,
             const Delta* delta,
-            Origin origin = invalidOrigin);
+            Origin origin = invalidOrigin,
+            bool pipelined = false);
+
+    // Points per batch for this schema.
+    static std::size_t batchSize(const Schema& schema);
+
+    virtual pdal::point_count_t capacity() const override
+    {
+        return m_capacity;
+    }
 
-    virtual pdal::point_count_t capacity() const override { return 4096; }
     virtual void reset() override;
 
+    // Wait for any batch still being processed, rethrowing its error if it
+    // failed.
+    void flush();
+
 protected:
     virtual char* getPoint(pdal::PointId i) override
     {
@@ -84,8 +103,12 @@ protected:
 
     void allocate();
 
+    // Take back the nodes which were not kept by our processing function.
+    void recycle(Cell::PooledStack cells);
+
     PointPool& m_pointPool;
     const Schema& m_schema;
+    const std::size_t m_capacity;
     Process m_process;
 
     Data::PooledStack m_dataNodes;
@@ -96,6 +119,9 @@ protected:
     const Origin m_origin;
     std::size_t m_index;
     std::size_t m_outstanding;
+
+    std::unique_ptr<Pool> m_pool;
+    std::future<Cell::PooledStack> m_pending;
 };
 
 class ConvertingPointTable : public PooledPointTable
@@ -106,8 +132,14 @@ public:
             Process process,
             Origin origin,
             const Delta& delta,
-            std::unique_ptr<Schema> normalizedSchema)
-        : PooledPointTable(pointPool, process, origin, *normalizedSchema)
+            std::unique_ptr<Schema> normalizedSchema,
+            bool pipelined = false)
+        : PooledPointTable(
+                pointPool,
+                process,
+                origin,
+                *normalizedSchema,
+                pipelined)
         , m_points(capacity())
         , m_delta(delta)
         , m_normalizedSchema(std::move(normalizedSchema))
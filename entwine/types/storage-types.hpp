@@ -14,26 +14,61 @@
 #include <cstddef>
 #include <cstdint>
 #include <map>
+#include <memory>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include <json/json.h>
 
+#include <entwine/types/chunk-index.hpp>
+
 namespace entwine
 {
 
 enum class ChunkType : char { Sparse = 0, Contiguous, Invalid };
-enum class TailField { ChunkType, NumPoints, NumBytes };
-enum class ChunkStorageType { Binary, LasZip, LazPerf };
+enum class TailField { ChunkType, NumPoints, NumBytes, Index };
+enum class ChunkStorageType { Binary, LasZip, LazPerf, Columnar };
 enum class HierarchyCompression { None, Lzma };
 
 using TailFieldList = std::vector<TailField>;
 
+// Names of the dimensions a reader needs from a chunk.
+using DimNames = std::set<std::string>;
+
 class Tail
 {
 public:
+    // Extracts our fields from the end of the data, which is shrunk to
+    // exclude them.
     Tail(std::vector<char>& data, TailFieldList fields)
+    {
+        std::size_t size(data.size());
+        extractAll(data.data(), size, fields);
+        data.resize(size);
+    }
+
+    // For data we cannot resize, such as a mapped file, the size is shrunk
+    // instead.
+    Tail(const char* data, std::size_t& size, TailFieldList fields)
+    {
+        extractAll(data, size, fields);
+    }
+
+    std::size_t size() const { return m_size; }
+    ChunkType type() const { return m_type; }
+    std::size_t numPoints() const { return m_numPoints; }
+    std::size_t numBytes() const { return m_numBytes; }
+
+    // Null unless our fields include an Index.
+    std::shared_ptr<const ChunkIndex> index() const { return m_index; }
+
+private:
+    void extractAll(
+            const char* data,
+            std::size_t& size,
+            const TailFieldList& fields)
     {
         // Fields are in reverse order as we extract.
         for (auto it(fields.rbegin()); it != fields.rend(); ++it)
@@ -41,38 +76,41 @@ public:
             switch (*it)
             {
                 case TailField::ChunkType:
-                    m_type = static_cast<ChunkType>(extract<char>(data));
+                    m_type = static_cast<ChunkType>(
+                            extract<char>(data, size));
                     break;
                 case TailField::NumPoints:
-                    m_numPoints = extract<uint64_t>(data);
+                    m_numPoints = extract<uint64_t>(data, size);
                     break;
                 case TailField::NumBytes:
-                    m_numBytes = extract<uint64_t>(data);
+                    m_numBytes = extract<uint64_t>(data, size);
+                    break;
+                case TailField::Index:
+                {
+                    const std::size_t before(size);
+                    m_index = std::make_shared<ChunkIndex>(
+                            ChunkIndex::extract(data, size));
+                    m_size += before - size;
                     break;
+                }
                 default:
                     throw std::runtime_error("Invalid tail field value");
             }
         }
     }
 
-    std::size_t size() const { return m_size; }
-    ChunkType type() const { return m_type; }
-    std::size_t numPoints() const { return m_numPoints; }
-    std::size_t numBytes() const { return m_numBytes; }
-
-private:
     template<typename T>
-    T extract(std::vector<char>& data)
+    T extract(const char* data, std::size_t& size)
     {
         T v(0);
-        const auto size(sizeof(T));
-        m_size += size;
+        const auto n(sizeof(T));
+        m_size += n;
 
-        if (data.size() < size) throw std::runtime_error("Invalid chunk size");
-        const char* pos(data.data() + data.size() - size);
-        std::copy(pos, pos + size, reinterpret_cast<char*>(&v));
+        if (size < n) throw std::runtime_error("Invalid chunk size");
+        const char* pos(data + size - n);
+        std::copy(pos, pos + n, reinterpret_cast<char*>(&v));
 
-        data.resize(data.size() - size);
+        size -= n;
         return v;
     }
 
@@ -81,6 +119,7 @@ private:
     ChunkType m_type = ChunkType::Invalid;
     std::size_t m_numPoints = 0;
     std::size_t m_numBytes = 0;
+    std::shared_ptr<const ChunkIndex> m_index;
 };
 
 inline std::string toString(ChunkStorageType c)
@@ -90,6 +129,7 @@ inline std::string toString(ChunkStorageType c)
         case ChunkStorageType::LasZip: return "laszip";
         case ChunkStorageType::LazPerf: return "lazperf";
         case ChunkStorageType::Binary: return "binary";
+        case ChunkStorageType::Columnar: return "columnar";
         default: throw std::runtime_error("Invalid ChunkStorageType value");
     }
 }
@@ -104,6 +144,7 @@ inline ChunkStorageType toChunkStorageType(const Json::Value& j)
     const std::string s(j.asString());
     if (s == "laszip") return ChunkStorageType::LasZip;
     if (s == "lazperf") return ChunkStorageType::LazPerf;
+    if (s == "columnar") return ChunkStorageType::Columnar;
     throw std::runtime_error("Invalid compression: " + j.toStyledString());
 }
 
@@ -114,6 +155,7 @@ inline std::string toString(TailField t)
         case TailField::ChunkType: return "chunkType";
         case TailField::NumPoints: return "numPoints";
         case TailField::NumBytes: return "numBytes";
+        case TailField::Index: return "index";
         default: throw std::runtime_error("Invalid TailField value");
     }
 }
@@ -123,6 +165,7 @@ inline TailField toTailField(const std::string& s)
     if (s == "chunkType") return TailField::ChunkType;
     if (s == "numPoints") return TailField::NumPoints;
     if (s == "numBytes") return TailField::NumBytes;
+    if (s == "index") return TailField::Index;
     throw std::runtime_error("Invalid tail field: " + s);
 }
 
@@ -17,9 +17,11 @@
 #include <entwine/tree/chunk.hpp>
 #include <entwine/types/binary-point-table.hpp>
 #include <entwine/types/metadata.hpp>
+#include <entwine/types/packs.hpp>
 #include <entwine/types/pooled-point-table.hpp>
 #include <entwine/types/reprojection.hpp>
 #include <entwine/util/compression.hpp>
+#include <entwine/util/mapped-file.hpp>
 #include <entwine/util/unique.hpp>
 
 #include <entwine/types/chunk-storage/chunk-storage.hpp>
@@ -27,6 +29,9 @@
 namespace entwine
 {
 
+MappedChunk::MappedChunk() { }
+MappedChunk::~MappedChunk() { }
+
 Storage::Storage(
         const Metadata& metadata,
         const ChunkStorageType chunkStorageType,
@@ -45,6 +50,7 @@ Storage::Storage(const Metadata& metadata, const Json::Value& json)
     , m_hierarchyCompression(toHierarchyCompression(json["compressHierarchy"]))
 {
     m_storage = ChunkStorage::create(m_metadata, m_chunkStorageType, m_json);
+    if (json.isMember("pack")) pack(json["pack"].asUInt64());
 }
 
 Storage::Storage(const Metadata& metadata, const Storage& other)
@@ -54,6 +60,7 @@ Storage::Storage(const Metadata& metadata, const Storage& other)
     , m_hierarchyCompression(other.m_hierarchyCompression)
 {
     m_storage = ChunkStorage::create(m_metadata, m_chunkStorageType, m_json);
+    if (other.m_packs) pack(other.m_packs->chunksPerPack());
 }
 
 Storage::~Storage() { }
@@ -63,6 +70,7 @@ Json::Value Storage::toJson() const
     Json::Value json;
     json["storage"] = toString(m_chunkStorageType);
     json["compressHierarchy"] = toString(m_hierarchyCompression);
+    if (m_packs) json["pack"] = (Json::UInt64)m_packs->chunksPerPack();
 
     const auto s(m_storage->toJson());
     for (const auto f : s.getMemberNames()) json[f] = s[f];
@@ -76,13 +84,89 @@ void Storage::serialize(Chunk& chunk) const
     m_storage->write(chunk);
 }
 
+bool Storage::pipelined() const
+{
+    return m_storage->pipelined();
+}
+
+std::unique_ptr<PackedChunk> Storage::pack(Chunk& chunk) const
+{
+    if (m_metadata.cesiumSettings()) chunk.tile();
+    return m_storage->pack(chunk);
+}
+
+std::unique_ptr<PackedChunk> Storage::pack(
+        const Id& id,
+        const ChunkType type,
+        const Bounds& bounds,
+        std::vector<char> data) const
+{
+    return m_storage->pack(id, type, bounds, std::move(data));
+}
+
+std::vector<char> Storage::encode(PackedChunk& packed) const
+{
+    return m_storage->encode(packed);
+}
+
+void Storage::upload(
+        const arbiter::Endpoint& out,
+        const Id& id,
+        const std::vector<char>& data) const
+{
+    m_storage->upload(out, id, data);
+}
+
+Cell::PooledStack Storage::deserialize(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& chunkId,
+        std::shared_ptr<const ChunkIndex>* index) const
+{
+    return m_storage->read(out, tmp, pool, chunkId, index);
+}
+
+bool Storage::projects() const
+{
+    return m_storage->projects();
+}
+
 Cell::PooledStack Storage::deserialize(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         PointPool& pool,
+        const Id& chunkId,
+        const DimNames& dims,
+        std::shared_ptr<const ChunkIndex>* index) const
+{
+    return m_storage->project(out, tmp, pool, chunkId, dims, index);
+}
+
+void Storage::fill(
+        const arbiter::Endpoint& out,
+        const Id& chunkId,
+        const DimNames& dims,
+        Cell::PooledStack& cells) const
+{
+    m_storage->fill(out, chunkId, dims, cells);
+}
+
+std::unique_ptr<MappedChunk> Storage::map(
+        const arbiter::Endpoint& out,
         const Id& chunkId) const
 {
-    return m_storage->read(out, tmp, pool, chunkId);
+    return m_storage->map(out, chunkId);
+}
+
+void Storage::pack(const std::size_t chunksPerPack)
+{
+    if (m_chunkStorageType == ChunkStorageType::LasZip)
+    {
+        throw std::runtime_error("Laszip chunks cannot be packed");
+    }
+
+    m_packs = makeUnique<Packs>(m_metadata, chunksPerPack);
 }
 
 const Metadata& Storage::metadata() const { return m_metadata; }
@@ -30,9 +30,39 @@ namespace entwine
 
 namespace arbiter { class Endpoint; }
 
+class Bounds;
 class Chunk;
 class ChunkStorage;
+class FileView;
 class Metadata;
+class Packs;
+
+// A chunk whose points have been gathered for serialization, and handed back
+// to the point pool.
+struct PackedChunk
+{
+    Id id;
+    ChunkType type = ChunkType::Invalid;
+    std::size_t numPoints = 0;
+    std::vector<char> data;
+
+    // Set if our storage indexes chunks, in which case the points of the
+    // data have been sorted into its order.
+    std::shared_ptr<const ChunkIndex> index;
+};
+
+// A chunk whose points are served in place from a mapping of its file, in
+// our native schema.
+struct MappedChunk
+{
+    MappedChunk();
+    ~MappedChunk();
+
+    std::unique_ptr<FileView> file;
+    const char* data = nullptr;
+    std::size_t numPoints = 0;
+    std::shared_ptr<const ChunkIndex> index;
+};
 
 class Storage
 {
@@ -49,10 +79,50 @@ public:
     Json::Value toJson() const;
 
     void serialize(Chunk& chunk) const;
+
+    // The stages of serialize, which may be run separately by a Serializer
+    // if our chunk storage type is pipelined.
+    bool pipelined() const;
+    std::unique_ptr<PackedChunk> pack(Chunk& chunk) const;
+    std::unique_ptr<PackedChunk> pack(
+            const Id& id,
+            ChunkType type,
+            const Bounds& bounds,
+            std::vector<char> data) const;
+    std::vector<char> encode(PackedChunk& packed) const;
+    void upload(
+            const arbiter::Endpoint& out,
+            const Id& id,
+            const std::vector<char>& data) const;
+
     Cell::PooledStack deserialize(
         const arbiter::Endpoint& out,
         const arbiter::Endpoint& tmp,
         PointPool& pool,
+        const Id& chunkId,
+        std::shared_ptr<const ChunkIndex>* index = nullptr) const;
+
+    // If our chunk storage type projects, only the given dimensions - along
+    // with XYZ - are decoded, and the rest may be filled in later.  Otherwise
+    // every dimension is decoded, and there is nothing left to fill.
+    bool projects() const;
+    Cell::PooledStack deserialize(
+        const arbiter::Endpoint& out,
+        const arbiter::Endpoint& tmp,
+        PointPool& pool,
+        const Id& chunkId,
+        const DimNames& dims,
+        std::shared_ptr<const ChunkIndex>* index = nullptr) const;
+    void fill(
+        const arbiter::Endpoint& out,
+        const Id& chunkId,
+        const DimNames& dims,
+        Cell::PooledStack& cells) const;
+
+    // Returns nullptr unless the chunk is local, and stored in a format which
+    // may be used without decoding.
+    std::unique_ptr<MappedChunk> map(
+        const arbiter::Endpoint& out,
         const Id& chunkId) const;
 
     ChunkStorageType chunkStorageType() const { return m_chunkStorageType; }
@@ -61,6 +131,11 @@ public:
         return m_hierarchyCompression;
     }
 
+    // Null unless our chunks are grouped into pack files - see Packs.  Not
+    // supported for laszip chunk storage, which is written through files.
+    Packs* packs() const { return m_packs.get(); }
+    void pack(std::size_t chunksPerPack);
+
     const Metadata& metadata() const;
     const Schema& schema() const;
     std::string filename(const Id& id) const;
@@ -73,6 +148,7 @@ private:
     HierarchyCompression m_hierarchyCompression;
 
     std::unique_ptr<ChunkStorage> m_storage;
+    std::unique_ptr<Packs> m_packs;
 };
 
 } // namespace entwine
@@ -12,11 +12,13 @@
 
 #include <cstddef>
 #include <memory>
+#include <stdexcept>
 
 #include <json/json.h>
 
 #include <entwine/types/point-pool.hpp>
 #include <entwine/types/defs.hpp>
+#include <entwine/types/fixed-id.hpp>
 
 namespace entwine
 {
@@ -31,9 +33,12 @@ class ChunkInfo
 public:
     ChunkInfo(const Structure& structure, const Id& index);
 
-    static std::size_t calcDepth(std::size_t factor, const Id& index)
+    // May be called with an Id, or with a native integer type if the index
+    // is known to fit - see Structure::fixedDepthEnd.
+    template<typename I>
+    static std::size_t calcDepth(std::size_t factor, const I& index)
     {
-        return Id::log2(index * (factor - 1) + 1) / log2(factor);
+        return IdTraits<I>::log2(index * (factor - 1) + 1) / log2(factor);
     }
 
     static std::size_t calcDepth(std::size_t index)
@@ -41,9 +46,10 @@ public:
         return log2(index * 3 + 1) / 2;
     }
 
-    static Id calcParentId(
+    template<typename I>
+    static I calcParentId(
             const Structure& structure,
-            const Id& index,
+            const I& index,
             std::size_t depth);
 
     static Id calcLevelIndex(
@@ -148,6 +154,13 @@ public:
         return lossless() || depth < m_coldDepthEnd;
     }
 
+    // Indices at working depths less than this value fit in a FixedId, so
+    // they may be climbed with native arithmetic rather than with Id.
+    std::size_t fixedDepthEnd() const
+    {
+        return IdTraits<FixedId>::depthEnd(m_dimensions);
+    }
+
     bool lossless() const           { return m_coldDepthEnd == 0; }
     bool tubular() const            { return m_tubular; }
     bool dynamicChunks() const      { return m_dynamicChunks; }
@@ -278,5 +291,32 @@ private:
     Id m_mappedIndexBegin;
 };
 
+template<typename I>
+I ChunkInfo::calcParentId(
+        const Structure& structure,
+        const I& index,
+        const std::size_t depth)
+{
+    if (index == IdTraits<I>::from(structure.baseIndexBegin()))
+    {
+        throw std::runtime_error("Base chunk has no parent");
+    }
+
+    const I upOne(index >> 2);
+
+    if (depth > structure.sparseDepthBegin())
+    {
+        return upOne;
+    }
+    else if (depth > structure.coldDepthBegin())
+    {
+        const I coldIndexBegin(IdTraits<I>::from(structure.coldIndexBegin()));
+        const std::size_t ppc(structure.basePointsPerChunk());
+
+        return coldIndexBegin + (upOne - coldIndexBegin) / ppc * ppc;
+    }
+    else return IdTraits<I>::from(structure.baseIndexBegin());
+}
+
 } // namespace entwine
 
@@ -0,0 +1,119 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/defs.hpp>
+#include <entwine/types/tube.hpp>
+
+namespace entwine
+{
+
+// A concurrent map of tubes keyed by their normalized Id.  The Ids are split
+// across independently-locked shards, so threads inserting into different
+// tubes rarely contend, and a shard lock is held only for the lookup itself -
+// never while inserting into the resulting tube.
+//
+// Iteration via forEach visits tubes in ascending Id order across all shards.
+class TubeMap
+{
+public:
+    TubeMap(std::size_t numShards = heuristics::tubeMapShards)
+        : m_numShards(numShards)
+        , m_shards(new Shard[m_numShards])
+    { }
+
+    Tube& get(const Id& id)
+    {
+        Shard& shard(m_shards[std::hash<Id>()(id) % m_numShards]);
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        return shard.tubes[id];
+    }
+
+    bool empty() const
+    {
+        for (std::size_t i(0); i < m_numShards; ++i)
+        {
+            if (!m_shards[i].tubes.empty()) return false;
+        }
+        return true;
+    }
+
+    // Calls f(const Id&, Tube&) for each tube, in Id order.  Not safe to call
+    // concurrently with get().
+    template<typename F> void forEach(F f) { forEach(*this, f); }
+    template<typename F> void forEach(F f) const { forEach(*this, f); }
+
+private:
+    using Tubes = std::map<Id, Tube>;
+
+    struct Shard
+    {
+        Tubes tubes;
+        std::mutex mutex;
+    };
+
+    // A k-way merge over the individually sorted shards.
+    template<typename Self, typename F>
+    static void forEach(Self& self, F& f)
+    {
+        using It = decltype(self.m_shards[0].tubes.begin());
+        using Range = std::pair<It, It>;
+
+        std::vector<Range> ranges;
+
+        for (std::size_t i(0); i < self.m_numShards; ++i)
+        {
+            auto& tubes(self.m_shards[i].tubes);
+            if (!tubes.empty()) ranges.emplace_back(tubes.begin(), tubes.end());
+        }
+
+        const auto greater([](const Range& a, const Range& b)
+        {
+            return b.first->first < a.first->first;
+        });
+
+        std::make_heap(ranges.begin(), ranges.end(), greater);
+
+        while (!ranges.empty())
+        {
+            std::pop_heap(ranges.begin(), ranges.end(), greater);
+            Range& range(ranges.back());
+
+            f(range.first->first, range.first->second);
+
+            if (++range.first != range.second)
+            {
+                std::push_heap(ranges.begin(), ranges.end(), greater);
+            }
+            else
+            {
+                ranges.pop_back();
+            }
+        }
+    }
+
+    const std::size_t m_numShards;
+    std::unique_ptr<Shard[]> m_shards;
+};
+
+} // namespace entwine
+
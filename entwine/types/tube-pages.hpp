@@ -0,0 +1,234 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/tube.hpp>
+
+namespace entwine
+{
+
+// A fixed-length sequence of tubes, indexed by their normalized position
+// within a contiguous chunk.  Tubes are allocated a page at a time the first
+// time any tube of that page is touched, so the footprint of a chunk scales
+// with the tubes actually occupied rather than with its nominal span.
+//
+// Retrieving a tube is safe to call concurrently - iteration, append, and
+// clear are not.
+class TubePages
+{
+public:
+    explicit TubePages(
+            std::size_t size = 0,
+            std::size_t pageSize = heuristics::tubePageSize)
+        : m_size(0)
+        , m_pageSize(std::max<std::size_t>(pageSize, 1))
+        , m_numPages(0)
+    {
+        resize(size);
+    }
+
+    ~TubePages() { clear(); }
+
+    TubePages(TubePages&& other) noexcept
+        : m_size(other.m_size)
+        , m_pageSize(other.m_pageSize)
+        , m_numPages(other.m_numPages)
+        , m_pages(std::move(other.m_pages))
+    {
+        other.m_size = 0;
+        other.m_numPages = 0;
+    }
+
+    TubePages& operator=(TubePages&& other) noexcept
+    {
+        clear();
+        std::swap(m_size, other.m_size);
+        std::swap(m_pageSize, other.m_pageSize);
+        std::swap(m_numPages, other.m_numPages);
+        std::swap(m_pages, other.m_pages);
+        return *this;
+    }
+
+    std::size_t size() const { return m_size; }
+
+    // Number of pages which have been allocated.
+    std::size_t allocated() const
+    {
+        std::size_t n(0);
+        for (std::size_t p(0); p < m_numPages; ++p) if (m_pages[p].load()) ++n;
+        return n;
+    }
+
+    Tube& at(const std::size_t i)
+    {
+        if (i >= m_size) throw std::out_of_range("Invalid tube index");
+        return page(i / m_pageSize)[i % m_pageSize];
+    }
+
+    bool empty() const
+    {
+        bool result(true);
+        forEach([&result](const Tube& tube)
+        {
+            if (!tube.empty()) result = false;
+        });
+        return result;
+    }
+
+    // Append the tubes of "other" after our own, leaving it empty.
+    void append(TubePages& other)
+    {
+        const std::size_t offset(m_size);
+        resize(m_size + other.m_size);
+
+        const bool aligned(
+                offset % m_pageSize == 0 && m_pageSize == other.m_pageSize);
+
+        for (std::size_t p(0); p < other.m_numPages; ++p)
+        {
+            Tube* src(other.m_pages[p].exchange(nullptr));
+            if (!src) continue;
+
+            if (aligned)
+            {
+                // Whole pages may simply change hands.
+                m_pages[offset / m_pageSize + p].store(src);
+                continue;
+            }
+
+            const std::size_t begin(p * other.m_pageSize);
+            const std::size_t end(
+                    std::min(begin + other.m_pageSize, other.m_size));
+
+            for (std::size_t i(begin); i < end; ++i)
+            {
+                Tube& tube(src[i - begin]);
+                if (!tube.empty()) at(offset + i) = std::move(tube);
+            }
+
+            delete [] src;
+        }
+
+        other.clear();
+    }
+
+    void clear()
+    {
+        for (std::size_t p(0); p < m_numPages; ++p)
+        {
+            delete [] m_pages[p].exchange(nullptr);
+        }
+
+        m_pages.reset();
+        m_numPages = 0;
+        m_size = 0;
+    }
+
+    // Calls f(Tube&) for each allocated tube, in index order.
+    template<typename F> void forEach(F f) { forEach(*this, f); }
+    template<typename F> void forEach(F f) const { forEach(*this, f); }
+
+    // Calls f(std::size_t index, const Tube&) for each allocated tube.
+    template<typename F> void forEachIndexed(F f) const
+    {
+        forEachIndexed(*this, f);
+    }
+
+private:
+    void resize(const std::size_t size)
+    {
+        const std::size_t numPages((size + m_pageSize - 1) / m_pageSize);
+
+        if (numPages > m_numPages)
+        {
+            std::unique_ptr<std::atomic<Tube*>[]> pages(
+                    new std::atomic<Tube*>[numPages]);
+
+            for (std::size_t p(0); p < numPages; ++p)
+            {
+                pages[p].store(p < m_numPages ? m_pages[p].load() : nullptr);
+            }
+
+            m_pages = std::move(pages);
+            m_numPages = numPages;
+        }
+
+        m_size = size;
+    }
+
+    Tube* page(const std::size_t p)
+    {
+        Tube* current(m_pages[p].load());
+        if (current) return current;
+
+        std::unique_ptr<Tube[]> created(new Tube[m_pageSize]);
+
+        if (m_pages[p].compare_exchange_strong(current, created.get()))
+        {
+            return created.release();
+        }
+
+        // Someone else beat us to it - theirs is now stored in "current".
+        return current;
+    }
+
+    template<typename F>
+    struct Unindexed
+    {
+        explicit Unindexed(F& f) : f(f) { }
+        template<typename T> void operator()(std::size_t, T& tube) { f(tube); }
+        F& f;
+    };
+
+    template<typename Self, typename F>
+    static void forEach(Self& self, F& f)
+    {
+        forEachIndexed(self, Unindexed<F>(f));
+    }
+
+    template<typename Self, typename F>
+    static void forEachIndexed(Self& self, F f)
+    {
+        for (std::size_t p(0); p < self.m_numPages; ++p)
+        {
+            if (Tube* tubes = self.m_pages[p].load())
+            {
+                const std::size_t begin(p * self.m_pageSize);
+                const std::size_t end(
+                        std::min(begin + self.m_pageSize, self.m_size));
+
+                for (std::size_t i(begin); i < end; ++i)
+                {
+                    f(i, tubes[i - begin]);
+                }
+            }
+        }
+    }
+
+    std::size_t m_size;
+    std::size_t m_pageSize;
+    std::size_t m_numPages;
+    std::unique_ptr<std::atomic<Tube*>[]> m_pages;
+
+    TubePages(const TubePages&) = delete;
+    TubePages& operator=(const TubePages&) = delete;
+};
+
+} // namespace entwine
+
@@ -8,56 +8,282 @@
 *
 ******************************************************************************/
 
-#include <entwine/tree/climber.hpp>
 #include <entwine/types/tube.hpp>
 
+#include <thread>
+
+#include <entwine/tree/climber.hpp>
+#include <entwine/tree/heuristics.hpp>
+
 namespace entwine
 {
 
-Tube::Insertion Tube::insert(const Climber& climber, Cell::PooledNode& cell)
+namespace
+{
+    const std::size_t cacheLineSize(64);
+}
+
+BaseTube::Insertion BaseTube::resolve(
+        Cell::PooledNode& curr,
+        Cell::PooledNode& cell,
+        const Point& mid,
+        const std::size_t pointSize)
 {
     Insertion result;
 
+    if (cell->point() != curr->point())
+    {
+        if (displaces(cell->point(), curr->point(), mid))
+        {
+            // We are inserting cell, and extracting curr.  Store our new
+            // cell, and send the previous one further down the tree.
+            result.setDelta(
+                    static_cast<int>(cell->size()) -
+                    static_cast<int>(curr->size()));
+            std::swap(cell, curr);
+        }
+        // Else, the default-constructed result is correct.
+    }
+    else
+    {
+        result.setDone(cell->size());
+        curr->push(std::move(cell), pointSize);
+    }
+
+    return result;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+MapTube::Insertion MapTube::insert(
+        const Climber& climber,
+        Cell::PooledNode& cell)
+{
+    return insert(
+            climber.tick(),
+            climber.mid(),
+            climber.pointSize(),
+            cell);
+}
+
+MapTube::Insertion MapTube::insert(
+        const uint64_t tick,
+        const Point& mid,
+        const std::size_t pointSize,
+        Cell::PooledNode& cell)
+{
     SpinGuard lock(m_spinner);
 
-    const auto it(m_cells.find(climber.tick()));
+    const auto it(m_cells.find(tick));
 
     if (it != m_cells.end())
     {
-        Cell::PooledNode& curr(it->second);
+        return resolve(it->second, cell, mid, pointSize);
+    }
+    else
+    {
+        Insertion result;
+        result.setDone(cell->size());
+        m_cells.emplace(std::make_pair(tick, std::move(cell)));
+        return result;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+FlatTube::Table::Table(const std::size_t capacity)
+    : m_capacity(capacity)
+    , m_data(new char[capacity * sizeof(Slot) + cacheLineSize])
+    , m_slots(nullptr)
+    , m_next(nullptr)
+{
+    void* pos(m_data.get());
+    std::size_t space(capacity * sizeof(Slot) + cacheLineSize);
+
+    m_slots = reinterpret_cast<Slot*>(
+            std::align(cacheLineSize, capacity * sizeof(Slot), pos, space));
+
+    for (std::size_t i(0); i < m_capacity; ++i) new (&m_slots[i]) Slot();
+}
+
+FlatTube::Table::~Table()
+{
+    for (std::size_t i(0); i < m_capacity; ++i) m_slots[i].~Slot();
+    delete m_next.load();
+}
+
+FlatTube::Table* FlatTube::Table::grow()
+{
+    Table* next(m_next.load());
+    if (next) return next;
+
+    std::unique_ptr<Table> created(new Table(m_capacity * 2));
+
+    if (m_next.compare_exchange_strong(next, created.get()))
+    {
+        return created.release();
+    }
+
+    // Someone else beat us to it - theirs is now stored in "next".
+    return next;
+}
+
+FlatTube::Table* FlatTube::head()
+{
+    Table* table(m_table.load());
+    if (table) return table;
+
+    std::unique_ptr<Table> created(new Table(heuristics::flatTubeCapacity));
+
+    if (m_table.compare_exchange_strong(table, created.get()))
+    {
+        return created.release();
+    }
+
+    return table;
+}
+
+FlatTube::Insertion FlatTube::insert(
+        const Climber& climber,
+        Cell::PooledNode& cell)
+{
+    return insert(
+            climber.tick(),
+            climber.mid(),
+            climber.pointSize(),
+            cell);
+}
+
+FlatTube::Insertion FlatTube::insert(
+        const uint64_t tick,
+        const Point& mid,
+        const std::size_t pointSize,
+        Cell::PooledNode& cell)
+{
+    Table* table(head());
+
+    while (true)
+    {
+        // Ticks within a tube tend to be dense and sequential, so the tick
+        // itself makes a fine hash.
+        const std::size_t mask(table->capacity() - 1);
+        const std::size_t start(tick & mask);
 
-        if (cell->point() != curr->point())
+        for (std::size_t i(0); i < table->capacity(); ++i)
         {
-            const Point& center(climber.bounds().mid());
+            Slot& slot(table->slot((start + i) & mask));
+            int state(slot.state().load(std::memory_order_acquire));
+
+            if (state == Slot::Empty)
+            {
+                if (slot.state().compare_exchange_strong(
+                            state,
+                            Slot::Constructing,
+                            std::memory_order_acq_rel))
+                {
+                    Insertion result;
+                    result.setDone(cell->size());
+
+                    new (&slot.entry()) Entry(tick, std::move(cell));
+                    slot.state().store(Slot::Ready, std::memory_order_release);
+
+                    return result;
+                }
 
-            const auto a(cell->point().sqDist3d(center));
-            const auto b(curr->point().sqDist3d(center));
+                // Lost the claim - the new state of this slot is now stored
+                // in "state", so fall through to see whose tick it holds.
+            }
+
+            while (state == Slot::Constructing)
+            {
+                std::this_thread::yield();
+                state = slot.state().load(std::memory_order_acquire);
+            }
+
+            // Once constructed, the tick of a slot never changes, so this
+            // may be read even if the slot is currently locked.
+            if (slot.entry().first != tick) continue;
 
-            if (a < b || (a == b && ltChained(cell->point(), curr->point())))
+            int expected(Slot::Ready);
+            while (!slot.state().compare_exchange_weak(
+                        expected,
+                        Slot::Locked,
+                        std::memory_order_acquire))
             {
-                // We are inserting cell, and extracting curr.  Store our new
-                // cell, and send the previous one further down the tree.
-                result.setDelta(
-                        static_cast<int>(cell->size()) -
-                        static_cast<int>(curr->size()));
-                std::swap(cell, curr);
+                expected = Slot::Ready;
             }
-            // Else, the default-constructed result is correct.
+
+            const Insertion result(
+                    resolve(slot.entry().second, cell, mid, pointSize));
+
+            slot.state().store(Slot::Ready, std::memory_order_release);
+
+            return result;
         }
-        else
+
+        table = table->grow();
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+SlabTube::Insertion SlabTube::insert(
+        const Climber& climber,
+        Cell::PooledNode& cell,
+        PointSlab& slab,
+        PointPool& pool)
+{
+    return insert(climber.tick(), climber.mid(), cell, slab, pool);
+}
+
+SlabTube::Insertion SlabTube::insert(
+        const uint64_t tick,
+        const Point& mid,
+        Cell::PooledNode& cell,
+        PointSlab& slab,
+        PointPool& pool)
+{
+    SpinGuard lock(m_spinner);
+
+    Insertion result;
+    const auto it(m_cells.find(tick));
+
+    if (it == m_cells.end())
+    {
+        result.setDone(cell->size());
+        m_cells.emplace(tick, slab.store(*cell));
+        pool.release(std::move(cell));
+        return result;
+    }
+
+    PointSlab::Offset& head(it->second);
+    const Point resident(slab.point(head));
+
+    if (cell->point() != resident)
+    {
+        if (displaces(cell->point(), resident, mid))
         {
-            result.setDone(cell->size());
-            it->second->push(std::move(cell), climber.pointSize());
+            // Send the resident further down the tree, and write our new
+            // cell over its records.
+            Cell::PooledNode displaced(slab.load(head, pool));
+
+            result.setDelta(
+                    static_cast<int>(cell->size()) -
+                    static_cast<int>(displaced->size()));
+
+            head = slab.store(*cell, head);
+            pool.release(std::move(cell));
+            cell = std::move(displaced);
         }
     }
     else
     {
         result.setDone(cell->size());
-        m_cells.emplace(std::make_pair(climber.tick(), std::move(cell)));
+        slab.prepend(head, *cell);
+        pool.release(std::move(cell));
     }
 
     return result;
 }
 
 } // namespace entwine
-
@@ -10,15 +10,21 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
 #include <map>
+#include <memory>
 #include <mutex>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include <entwine/types/bounds.hpp>
+#include <entwine/types/defs.hpp>
 #include <entwine/types/point-pool.hpp>
+#include <entwine/types/point-slab.hpp>
 #include <entwine/types/schema.hpp>
 #include <entwine/types/structure.hpp>
 #include <entwine/util/spin-lock.hpp>
@@ -28,7 +34,7 @@ namespace entwine
 
 class Climber;
 
-class Tube
+class BaseTube
 {
 public:
     class Insertion
@@ -52,6 +58,48 @@ public:
         int m_delta;
     };
 
+    static constexpr std::size_t maxTickDepth() { return 64; }
+
+    static std::size_t calcTick(
+            const Point& point,
+            const Bounds& bounds,
+            const std::size_t depth)
+    {
+        return
+            std::floor(
+                    (point.z - bounds.min().z) * (1ULL << depth) /
+                    (bounds.max().z - bounds.min().z));
+    }
+
+protected:
+    // Resolve an insertion of "cell" into an already-occupied tick whose
+    // resident is "curr".  The caller must have exclusive access to "curr".
+    //
+    // The point closer to "mid" stays resident, with ties broken by
+    // ltChained.  Identical points are merged into the resident cell.
+    static Insertion resolve(
+            Cell::PooledNode& curr,
+            Cell::PooledNode& cell,
+            const Point& mid,
+            std::size_t pointSize);
+
+    // True if a distinct "incoming" point should displace "resident".
+    static bool displaces(
+            const Point& incoming,
+            const Point& resident,
+            const Point& mid)
+    {
+        const auto a(incoming.sqDist3d(mid));
+        const auto b(resident.sqDist3d(mid));
+        return a < b || (a == b && ltChained(incoming, resident));
+    }
+};
+
+// The original tube implementation - an ordered map from tick to cell, guarded
+// by a tube-wide lock.
+class MapTube : public BaseTube
+{
+public:
     // If result.done() == true, then this cell has been consumed and may no
     // longer be accessed.
     //
@@ -63,35 +111,226 @@ public:
     // should not be cached through calls to insert.
     Insertion insert(const Climber& climber, Cell::PooledNode& cell);
 
+    Insertion insert(
+            uint64_t tick,
+            const Point& mid,
+            std::size_t pointSize,
+            Cell::PooledNode& cell);
+
     using Cells = std::map<uint64_t, Cell::PooledNode>;
 
     bool empty() const { return m_cells.empty(); }
-    static constexpr std::size_t maxTickDepth() { return 64; }
 
-    static std::size_t calcTick(
-            const Point& point,
-            const Bounds& bounds,
-            const std::size_t depth)
+    Cells::iterator begin() { return m_cells.begin(); }
+    Cells::iterator end() { return m_cells.end(); }
+    Cells::const_iterator begin() const { return m_cells.begin(); }
+    Cells::const_iterator end() const { return m_cells.end(); }
+
+    MapTube() = default;
+
+    MapTube(MapTube&& other) noexcept
     {
-        return
-            std::floor(
-                    (point.z - bounds.min().z) * (1ULL << depth) /
-                    (bounds.max().z - bounds.min().z));
+        m_cells = std::move(other.m_cells);
+    }
+
+    MapTube& operator=(MapTube&& other) noexcept
+    {
+        m_cells = std::move(other.m_cells);
+        return *this;
+    }
+
+private:
+    Cells m_cells;
+    SpinLock m_spinner;
+};
+
+// A flat, open-addressing table keyed by tick.  Slots are claimed with a CAS
+// rather than by locking the whole tube, and an occupied slot is only held
+// for the duration of its own swap/merge.  When a table fills, a table of
+// twice the capacity is chained behind it - slots are never freed during a
+// build, so a tick can only ever be claimed in a single slot.
+//
+// Unlike the MapTube, iteration is not ordered by tick.
+class FlatTube : public BaseTube
+{
+public:
+    using Entry = std::pair<uint64_t, Cell::PooledNode>;
+
+private:
+    class Slot
+    {
+    public:
+        enum : int { Empty, Constructing, Ready, Locked };
+
+        Slot() : m_state(Empty) { }
+        ~Slot() { if (m_state.load() != Empty) entry().~Entry(); }
+
+        std::atomic_int& state() { return m_state; }
+        bool claimed() const { return m_state.load() != Empty; }
+
+        Entry& entry() { return *reinterpret_cast<Entry*>(&m_entry); }
+
+    private:
+        std::atomic_int m_state;
+        typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type
+            m_entry;
+    };
+
+    class Table
+    {
+    public:
+        explicit Table(std::size_t capacity);
+        ~Table();
+
+        std::size_t capacity() const { return m_capacity; }
+        Slot& slot(std::size_t i) { return m_slots[i]; }
+
+        // Returns the next table in the chain, creating it if necessary.
+        Table* grow();
+        Table* next() const { return m_next.load(); }
+
+    private:
+        const std::size_t m_capacity;
+        std::unique_ptr<char[]> m_data;
+        Slot* m_slots;
+        std::atomic<Table*> m_next;
+
+        Table(const Table&) = delete;
+        Table& operator=(const Table&) = delete;
+    };
+
+    template<typename T>
+    class Iterator
+    {
+    public:
+        explicit Iterator(Table* table = nullptr)
+            : m_table(table)
+            , m_pos(0)
+        {
+            settle();
+        }
+
+        T& operator*() const { return m_table->slot(m_pos).entry(); }
+        T* operator->() const { return &**this; }
+
+        Iterator& operator++()
+        {
+            ++m_pos;
+            settle();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return m_table == other.m_table && m_pos == other.m_pos;
+        }
+
+        bool operator!=(const Iterator& other) const
+        {
+            return !(*this == other);
+        }
+
+    private:
+        // Advance to the next claimed slot, following the table chain.
+        void settle()
+        {
+            while (m_table)
+            {
+                for ( ; m_pos < m_table->capacity(); ++m_pos)
+                {
+                    if (m_table->slot(m_pos).claimed()) return;
+                }
+
+                m_table = m_table->next();
+                m_pos = 0;
+            }
+        }
+
+        Table* m_table;
+        std::size_t m_pos;
+    };
+
+public:
+    using iterator = Iterator<Entry>;
+    using const_iterator = Iterator<const Entry>;
+
+    // Semantics match MapTube::insert.
+    Insertion insert(const Climber& climber, Cell::PooledNode& cell);
+
+    Insertion insert(
+            uint64_t tick,
+            const Point& mid,
+            std::size_t pointSize,
+            Cell::PooledNode& cell);
+
+    bool empty() const { return begin() == end(); }
+
+    iterator begin() { return iterator(m_table.load()); }
+    iterator end() { return iterator(); }
+    const_iterator begin() const { return const_iterator(m_table.load()); }
+    const_iterator end() const { return const_iterator(); }
+
+    FlatTube() : m_table(nullptr) { }
+    ~FlatTube() { delete m_table.load(); }
+
+    FlatTube(FlatTube&& other) noexcept
+        : m_table(other.m_table.exchange(nullptr))
+    { }
+
+    FlatTube& operator=(FlatTube&& other) noexcept
+    {
+        delete m_table.exchange(other.m_table.exchange(nullptr));
+        return *this;
     }
 
+private:
+    Table* head();
+
+    std::atomic<Table*> m_table;
+
+    FlatTube(const FlatTube&) = delete;
+    FlatTube& operator=(const FlatTube&) = delete;
+};
+
+// Like the MapTube, but resident points are kept as records in the slab of
+// the owning chunk, and a tick maps only to the offset of its chain of
+// records.  A cell is written into the slab when it comes to rest, and is
+// materialized from it again only if it is displaced.
+class SlabTube : public BaseTube
+{
+public:
+    // Semantics match MapTube::insert.  A resting cell is consumed and
+    // returned to "pool", and a displaced one is drawn from it.
+    Insertion insert(
+            const Climber& climber,
+            Cell::PooledNode& cell,
+            PointSlab& slab,
+            PointPool& pool);
+
+    Insertion insert(
+            uint64_t tick,
+            const Point& mid,
+            Cell::PooledNode& cell,
+            PointSlab& slab,
+            PointPool& pool);
+
+    using Cells = std::map<uint64_t, PointSlab::Offset>;
+
+    bool empty() const { return m_cells.empty(); }
+
     Cells::iterator begin() { return m_cells.begin(); }
     Cells::iterator end() { return m_cells.end(); }
     Cells::const_iterator begin() const { return m_cells.begin(); }
     Cells::const_iterator end() const { return m_cells.end(); }
 
-    Tube() = default;
+    SlabTube() = default;
 
-    Tube(Tube&& other) noexcept
+    SlabTube(SlabTube&& other) noexcept
     {
         m_cells = std::move(other.m_cells);
     }
 
-    Tube& operator=(Tube&& other) noexcept
+    SlabTube& operator=(SlabTube&& other) noexcept
     {
         m_cells = std::move(other.m_cells);
         return *this;
@@ -102,5 +341,13 @@ private:
     SpinLock m_spinner;
 };
 
+#if defined(ENTWINE_SLAB_TUBE)
+using Tube = SlabTube;
+#elif defined(ENTWINE_FLAT_TUBE)
+using Tube = FlatTube;
+#else
+using Tube = MapTube;
+#endif
+
 } // namespace entwine
 
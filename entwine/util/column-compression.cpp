@@ -0,0 +1,362 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/column-compression.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include <entwine/util/compression.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Delta-coded values are bit-packed in blocks of this many, each
+    // preceded by a byte holding its bit width.
+    const std::size_t blockSize(128);
+
+    uint64_t load(const char* pos, const std::size_t size, const bool isSigned)
+    {
+        uint64_t v(0);
+        std::copy(pos, pos + size, reinterpret_cast<char*>(&v));
+
+        if (isSigned && size < 8 && (v >> (size * 8 - 1)) & 1)
+        {
+            v |= ~uint64_t(0) << (size * 8);
+        }
+
+        return v;
+    }
+
+    void store(char* pos, const uint64_t v, const std::size_t size)
+    {
+        const char* src(reinterpret_cast<const char*>(&v));
+        std::copy(src, src + size, pos);
+    }
+
+    uint64_t zigzag(const uint64_t d)
+    {
+        return (d << 1) ^ static_cast<uint64_t>(static_cast<int64_t>(d) >> 63);
+    }
+
+    uint64_t unzigzag(const uint64_t z)
+    {
+        return (z >> 1) ^ (~(z & 1) + 1);
+    }
+
+    std::size_t width(uint64_t v)
+    {
+        std::size_t w(0);
+        while (v) { ++w; v >>= 1; }
+        return w;
+    }
+
+    class BitWriter
+    {
+    public:
+        BitWriter(std::vector<char>& out) : m_out(out) { }
+
+        void put(uint64_t v, std::size_t width)
+        {
+            while (width)
+            {
+                const std::size_t n(std::min<std::size_t>(width, 8 - m_bits));
+                m_byte |= (v & ((uint64_t(1) << n) - 1)) << m_bits;
+                v >>= n;
+                width -= n;
+                m_bits += n;
+
+                if (m_bits == 8) flush();
+            }
+        }
+
+        void flush()
+        {
+            if (!m_bits) return;
+            m_out.push_back(static_cast<char>(m_byte));
+            m_byte = 0;
+            m_bits = 0;
+        }
+
+    private:
+        std::vector<char>& m_out;
+        uint8_t m_byte = 0;
+        std::size_t m_bits = 0;
+    };
+
+    class BitReader
+    {
+    public:
+        BitReader(const char* pos, const char* end) : m_pos(pos), m_end(end) { }
+
+        uint64_t get(const std::size_t width)
+        {
+            uint64_t v(0);
+            std::size_t done(0);
+
+            while (done < width)
+            {
+                if (!m_bits)
+                {
+                    if (m_pos == m_end)
+                    {
+                        throw std::runtime_error("Short column");
+                    }
+
+                    m_byte = static_cast<uint8_t>(*m_pos++);
+                    m_bits = 8;
+                }
+
+                const std::size_t n(std::min(width - done, m_bits));
+                v |= uint64_t(m_byte & ((1u << n) - 1)) << done;
+                m_byte >>= n;
+                m_bits -= n;
+                done += n;
+            }
+
+            return v;
+        }
+
+        uint8_t byte()
+        {
+            if (m_pos == m_end) throw std::runtime_error("Short column");
+            return static_cast<uint8_t>(*m_pos++);
+        }
+
+        // Skip the rest of a partially consumed byte.
+        void align() { m_bits = 0; }
+
+        bool done() const { return m_pos == m_end; }
+
+    private:
+        const char* m_pos;
+        const char* const m_end;
+        uint8_t m_byte = 0;
+        std::size_t m_bits = 0;
+    };
+
+    std::vector<char> encodeDelta(
+            const std::vector<char>& values,
+            const std::size_t valueSize,
+            const bool isSigned)
+    {
+        const std::size_t numValues(values.size() / valueSize);
+
+        std::vector<char> out;
+        BitWriter writer(out);
+
+        std::vector<uint64_t> block;
+        block.reserve(blockSize);
+
+        uint64_t prev(0);
+        const char* pos(values.data());
+
+        for (std::size_t i(0); i < numValues; i += blockSize)
+        {
+            block.clear();
+            uint64_t max(0);
+
+            const std::size_t end(std::min(numValues, i + blockSize));
+            for (std::size_t j(i); j < end; ++j)
+            {
+                const uint64_t v(load(pos, valueSize, isSigned));
+                block.push_back(zigzag(v - prev));
+                max |= block.back();
+                prev = v;
+                pos += valueSize;
+            }
+
+            const std::size_t w(width(max));
+            out.push_back(static_cast<char>(w));
+            for (const uint64_t z : block) writer.put(z, w);
+            writer.flush();
+        }
+
+        return out;
+    }
+
+    std::vector<char> decodeDelta(
+            const char* data,
+            const std::size_t size,
+            const std::size_t numValues,
+            const std::size_t valueSize,
+            const bool isSigned)
+    {
+        std::vector<char> out(numValues * valueSize);
+        BitReader reader(data, data + size);
+
+        uint64_t prev(0);
+        char* pos(out.data());
+
+        for (std::size_t i(0); i < numValues; i += blockSize)
+        {
+            const std::size_t w(reader.byte());
+            if (w > 64) throw std::runtime_error("Invalid column bit width");
+
+            const std::size_t end(std::min(numValues, i + blockSize));
+            for (std::size_t j(i); j < end; ++j)
+            {
+                prev += unzigzag(reader.get(w));
+                store(pos, prev, valueSize);
+                pos += valueSize;
+            }
+
+            reader.align();
+        }
+
+        if (!reader.done()) throw std::runtime_error("Long column");
+        return out;
+    }
+
+    // Runs are stored as a 32-bit count followed by the value.
+    std::vector<char> encodeRunLength(
+            const std::vector<char>& values,
+            const std::size_t valueSize)
+    {
+        std::vector<char> out;
+
+        const char* pos(values.data());
+        const char* end(values.data() + values.size());
+
+        while (pos < end)
+        {
+            const char* run(pos + valueSize);
+            uint32_t count(1);
+
+            while (
+                    run < end &&
+                    count < UINT32_MAX &&
+                    std::equal(pos, pos + valueSize, run))
+            {
+                run += valueSize;
+                ++count;
+            }
+
+            const char* c(reinterpret_cast<const char*>(&count));
+            out.insert(out.end(), c, c + sizeof(uint32_t));
+            out.insert(out.end(), pos, pos + valueSize);
+            pos = run;
+        }
+
+        return out;
+    }
+
+    std::vector<char> decodeRunLength(
+            const char* data,
+            const std::size_t size,
+            const std::size_t numValues,
+            const std::size_t valueSize)
+    {
+        std::vector<char> out;
+        out.reserve(numValues * valueSize);
+
+        const char* pos(data);
+        const char* end(data + size);
+
+        while (pos < end)
+        {
+            if (end - pos < static_cast<std::ptrdiff_t>(4 + valueSize))
+            {
+                throw std::runtime_error("Short run-length column");
+            }
+
+            uint32_t count(0);
+            std::copy(pos, pos + 4, reinterpret_cast<char*>(&count));
+            pos += 4;
+
+            if (out.size() / valueSize + count > numValues)
+            {
+                throw std::runtime_error("Long run-length column");
+            }
+
+            for (uint32_t i(0); i < count; ++i)
+            {
+                out.insert(out.end(), pos, pos + valueSize);
+            }
+
+            pos += valueSize;
+        }
+
+        return out;
+    }
+}
+
+std::vector<char> ColumnCompression::encode(
+        const ColumnCodec codec,
+        const std::vector<char>& values,
+        const std::size_t valueSize,
+        const bool isSigned)
+{
+    if (!valueSize || valueSize > 8 || values.size() % valueSize)
+    {
+        throw std::runtime_error("Invalid column value size");
+    }
+
+    switch (codec)
+    {
+        case ColumnCodec::Raw: return values;
+        case ColumnCodec::Delta:
+            return encodeDelta(values, valueSize, isSigned);
+        case ColumnCodec::RunLength:
+            return encodeRunLength(values, valueSize);
+        case ColumnCodec::Lzma:
+            return std::move(*Compression::compressLzma(values));
+        default: throw std::runtime_error("Invalid column codec");
+    }
+}
+
+std::vector<char> ColumnCompression::decode(
+        const ColumnCodec codec,
+        const char* data,
+        const std::size_t size,
+        const std::size_t numValues,
+        const std::size_t valueSize,
+        const bool isSigned)
+{
+    if (!valueSize || valueSize > 8)
+    {
+        throw std::runtime_error("Invalid column value size");
+    }
+
+    std::vector<char> out;
+
+    switch (codec)
+    {
+        case ColumnCodec::Raw:
+            out.assign(data, data + size);
+            break;
+        case ColumnCodec::Delta:
+            out = decodeDelta(data, size, numValues, valueSize, isSigned);
+            break;
+        case ColumnCodec::RunLength:
+            out = decodeRunLength(data, size, numValues, valueSize);
+            break;
+        case ColumnCodec::Lzma:
+            out = std::move(
+                    *Compression::decompressLzma(
+                        std::vector<char>(data, data + size)));
+            break;
+        default: throw std::runtime_error("Invalid column codec");
+    }
+
+    if (out.size() != numValues * valueSize)
+    {
+        throw std::runtime_error(
+                "Invalid " + toString(codec) + " column size");
+    }
+
+    return out;
+}
+
+} // namespace entwine
+
@@ -0,0 +1,72 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace entwine
+{
+
+// Encodings for a single column of fixed-size values.
+//
+//      Raw:        the values as they are.
+//      Delta:      the difference of each value from the previous one,
+//                  zigzagged so small negative differences stay small, and
+//                  bit-packed in blocks at the width of the block's largest.
+//                  Suited to slowly-varying integral values such as scaled
+//                  coordinates, or to GpsTime, whose bits are treated as an
+//                  integer.
+//      RunLength:  runs of equal values, each stored once with its count.
+//                  Suited to categorical values such as Classification.
+//      Lzma:       general purpose byte compression for everything else.
+enum class ColumnCodec : char { Raw = 0, Delta, RunLength, Lzma };
+
+inline std::string toString(const ColumnCodec c)
+{
+    switch (c)
+    {
+        case ColumnCodec::Raw: return "raw";
+        case ColumnCodec::Delta: return "delta";
+        case ColumnCodec::RunLength: return "runLength";
+        case ColumnCodec::Lzma: return "lzma";
+        default: throw std::runtime_error("Invalid ColumnCodec value");
+    }
+}
+
+class ColumnCompression
+{
+public:
+    // Values are valueSize bytes each, and packed contiguously.  The signed
+    // flag applies to the Delta codec, which must sign-extend values narrower
+    // than 64 bits so that differences across zero stay small.
+    static std::vector<char> encode(
+            ColumnCodec codec,
+            const std::vector<char>& values,
+            std::size_t valueSize,
+            bool isSigned);
+
+    // Throws if the encoded data does not hold exactly numValues values.
+    static std::vector<char> decode(
+            ColumnCodec codec,
+            const char* data,
+            std::size_t size,
+            std::size_t numValues,
+            std::size_t valueSize,
+            bool isSigned);
+
+    ColumnCompression() = delete;
+};
+
+} // namespace entwine
+
@@ -115,6 +115,15 @@ Cell::PooledStack Compression::decompress(
         const std::vector<char>& data,
         const std::size_t numPoints,
         PointPool& pointPool)
+{
+    return decompress(data.data(), data.size(), numPoints, pointPool);
+}
+
+Cell::PooledStack Compression::decompress(
+        const char* const data,
+        const std::size_t size,
+        const std::size_t numPoints,
+        PointPool& pointPool)
 {
     Data::PooledStack dataStack(pointPool.dataPool().acquire(numPoints));
     Cell::PooledStack cellStack(pointPool.cellPool().acquire(numPoints));
@@ -140,7 +149,7 @@ Cell::PooledStack Compression::decompress(
 
     auto decompressor(
             makeUnique<pdal::LazPerfDecompressor>(cb, dimTypes, numPoints));
-    decompressor->decompress(data.data(), data.size());
+    decompressor->decompress(data, size);
     decompressor->done();
 
     assert(dataStack.empty());
@@ -53,6 +53,12 @@ public:
             std::size_t numPoints,
             PointPool& pointPool);
 
+    static Cell::PooledStack decompress(
+            const char* data,
+            std::size_t size,
+            std::size_t numPoints,
+            PointPool& pointPool);
+
     static std::unique_ptr<std::vector<char>> compressLzma(
             const std::vector<char>& data);
 
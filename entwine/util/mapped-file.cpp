@@ -0,0 +1,188 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/mapped-file.hpp>
+
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/io.hpp>
+#include <entwine/util/range-reader.hpp>
+#include <entwine/util/unique.hpp>
+
+namespace entwine
+{
+
+namespace
+{
+    // Throws RangeReader::Unranged if the server ignores the range.
+    std::shared_ptr<std::vector<char>> getRange(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path,
+            const std::size_t begin,
+            const std::size_t end)
+    {
+        auto data(std::make_shared<std::vector<char>>());
+
+        RangeReader reader(endpoint, path, begin, end, end - begin, 0);
+        *data = reader.next();
+
+        return data;
+    }
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+    munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+std::unique_ptr<MappedFile> MappedFile::map(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path)
+{
+    std::unique_ptr<MappedFile> result;
+
+#ifndef _WIN32
+    if (!endpoint.isLocal()) return result;
+
+    const std::string full(arbiter::fs::expandTilde(endpoint.fullPath(path)));
+
+    const int fd(open(full.c_str(), O_RDONLY));
+    if (fd == -1) return result;
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        const std::size_t size(info.st_size);
+        void* data(mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+
+        if (data != MAP_FAILED)
+        {
+            result.reset(new MappedFile(static_cast<const char*>(data), size));
+        }
+    }
+
+    // The mapping holds its own reference to the file.
+    close(fd);
+#endif
+
+    return result;
+}
+
+FileView::FileView(const arbiter::Endpoint& endpoint, const std::string& path)
+    : m_mapped(MappedFile::map(endpoint, path))
+    , m_read()
+    , m_offset(0)
+    , m_size(0)
+{
+    if (!m_mapped) m_read = io::ensureGet(endpoint, path);
+    m_size = m_mapped ? m_mapped->size() : m_read->size();
+}
+
+FileView::FileView(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const std::size_t offset,
+        const std::size_t size)
+    : m_mapped(MappedFile::map(endpoint, path))
+    , m_read()
+    , m_offset(offset)
+    , m_size(size)
+{
+    std::size_t full(0);
+
+    if (m_mapped)
+    {
+        full = m_mapped->size();
+    }
+    else if (endpoint.isHttpDerived())
+    {
+        m_read = getRange(endpoint, path, offset, offset + size);
+
+        if (m_read->size() != size)
+        {
+            throw std::runtime_error("Invalid range of " + path);
+        }
+
+        m_offset = 0;
+        full = m_read->size();
+    }
+    else
+    {
+        m_read = io::ensureGet(endpoint, path);
+        full = m_read->size();
+    }
+
+    if (m_offset + m_size > full)
+    {
+        throw std::runtime_error("Invalid range of " + path);
+    }
+}
+
+FileView::FileView(
+        std::shared_ptr<const std::vector<char>> data,
+        const std::size_t offset,
+        const std::size_t size)
+    : m_mapped()
+    , m_read(data)
+    , m_offset(offset)
+    , m_size(size)
+{
+    if (m_offset + m_size > m_read->size())
+    {
+        throw std::runtime_error("Invalid range of read data");
+    }
+}
+
+std::unique_ptr<FileView> FileView::last(
+        const arbiter::Endpoint& endpoint,
+        const std::string& path,
+        const std::size_t size)
+{
+    if (!endpoint.isLocal() && endpoint.isHttpDerived())
+    {
+        const auto full(endpoint.tryGetSize(path));
+
+        if (full && *full > size)
+        {
+            try
+            {
+                return makeUnique<FileView>(
+                        endpoint,
+                        path,
+                        *full - size,
+                        size);
+            }
+            catch (const RangeReader::Unranged&)
+            {
+                // The whole file ends with the same tail.
+            }
+        }
+    }
+
+    return makeUnique<FileView>(endpoint, path);
+}
+
+const char* FileView::data() const
+{
+    return (m_mapped ? m_mapped->data() : m_read->data()) + m_offset;
+}
+
+} // namespace entwine
+
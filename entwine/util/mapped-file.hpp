@@ -0,0 +1,92 @@
+/******************************************************************************
+* Copyright (c) 2017, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace entwine
+{
+
+namespace arbiter { class Endpoint; }
+
+// A read-only memory mapping of a local file.  The mapped pages are backed by
+// the filesystem cache rather than our heap, so they may be shared by every
+// reader of the file and reclaimed by the kernel under memory pressure.
+class MappedFile
+{
+public:
+    ~MappedFile();
+
+    // Returns nullptr if the file cannot be mapped - for example if the
+    // endpoint is not local, the file is empty, or mapping is unsupported on
+    // this platform - in which case callers should fall back to reading it.
+    static std::unique_ptr<MappedFile> map(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path);
+
+    const char* data() const { return m_data; }
+    std::size_t size() const { return m_size; }
+
+private:
+    MappedFile(const char* data, std::size_t size)
+        : m_data(data)
+        , m_size(size)
+    { }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* const m_data;
+    const std::size_t m_size;
+};
+
+// The contents of a file, or of a range of it, mapped if possible and
+// otherwise read.  Ranges of HTTP-derived files are fetched with range
+// requests, and RangeReader::Unranged is thrown if their server ignores them.
+class FileView
+{
+public:
+    FileView(const arbiter::Endpoint& endpoint, const std::string& path);
+    FileView(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path,
+            std::size_t offset,
+            std::size_t size);
+
+    // A range of data which has already been read.
+    FileView(
+            std::shared_ptr<const std::vector<char>> data,
+            std::size_t offset,
+            std::size_t size);
+
+    // At least the last size bytes of the file, and possibly all of it.
+    static std::unique_ptr<FileView> last(
+            const arbiter::Endpoint& endpoint,
+            const std::string& path,
+            std::size_t size);
+
+    const char* data() const;
+    std::size_t size() const { return m_size; }
+
+    bool mapped() const { return !!m_mapped; }
+
+private:
+    std::unique_ptr<MappedFile> m_mapped;
+    std::shared_ptr<const std::vector<char>> m_read;
+    std::size_t m_offset;
+    std::size_t m_size;
+};
+
+} // namespace entwine
+
@@ -0,0 +1,70 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/point.hpp>
+
+namespace entwine
+{
+namespace morton
+{
+
+// Bits of resolution per dimension for a 64-bit, three-dimensional key.
+static constexpr std::size_t bitsPerDim = 21;
+static constexpr uint64_t maxCoord = (1ULL << bitsPerDim) - 1;
+
+// Spread the low 21 bits of v so that there are two zero bits between each of
+// them.  Branch-free, so loops over arrays of coordinates vectorize well.
+inline uint64_t spread(uint64_t v)
+{
+    v &= maxCoord;
+    v = (v | v << 32) & 0x001f00000000ffffULL;
+    v = (v | v << 16) & 0x001f0000ff0000ffULL;
+    v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2)  & 0x1249249249249249ULL;
+    return v;
+}
+
+// Interleave integral coordinates with bit-ordering matching entwine::Dir: X
+// is the least significant, followed by Y, then Z.
+inline uint64_t encode(uint64_t x, uint64_t y, uint64_t z)
+{
+    return spread(x) | spread(y) << 1 | spread(z) << 2;
+}
+
+// Quantize a coordinate to the range [0, maxCoord] within [min, max).
+inline uint64_t quantize(double v, double min, double max)
+{
+    const double n((v - min) / (max - min) * (maxCoord + 1));
+    if (n <= 0) return 0;
+    return std::min<uint64_t>(static_cast<uint64_t>(n), maxCoord);
+}
+
+// The key of a point within the given bounds.  Sorting by this key groups
+// points by their octree node at every depth up to bitsPerDim.
+inline uint64_t key(const Point& p, const Bounds& b)
+{
+    return encode(
+            quantize(p.x, b.min().x, b.max().x),
+            quantize(p.y, b.min().y, b.max().y),
+            quantize(p.z, b.min().z, b.max().z));
+}
+
+} // namespace morton
+} // namespace entwine
+
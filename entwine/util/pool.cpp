@@ -10,15 +10,41 @@
 
 #include <entwine/util/pool.hpp>
 
+#include <chrono>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 
 namespace entwine
 {
 
+namespace
+{
+    // The pool, if any, for which the current thread is a worker, and its
+    // index within that pool.
+    thread_local const Pool* currentPool(nullptr);
+    thread_local std::size_t currentIndex(0);
+
+    const std::size_t high(static_cast<std::size_t>(Pool::Priority::High));
+    const std::size_t normal(static_cast<std::size_t>(Pool::Priority::Normal));
+}
+
+constexpr std::size_t Pool::numPriorities;
+
 Pool::Pool(const std::size_t numThreads, const std::size_t queueSize)
     : m_numThreads(std::max<std::size_t>(numThreads, 1))
     , m_queueSize(std::max<std::size_t>(queueSize, 1))
+    , m_queued(0)
+    , m_queuedHigh(0)
+    , m_outstanding(0)
+    , m_blocked(0)
+    , m_awaiting(0)
+    , m_sleeping(0)
+    , m_active(0)
+    , m_limit(m_numThreads)
+    , m_busy(0)
+    , m_next(0)
+    , m_running(false)
 {
     go();
 }
@@ -34,9 +60,19 @@ void Pool::go()
     if (m_running) return;
     m_running = true;
 
+    // Our deques are all empty after a join, so only their count matters.
+    if (m_workers.size() != m_numThreads)
+    {
+        m_workers.clear();
+        for (std::size_t i(0); i < m_numThreads; ++i)
+        {
+            m_workers.emplace_back(new Worker());
+        }
+    }
+
     for (std::size_t i(0); i < m_numThreads; ++i)
     {
-        m_threads.emplace_back([this]() { work(); });
+        m_threads.emplace_back([this, i]() { work(i); });
     }
 }
 
@@ -55,80 +91,246 @@ void Pool::join()
 void Pool::await()
 {
     std::unique_lock<std::mutex> lock(m_mutex);
-    m_produceCv.wait(lock, [this]()
+    ++m_awaiting;
+    m_awaitCv.wait(lock, [this]()
     {
-        return !m_outstanding && m_tasks.empty();
+        return !m_outstanding && !m_queued;
     });
+    --m_awaiting;
 }
 
-void Pool::add(std::function<void()> task)
+bool Pool::push(Task task, const Priority priority, const bool wait)
 {
-    std::unique_lock<std::mutex> lock(m_mutex);
-
-    if (!m_running)
+    // Our own tasks may still spawn others while we are being joined, since
+    // the worker running them will not return until the queue is empty.
+    if (!m_running && currentPool != this)
     {
         throw std::runtime_error("Attempted to add a task to a stopped Pool");
     }
 
-    m_produceCv.wait(lock, [this]() { return m_tasks.size() < m_queueSize; });
-    m_tasks.emplace(task);
+    if (!reserve(wait)) return false;
 
-    // Notify worker that a task is available.
-    lock.unlock();
-    m_consumeCv.notify_all();
+    // Our own workers keep the tasks they spawn, others are dealt out evenly.
+    const std::size_t index(
+            currentPool == this ?
+                currentIndex : m_next++ % m_workers.size());
+
+    const std::size_t p(static_cast<std::size_t>(priority));
+
+    Worker& worker(*m_workers[index]);
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.tasks[p].push_back(std::move(task));
+    }
+
+    if (p == high) ++m_queuedHigh;
+
+    // Notify a single worker that a task is available.  Taking the lock
+    // ensures that a worker on its way to sleep sees the task first.
+    if (m_sleeping)
+    {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_consumeCv.notify_one();
+    }
+
+    return true;
 }
 
-void Pool::work()
+bool Pool::reserve(const bool wait)
 {
+    std::size_t queued(m_queued);
+
     while (true)
     {
-        std::unique_lock<std::mutex> lock(m_mutex);
-        m_consumeCv.wait(lock, [this]()
+        if (queued < m_queueSize)
         {
-            return m_tasks.size() || !m_running;
-        });
+            if (m_queued.compare_exchange_weak(queued, queued + 1))
+            {
+                return true;
+            }
+        }
+        else if (!wait)
+        {
+            return false;
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ++m_blocked;
+            m_produceCv.wait(lock, [this]() { return m_queued < m_queueSize; });
+            --m_blocked;
+
+            queued = m_queued;
+        }
+    }
+}
+
+bool Pool::take(const std::size_t index, Task& task)
+{
+    const std::size_t n(m_workers.size());
 
-        if (m_tasks.size())
+    for (const std::size_t p : { high, normal })
+    {
+        if (p == high && !m_queuedHigh) continue;
+
+        for (std::size_t i(0); i < n && !task; ++i)
         {
-            ++m_outstanding;
-            auto task(std::move(m_tasks.front()));
-            m_tasks.pop();
+            Worker& worker(*m_workers[(index + i) % n]);
+            std::lock_guard<std::mutex> lock(worker.mutex);
 
-            lock.unlock();
+            auto& tasks(worker.tasks[p]);
+            if (tasks.empty()) continue;
 
-            // Notify add(), which may be waiting for a spot in the queue.
-            m_produceCv.notify_all();
+            // Newest first from our own deque, oldest first from others.
+            if (!i)
+            {
+                task = std::move(tasks.back());
+                tasks.pop_back();
+            }
+            else
+            {
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+        }
 
-            std::string err;
-            try { task(); }
-            catch (std::exception& e) { err = e.what(); }
-            catch (...) { err = "Unknown error"; }
+        if (task)
+        {
+            // Count it as outstanding before it leaves the queue, so await()
+            // never sees neither.
+            ++m_outstanding;
+            --m_queued;
+            if (p == high) --m_queuedHigh;
 
-            lock.lock();
-            --m_outstanding;
-            if (err.size())
+            // Notify add(), which may be waiting for a spot in the queue.
+            if (m_blocked)
             {
-                std::cout << "Exception in pool task: " << err << std::endl;
-                m_errors.push_back(err);
+                { std::lock_guard<std::mutex> lock(m_mutex); }
+                m_produceCv.notify_one();
             }
-            lock.unlock();
 
-            // Notify await(), which may be waiting for a running task.
-            m_produceCv.notify_all();
+            return true;
         }
-        else if (!m_running)
+    }
+
+    return false;
+}
+
+bool Pool::admit()
+{
+    std::size_t active(m_active);
+
+    while (active < m_limit)
+    {
+        if (m_active.compare_exchange_weak(active, active + 1)) return true;
+    }
+
+    return false;
+}
+
+void Pool::dismiss()
+{
+    --m_active;
+
+    // Wake a worker parked by our limit if there is work for it, or all of
+    // them if we are being joined and there is nothing left to do.
+    if (m_sleeping && (m_queued || !m_running))
+    {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        if (m_queued) m_consumeCv.notify_one();
+        else m_consumeCv.notify_all();
+    }
+}
+
+void Pool::run(Task& task)
+{
+    const auto start(std::chrono::steady_clock::now());
+
+    std::string err;
+    try { task(); }
+    catch (std::exception& e) { err = e.what(); }
+    catch (...) { err = "Unknown error"; }
+
+    m_busy += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+
+    // Release anything captured by the task before anyone awaiting it may
+    // return.
+    task.reset();
+
+    if (err.size())
+    {
+        std::lock_guard<std::mutex> lock(m_errorMutex);
+        std::cout << "Exception in pool task: " << err << std::endl;
+        m_errors.push_back(err);
+    }
+
+    // Notify await(), which may be waiting for a running task.
+    if (!--m_outstanding && !m_queued && m_awaiting)
+    {
+        { std::lock_guard<std::mutex> lock(m_mutex); }
+        m_awaitCv.notify_all();
+    }
+}
+
+void Pool::work(const std::size_t index)
+{
+    currentPool = this;
+    currentIndex = index;
+
+    Task task;
+
+    while (true)
+    {
+        if (admit())
+        {
+            const bool taken(take(index, task));
+            if (taken) run(task);
+            dismiss();
+
+            if (taken) continue;
+        }
+
+        if (m_queued && m_active < m_limit)
+        {
+            // A spot has been reserved, but its task is not yet pushed.
+            std::this_thread::yield();
+        }
+        else
         {
-            return;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (!m_running && !m_queued) break;
+
+            ++m_sleeping;
+            m_consumeCv.wait(lock, [this]()
+            {
+                return
+                    (m_queued && m_active < m_limit) ||
+                    (!m_running && !m_queued);
+            });
+            --m_sleeping;
         }
     }
+
+    currentPool = nullptr;
 }
 
 void Pool::resize(const std::size_t numThreads)
 {
     join();
-    m_numThreads = numThreads;
+    m_numThreads = std::max<std::size_t>(numThreads, 1);
+    m_limit = m_numThreads;
     go();
 }
 
+void Pool::limit(const std::size_t numActive)
+{
+    m_limit = std::max<std::size_t>(std::min(numActive, m_numThreads), 1);
+
+    // Parked workers may now be allowed to run.
+    { std::lock_guard<std::mutex> lock(m_mutex); }
+    m_consumeCv.notify_all();
+}
+
 } // namespace entwine
 
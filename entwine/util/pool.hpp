@@ -10,20 +10,43 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <deque>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <entwine/util/task.hpp>
+
 namespace entwine
 {
 
+// A work-stealing thread pool.  Each worker thread owns a deque of tasks per
+// priority.  Tasks added from outside of the pool are dealt to the workers in
+// turn, while tasks added by one of our own workers are pushed to its own
+// deque.  Workers run their own newest tasks first, and when they run dry,
+// steal the oldest tasks of the others.  An idle worker sleeps until a task
+// is added, at which point a single sleeping worker is woken.
 class Pool
 {
 public:
+    // High priority tasks are run, or stolen, before any normal ones.
+    enum class Priority
+    {
+        Normal,
+        High
+    };
+
     // After numThreads tasks are actively running, and queueSize tasks have
     // been enqueued to wait for an available worker thread, subsequent calls
     // to Pool::add will block until an enqueued task has been popped from the
@@ -52,30 +75,119 @@ public:
     const std::vector<std::string>& errors() const { return m_errors; }
 
     // Add a threaded task, blocking until a thread is available.  If join() is
-    // called, add() may not be called again until go() is called and completes.
-    void add(std::function<void()> task);
+    // called, add() may not be called again until go() is called and completes,
+    // except from within a task running on this pool.
+    template<typename Fn>
+    void add(Fn&& task, Priority priority = Priority::Normal)
+    {
+        push(Task(std::forward<Fn>(task)), priority);
+    }
+
+    // As add(), but rather than blocking while the queue is full, returns
+    // false without having added the task.  A task which spawns others may
+    // use this to run them itself when no other worker would pick them up.
+    template<typename Fn>
+    bool tryAdd(Fn&& task, Priority priority = Priority::Normal)
+    {
+        return push(Task(std::forward<Fn>(task)), priority, false);
+    }
+
+    // As add(), but the result of the task - or the exception it throws - is
+    // delivered through the returned future rather than to errors().
+    template<typename Fn>
+    std::future<typename std::result_of<Fn()>::type> submit(
+            Fn&& f,
+            Priority priority = Priority::Normal)
+    {
+        using Result = typename std::result_of<Fn()>::type;
+
+        std::packaged_task<Result()> task(std::forward<Fn>(f));
+        std::future<Result> future(task.get_future());
+        push(Task(std::move(task)), priority);
+        return future;
+    }
 
     std::size_t size() const { return m_numThreads; }
     std::size_t numThreads() const { return m_numThreads; }
 
+    // Allow at most numActive of our threads to run tasks at once - the rest
+    // are parked rather than joined, so the limit may be raised again cheaply.
+    // Resizing resets the limit to the number of threads.
+    void limit(std::size_t numActive);
+    std::size_t limit() const { return m_limit; }
+
+    // Load statistics, which are only a snapshot of a moving target.
+    std::size_t queued() const { return m_queued; }
+    std::size_t active() const { return m_outstanding; }
+    std::size_t blocked() const { return m_blocked; }
+
+    // Total time spent running tasks.
+    std::chrono::nanoseconds busy() const
+    {
+        return std::chrono::nanoseconds(m_busy.load());
+    }
+
 private:
+    static constexpr std::size_t numPriorities = 2;
+
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks[numPriorities];
+    };
+
+    // Returns false if the queue is full and we may not wait for it.
+    bool push(Task task, Priority priority, bool wait = true);
+
+    // Claim a spot in the queue, blocking while it is full if wait is set.
+    // Otherwise returns false if it is full.
+    bool reserve(bool wait);
+
     // Worker thread function.  Wait for a task and run it - or if stop() is
     // called, complete any outstanding task and return.
-    void work();
+    void work(std::size_t index);
+
+    // Pop a task for the given worker, stealing one if it has none of its own.
+    bool take(std::size_t index, Task& task);
+    void run(Task& task);
+
+    // Claim, and later release, one of the running spots under our limit.
+    bool admit();
+    void dismiss();
 
     std::size_t m_numThreads;
     std::size_t m_queueSize;
     std::vector<std::thread> m_threads;
-    std::queue<std::function<void()>> m_tasks;
+    std::vector<std::unique_ptr<Worker>> m_workers;
 
     std::vector<std::string> m_errors;
     std::mutex m_errorMutex;
 
-    std::size_t m_outstanding = 0;
-    bool m_running = false;
+    // Tasks which have been added but not yet taken by a worker, and the
+    // portion of those which are of high priority.
+    std::atomic_size_t m_queued;
+    std::atomic_size_t m_queuedHigh;
+
+    // Tasks which have been taken by a worker but have not yet completed.
+    std::atomic_size_t m_outstanding;
+
+    // Threads blocked in add(), await(), or idle in work(), respectively.  We
+    // only need to take the mutex to wake them if there are any.
+    std::atomic_size_t m_blocked;
+    std::atomic_size_t m_awaiting;
+    std::atomic_size_t m_sleeping;
+
+    // Workers which have been admitted under our limit.
+    std::atomic_size_t m_active;
+    std::atomic_size_t m_limit;
+    std::atomic<uint64_t> m_busy;
+
+    std::atomic_size_t m_next;
+    std::atomic_bool m_running;
 
     mutable std::mutex m_mutex;
     std::condition_variable m_produceCv;
+    std::condition_variable m_awaitCv;
     std::condition_variable m_consumeCv;
 
     // Disable copy/assignment.
@@ -0,0 +1,216 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#include <entwine/util/range-reader.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <entwine/util/pool.hpp>
+
+namespace entwine
+{
+
+RangeReader::RangeReader(
+        const arbiter::Arbiter& arbiter,
+        const std::string path,
+        const std::size_t size,
+        const std::size_t blockSize,
+        const std::size_t ahead)
+    : RangeReader(
+            [&arbiter, path](arbiter::http::Headers headers)
+            {
+                return arbiter.getBinary(path, headers);
+            },
+            path,
+            0,
+            size,
+            blockSize,
+            ahead)
+{ }
+
+RangeReader::RangeReader(
+        const arbiter::Endpoint& endpoint,
+        const std::string path,
+        const std::size_t begin,
+        const std::size_t end,
+        const std::size_t blockSize,
+        const std::size_t ahead)
+    : RangeReader(
+            [endpoint, path](arbiter::http::Headers headers)
+            {
+                return endpoint.getBinary(path, headers);
+            },
+            endpoint.prefixedFullPath(path),
+            begin,
+            end,
+            blockSize,
+            ahead)
+{ }
+
+RangeReader::RangeReader(
+        const Get get,
+        const std::string path,
+        const std::size_t begin,
+        const std::size_t end,
+        const std::size_t blockSize,
+        const std::size_t ahead)
+    : m_get(get)
+    , m_path(path)
+    , m_end(end)
+    , m_blockSize(std::max<std::size_t>(blockSize, 1))
+    , m_offset(begin)
+    , m_unranged(false)
+    , m_pool(new Pool(std::max<std::size_t>(ahead, 1), ahead + 1))
+    , m_pending()
+{
+    while (m_offset < m_end && m_pending.size() <= ahead) request();
+}
+
+RangeReader::~RangeReader()
+{
+    // Outstanding requests refer to us, so must finish before we go.
+    m_pool->join();
+}
+
+std::vector<char> RangeReader::next()
+{
+    if (m_pending.empty()) return std::vector<char>();
+
+    std::future<std::vector<char>> pending(std::move(m_pending.front()));
+    m_pending.pop_front();
+
+    std::vector<char> block(pending.get());
+
+    if (m_offset < m_end) request();
+    return block;
+}
+
+void RangeReader::request()
+{
+    const std::size_t begin(m_offset);
+    const std::size_t end(std::min(m_offset + m_blockSize, m_end));
+    m_offset = end;
+
+    m_pending.push_back(m_pool->submit([this, begin, end]()
+    {
+        if (m_unranged) throw Unranged(m_path);
+
+        arbiter::http::Headers headers;
+        headers["Range"] =
+            "bytes=" + std::to_string(begin) + "-" + std::to_string(end - 1);
+
+        std::vector<char> block(m_get(headers));
+
+        if (block.size() != end - begin)
+        {
+            // A response spanning the file through the end of our range, and
+            // so likely all of it, will not change on a retry.
+            if (block.size() >= m_end)
+            {
+                m_unranged = true;
+                throw Unranged(m_path);
+            }
+
+            throw std::runtime_error("Unexpected range size from " + m_path);
+        }
+
+        return block;
+    }));
+}
+
+std::unique_ptr<LocalFile> LocalFile::fetch(
+        const arbiter::Arbiter& arbiter,
+        const std::string& path,
+        const arbiter::Endpoint& tmp,
+        const std::size_t blockSize,
+        const std::size_t ahead)
+{
+    std::unique_ptr<std::size_t> size;
+
+    if (arbiter.isHttpDerived(path) && tmp.isLocal())
+    {
+        size = arbiter.tryGetSize(path);
+    }
+
+    if (!size)
+    {
+        return std::unique_ptr<LocalFile>(
+                new LocalFile(arbiter.getLocalHandle(path, tmp)));
+    }
+
+    std::string name(path);
+    std::replace(name.begin(), name.end(), '/', '-');
+    std::replace(name.begin(), name.end(), '\\', '-');
+    std::replace(name.begin(), name.end(), ':', '_');
+
+    // Owned from here on, so a partial download is removed if we throw.
+    std::unique_ptr<LocalFile> local(new LocalFile(tmp.fullPath(name)));
+
+    std::ofstream file(
+            local->localPath(),
+            std::ofstream::binary | std::ofstream::out | std::ofstream::trunc);
+
+    if (!file.good())
+    {
+        throw std::runtime_error("Could not open " + local->localPath());
+    }
+
+    try
+    {
+        RangeReader reader(arbiter, path, *size, blockSize, ahead);
+        while (!reader.done())
+        {
+            const std::vector<char> block(reader.next());
+            file.write(block.data(), block.size());
+        }
+    }
+    catch (const RangeReader::Unranged&)
+    {
+        // Fetch the file once in full, rather than once per range.
+        file.close();
+        local.reset();
+
+        return std::unique_ptr<LocalFile>(
+                new LocalFile(arbiter.getLocalHandle(path, tmp)));
+    }
+
+    file.close();
+
+    if (!file.good())
+    {
+        throw std::runtime_error("Could not write " + local->localPath());
+    }
+
+    return local;
+}
+
+LocalFile::LocalFile(std::unique_ptr<arbiter::fs::LocalHandle> handle)
+    : m_handle(std::move(handle))
+    , m_downloaded()
+{ }
+
+LocalFile::LocalFile(const std::string downloaded)
+    : m_handle()
+    , m_downloaded(downloaded)
+{ }
+
+LocalFile::~LocalFile()
+{
+    if (!m_downloaded.empty()) arbiter::fs::remove(m_downloaded);
+}
+
+std::string LocalFile::localPath() const
+{
+    return m_handle ? m_handle->localPath() : m_downloaded;
+}
+
+} // namespace entwine
@@ -0,0 +1,124 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+
+namespace entwine
+{
+
+class Pool;
+
+// Reads an HTTP-derived file in order as a series of byte ranges.  Up to
+// `ahead` ranges are requested beyond the one being consumed, so network
+// latency overlaps with whatever the consumer does with each block, while
+// only a bounded number of blocks is held in memory at once.
+class RangeReader
+{
+public:
+    // Thrown by next() if the server answered a range request with the whole
+    // file, as servers which do not support ranges do.  No further ranges are
+    // requested once this is seen.
+    class Unranged : public std::runtime_error
+    {
+    public:
+        explicit Unranged(const std::string& path)
+            : std::runtime_error("Range requests unsupported for " + path)
+        { }
+    };
+
+    RangeReader(
+            const arbiter::Arbiter& arbiter,
+            std::string path,
+            std::size_t size,
+            std::size_t blockSize,
+            std::size_t ahead);
+
+    // Reads only the bytes [begin, end) of a file within an endpoint.
+    RangeReader(
+            const arbiter::Endpoint& endpoint,
+            std::string path,
+            std::size_t begin,
+            std::size_t end,
+            std::size_t blockSize,
+            std::size_t ahead);
+
+    ~RangeReader();
+
+    // The next block of the file, or an empty one once all have been read.
+    // Throws if its range could not be fetched.
+    std::vector<char> next();
+
+    bool done() const { return m_pending.empty(); }
+
+private:
+    using Get = std::function<std::vector<char>(arbiter::http::Headers)>;
+
+    RangeReader(
+            Get get,
+            std::string path,
+            std::size_t begin,
+            std::size_t end,
+            std::size_t blockSize,
+            std::size_t ahead);
+
+    void request();
+
+    const Get m_get;
+    const std::string m_path;
+    const std::size_t m_end;
+    const std::size_t m_blockSize;
+
+    std::size_t m_offset;
+    std::atomic<bool> m_unranged;
+    std::unique_ptr<Pool> m_pool;
+    std::deque<std::future<std::vector<char>>> m_pending;
+};
+
+// A local copy of a possibly remote file, which is removed when destroyed if
+// it was downloaded.
+class LocalFile
+{
+public:
+    // Remote HTTP-derived files of known size are streamed to disk through a
+    // RangeReader, so a download holds a bounded amount of memory rather than
+    // its entire file.  Anything else, or a file whose server ignores range
+    // requests, is fetched by arbiter.
+    static std::unique_ptr<LocalFile> fetch(
+            const arbiter::Arbiter& arbiter,
+            const std::string& path,
+            const arbiter::Endpoint& tmp,
+            std::size_t blockSize,
+            std::size_t ahead);
+
+    ~LocalFile();
+
+    std::string localPath() const;
+
+private:
+    explicit LocalFile(std::unique_ptr<arbiter::fs::LocalHandle> handle);
+    explicit LocalFile(std::string downloaded);
+
+    std::unique_ptr<arbiter::fs::LocalHandle> m_handle;
+    std::string m_downloaded;
+};
+
+} // namespace entwine
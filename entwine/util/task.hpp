@@ -0,0 +1,173 @@
+/******************************************************************************
+* Copyright (c) 2016, Connor Manning (connor@hobu.co)
+*
+* Entwine -- Point cloud indexing
+*
+* Entwine is available under the terms of the LGPL2 license. See COPYING
+* for specific license text and more information.
+*
+******************************************************************************/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace entwine
+{
+
+// A move-only, type-erased nullary callable.  Callables of up to inlineSize
+// bytes are stored in place, so wrapping a typical lambda allocates nothing -
+// larger ones are moved to the heap.  Unlike std::function, move-only
+// callables such as std::packaged_task may be wrapped.
+class Task
+{
+public:
+    static constexpr std::size_t inlineSize = 64;
+
+    Task() : m_ops(nullptr) { }
+
+    template<
+        typename F,
+        typename = typename std::enable_if<
+            !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F&& f)
+        : m_ops(nullptr)
+    {
+        using Fn = typename std::decay<F>::type;
+        using Store = typename std::conditional<
+            fitsInline<Fn>(), Inline<Fn>, Heap<Fn>>::type;
+
+        Store::create(storage(), std::forward<F>(f));
+        m_ops = &Store::ops;
+    }
+
+    Task(Task&& other) noexcept
+        : m_ops(other.m_ops)
+    {
+        if (m_ops)
+        {
+            m_ops->move(storage(), other.storage());
+            other.reset();
+        }
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other)
+        {
+            reset();
+
+            if (other.m_ops)
+            {
+                m_ops = other.m_ops;
+                m_ops->move(storage(), other.storage());
+                other.reset();
+            }
+        }
+
+        return *this;
+    }
+
+    ~Task() { reset(); }
+
+    explicit operator bool() const { return !!m_ops; }
+
+    void operator()() { m_ops->call(storage()); }
+
+    // Destroy the wrapped callable, and anything it has captured.
+    void reset()
+    {
+        if (m_ops)
+        {
+            m_ops->destroy(storage());
+            m_ops = nullptr;
+        }
+    }
+
+private:
+    using Storage = typename std::aligned_storage<
+        inlineSize,
+        alignof(std::max_align_t)>::type;
+
+    struct Ops
+    {
+        void (*call)(void*);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void*);
+    };
+
+    template<typename Fn> static constexpr bool fitsInline()
+    {
+        return
+            sizeof(Fn) <= inlineSize &&
+            alignof(Fn) <= alignof(std::max_align_t) &&
+            std::is_nothrow_move_constructible<Fn>::value;
+    }
+
+    template<typename Fn> struct Inline
+    {
+        template<typename F> static void create(void* s, F&& f)
+        {
+            new (s) Fn(std::forward<F>(f));
+        }
+
+        static Fn& get(void* s) { return *static_cast<Fn*>(s); }
+
+        static void call(void* s) { get(s)(); }
+        static void move(void* dst, void* src)
+        {
+            new (dst) Fn(std::move(get(src)));
+        }
+        static void destroy(void* s) { get(s).~Fn(); }
+
+        static const Ops ops;
+    };
+
+    template<typename Fn> struct Heap
+    {
+        template<typename F> static void create(void* s, F&& f)
+        {
+            new (s) Fn*(new Fn(std::forward<F>(f)));
+        }
+
+        static Fn*& get(void* s) { return *static_cast<Fn**>(s); }
+
+        static void call(void* s) { (*get(s))(); }
+        static void move(void* dst, void* src)
+        {
+            new (dst) Fn*(get(src));
+            get(src) = nullptr;
+        }
+        static void destroy(void* s) { delete get(s); }
+
+        static const Ops ops;
+    };
+
+    void* storage() { return &m_storage; }
+
+    Storage m_storage;
+    const Ops* m_ops;
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+};
+
+template<typename Fn>
+const Task::Ops Task::Inline<Fn>::ops = {
+    &Task::Inline<Fn>::call,
+    &Task::Inline<Fn>::move,
+    &Task::Inline<Fn>::destroy
+};
+
+template<typename Fn>
+const Task::Ops Task::Heap<Fn>::ops = {
+    &Task::Heap<Fn>::call,
+    &Task::Heap<Fn>::move,
+    &Task::Heap<Fn>::destroy
+};
+
+} // namespace entwine
+
@@ -497,9 +497,14 @@ void Kernel::build(std::vector<std::string> args)
         std::cout << "\tTrust file headers? " << yesNo(false) << "\n";
     }
 
-    std::cout <<
-        "\tThreads: " << threadPools.size() <<
-        std::endl;
+    std::cout << "\tThreads: " << threadPools.size();
+    if (builder->pipelinedInput())
+    {
+        // Each file being inserted has a pipeline thread of its own.
+        std::cout << " + " << threadPools.workPool().numThreads() <<
+            " pipelined";
+    }
+    std::cout << std::endl;
 
     std::cout <<
         "Output:\n" <<
@@ -1,6 +1,10 @@
 #include "gtest/gtest.h"
 #include "config.hpp"
 
+#include <algorithm>
+#include <numeric>
+#include <utility>
+
 #include <pdal/Dimension.hpp>
 #include <pdal/util/FileUtils.hpp>
 #include <pdal/util/Utils.hpp>
@@ -10,8 +14,12 @@
 #include "entwine/third/arbiter/arbiter.hpp"
 #include "entwine/tree/builder.hpp"
 #include "entwine/tree/config-parser.hpp"
+#include "entwine/tree/cooler.hpp"
 #include "entwine/tree/inference.hpp"
 #include "entwine/tree/merger.hpp"
+#include "entwine/tree/sequence.hpp"
+#include "entwine/types/chunk-index.hpp"
+#include "entwine/types/storage.hpp"
 #include "entwine/types/vector-point-table.hpp"
 #include "entwine/util/json.hpp"
 
@@ -179,7 +187,9 @@ TEST_P(BuildTest, Verify)
     // Miscellaneous parameters.
     EXPECT_EQ(
             meta["storage"].asString(),
-            config["absolute"].asBool() ? "lazperf" : "laszip");
+            config.isMember("storage") ?
+                config["storage"].asString() :
+                config["absolute"].asBool() ? "lazperf" : "laszip");
 
     EXPECT_EQ(meta["compressHierarchy"].asString(), "lzma");
 
@@ -380,6 +390,791 @@ namespace scaled
             testing::Values(one, two, con, sub), );
 }
 
+namespace sorted
+{
+    Json::Value multi(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["sortedInsertion"] = true;
+        return json;
+    })());
+
+    Json::Value continued(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["sortedInsertion"] = true;
+        json["run"] = 4;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations two(multi, actualBounds, delta);
+    Expectations con(continued, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(
+            Sorted,
+            BuildTest,
+            testing::Values(two, con), );
+}
+
+namespace deferred
+{
+    Json::Value multi(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["deferHierarchy"] = true;
+        return json;
+    })());
+
+    Json::Value continued(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["deferHierarchy"] = true;
+        json["run"] = 4;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations two(multi, actualBounds, delta);
+    Expectations con(continued, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(
+            Deferred,
+            BuildTest,
+            testing::Values(two, con), );
+}
+
+namespace cached
+{
+    // Small enough that idle chunks are both taken back and evicted.
+    Json::Value multi(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["chunkCache"] = 1024 * 1024;
+        json["deferHierarchy"] = true;
+        return json;
+    })());
+
+    // Evicted chunks are cooled, and some of those thawed and others written.
+    Json::Value cooled(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["chunkCache"] = 1024 * 1024;
+        json["coolingBudget"] = 1024 * 1024;
+        json["deferHierarchy"] = true;
+        return json;
+    })());
+
+    // Cooled chunks are written from their packed points, without thawing.
+    Json::Value packed(([]()
+    {
+        Json::Value json(cooled);
+        json["storage"] = "binary";
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations two(multi, actualBounds, delta);
+    Expectations cool(cooled, actualBounds, delta);
+    Expectations pack(packed, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(
+            Cached,
+            BuildTest,
+            testing::Values(two, cool, pack), );
+}
+
+namespace budgeted
+{
+    // Well below what the build would otherwise hold, so pressure is applied
+    // repeatedly, and more is held resident than eviction can free.
+    Json::Value json(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["memoryBudget"] = 8 * 1024 * 1024;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations budget(json, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(Budgeted, BuildTest, testing::Values(budget), );
+}
+
+namespace scheduled
+{
+    Json::Value hilbert(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["scheduling"] = "hilbert";
+        return json;
+    })());
+
+    // Later runs keep the order stored by the first, since their policy
+    // matches it, and insert the files remaining in that order.
+    Json::Value largest(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["scheduling"] = "largest";
+        json["run"] = 4;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations hil(hilbert, actualBounds, delta);
+    Expectations big(largest, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(
+            Scheduled,
+            BuildTest,
+            testing::Values(hil, big), );
+}
+
+namespace split
+{
+    // The file is well above the threshold, so is inserted by several lanes.
+    Json::Value json(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-single-laz";
+        json["output"] = outPath;
+        json["threads"] = 8;
+        json["splitThreshold"] = 10000;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations lanes(json, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(Split, BuildTest, testing::Values(lanes), );
+}
+
+namespace pipelined
+{
+    Json::Value multi(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["pipelinedInput"] = true;
+        return json;
+    })());
+
+    // Batches read ahead of their insertion are handed off to the lanes of a
+    // split file.
+    Json::Value split(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-single-laz";
+        json["output"] = outPath;
+        json["threads"] = 8;
+        json["pipelinedInput"] = true;
+        json["splitThreshold"] = 10000;
+        return json;
+    })());
+
+    // Most points of each batch are rejected by a subset, so a batch may hand
+    // back more nodes than the one read after it used.
+    Json::Value subset(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["pipelinedInput"] = true;
+        json["subset"]["of"] = 16;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations two(multi, actualBounds, delta);
+    Expectations lanes(split, actualBounds, delta);
+    Expectations sub(subset, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(
+            Pipelined,
+            BuildTest,
+            testing::Values(two, lanes, sub), );
+}
+
+namespace staged
+{
+    // Chunks are written out between files, and some of them reloaded before
+    // their staged writes have finished.
+    Json::Value json(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["compressThreads"] = 2;
+        json["uploadThreads"] = 4;
+        json["deferHierarchy"] = true;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations stages(json, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(Staged, BuildTest, testing::Values(stages), );
+}
+
+namespace columnar
+{
+    Json::Value json(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["storage"] = "columnar";
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations columns(json, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(Columnar, BuildTest, testing::Values(columns), );
+}
+
+// Local binary chunks are mapped by the reader rather than read.
+namespace binary
+{
+    Json::Value json(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["storage"] = "binary";
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations mapped(json, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(Binary, BuildTest, testing::Values(mapped), );
+}
+
+namespace packed
+{
+    Json::Value multi(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["pack"] = 16;
+        return json;
+    })());
+
+    // Each run merges its chunks into the packs written by the last.
+    Json::Value continued(([]()
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["pack"] = 16;
+        json["run"] = 4;
+        return json;
+    })());
+
+    const Delta delta(Scale(.01));
+
+    Expectations two(multi, actualBounds, delta);
+    Expectations con(continued, actualBounds, delta);
+
+    INSTANTIATE_TEST_CASE_P(
+            Packed,
+            BuildTest,
+            testing::Values(two, con), );
+}
+
+// Chunks cached by a query for some dimensions are filled in for a later
+// query needing all of them.
+TEST(Build, ColumnarProjection)
+{
+    for (const auto p : arbiter::Arbiter().resolve(outPath + "/**"))
+    {
+        pdal::FileUtils::deleteFile(p);
+    }
+
+    Json::Value json;
+    json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+    json["output"] = outPath;
+    json["storage"] = "columnar";
+    ConfigParser::getBuilder(json)->go();
+
+    Cache projectedCache(1024 * 1024 * 1024);
+    Reader projected(outPath, tmpPath, projectedCache);
+
+    Cache wholeCache(1024 * 1024 * 1024);
+    Reader whole(outPath, tmpPath, wholeCache);
+
+    const Schema& native(whole.metadata().schema());
+    const Schema xyz(
+            DimList { native.find("X"), native.find("Y"), native.find("Z") });
+
+    const std::size_t coldDepth(
+            whole.metadata().structure().coldDepthBegin());
+
+    for (std::size_t depth(coldDepth); depth < coldDepth + 4; ++depth)
+    {
+        ReadQuery coords(projected, QueryParams(depth), xyz);
+        coords.run();
+
+        ReadQuery filled(projected, QueryParams(depth));
+        filled.run();
+
+        ReadQuery expected(whole, QueryParams(depth));
+        expected.run();
+
+        ASSERT_EQ(
+                coords.data().size() / xyz.pointSize(),
+                expected.data().size() / native.pointSize());
+        ASSERT_EQ(filled.data(), expected.data()) << "At depth " << depth;
+    }
+}
+
+// Hierarchy counts deferred until chunks are saved match those counted as the
+// points are inserted, at every depth and for partial bounds.
+TEST(Build, DeferredHierarchy)
+{
+    auto hierarchy([](bool deferHierarchy)
+    {
+        for (const auto p : arbiter::Arbiter().resolve(outPath + "/**"))
+        {
+            pdal::FileUtils::deleteFile(p);
+        }
+
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["deferHierarchy"] = deferHierarchy;
+        ConfigParser::getBuilder(json)->go();
+
+        Cache cache(32);
+        Reader r(outPath, tmpPath, cache);
+
+        const Bounds& bounds(r.metadata().boundsNativeCubic());
+        const std::size_t begin(
+                r.metadata().hierarchyStructure().startDepth());
+
+        std::vector<Json::Value> results;
+        results.push_back(r.hierarchy(bounds, begin, begin + 8));
+
+        for (std::size_t i(0); i < 8; ++i)
+        {
+            const Bounds q(bounds.get(toDir(i)));
+            results.push_back(r.hierarchy(q, begin, begin + 8));
+            results.push_back(r.hierarchy(q.get(toDir(7 - i)), begin + 2, 20));
+        }
+
+        return results;
+    });
+
+    const std::vector<Json::Value> eager(hierarchy(false));
+    const std::vector<Json::Value> deferred(hierarchy(true));
+
+    ASSERT_EQ(eager.size(), deferred.size());
+    for (std::size_t i(0); i < eager.size(); ++i)
+    {
+        EXPECT_FALSE(eager[i].isNull());
+        EXPECT_EQ(eager[i], deferred[i]) << "At query " << i;
+    }
+}
+
+// Cold chunks of indexed storage hand back their index as they are read, and
+// queries of part of such a chunk, which are served from the ranges of its
+// index, match the octree.
+TEST(Build, IndexedQuery)
+{
+    for (const auto& p : arbiter::Arbiter().resolve(outPath + "/**"))
+    {
+        pdal::FileUtils::deleteFile(p);
+    }
+
+    Json::Value json;
+    json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+    json["output"] = outPath;
+    json["storage"] = "lazperf";
+    ConfigParser::getBuilder(json)->go();
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(outPath));
+    const arbiter::Endpoint tmp(a.getEndpoint(tmpPath));
+
+    Cache cache(32);
+    Reader r(outPath, tmpPath, cache);
+    const Metadata& metadata(r.metadata());
+    const Structure& structure(metadata.structure());
+
+    std::size_t indexed(0);
+    for (const auto& p : a.resolve(outPath + "/*"))
+    {
+        const std::string name(arbiter::util::getBasename(p));
+        if (name.find_first_not_of("0123456789") != std::string::npos) continue;
+
+        const Id id(name);
+        if (id < structure.coldIndexBegin()) continue;
+
+        PointPool pool(metadata.schema(), metadata.delta());
+        std::shared_ptr<const ChunkIndex> index;
+        const auto cells(
+                metadata.storage().deserialize(out, tmp, pool, id, &index));
+
+        ASSERT_TRUE(index) << "Chunk " << name;
+        EXPECT_EQ(index->numPoints(), cells.size()) << "Chunk " << name;
+        ++indexed;
+    }
+
+    ASSERT_TRUE(indexed);
+
+    const Json::Value meta(parse(out.get("entwine")));
+    const Bounds bounds(meta["bounds"]);
+
+    const Delta empty;
+    test::Octree o(
+            bounds,
+            empty,
+            meta["structure"]["nullDepth"].asUInt64(),
+            meta["structure"]["coldDepth"].asUInt64());
+
+    const Manifest manifest(parse(out.get("entwine-manifest")), out);
+    for (std::size_t i(0); i < manifest.size(); ++i)
+    {
+        o.insert(manifest.get(i).path());
+    }
+
+    const Schema& schema(metadata.schema());
+    const std::size_t coldDepth(structure.coldDepthBegin());
+
+    for (std::size_t depth(coldDepth); depth < coldDepth + 4; ++depth)
+    {
+        for (std::size_t i(0); i < 8; ++i)
+        {
+            // Past the first level, our query bounds are smaller than the
+            // chunks of these depths, so they are served from chunk indexes.
+            Bounds q(bounds);
+            for (std::size_t n(0); n < 4; ++n)
+            {
+                q = q.get(toDir((i + n) % 8));
+                const std::size_t np(
+                        r.query(q, depth).size() / schema.pointSize());
+
+                ASSERT_EQ(np, o.query(q, depth).size()) <<
+                    " Q: " << q << " D: " << depth << std::endl;
+            }
+        }
+    }
+}
+
+// Mapped chunks are counted by the cache while they are held, and their
+// mappings are released along with their reader.
+TEST(Build, MappedCache)
+{
+    for (const auto& p : arbiter::Arbiter().resolve(outPath + "/**"))
+    {
+        pdal::FileUtils::deleteFile(p);
+    }
+
+    Json::Value json;
+    json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+    json["output"] = outPath;
+    json["storage"] = "binary";
+    ConfigParser::getBuilder(json)->go();
+
+    Cache cache(32);
+
+    {
+        Reader r(outPath, tmpPath, cache);
+        const Schema& schema(r.metadata().schema());
+        const std::size_t coldDepth(
+                r.metadata().structure().coldDepthBegin());
+
+        std::size_t np(0);
+        for (std::size_t depth(coldDepth); depth < coldDepth + 4; ++depth)
+        {
+            np += r.query(depth).size() / schema.pointSize();
+        }
+
+        ASSERT_TRUE(np);
+
+        // Our cache holds the inactive chunks of these queries, whose points
+        // are mapped, rather than on our heap.
+        EXPECT_GT(cache.mappedBytes(), 0u);
+    }
+
+    EXPECT_EQ(cache.mappedBytes(), 0u);
+    EXPECT_EQ(cache.activeBytes(), 0u);
+}
+
+TEST(Build, Residency)
+{
+    // Returns the chunk saves and reloads of a build.
+    const auto run([](const Json::Value& json)
+        -> std::pair<std::size_t, std::size_t>
+    {
+        for (const auto& p : arbiter::Arbiter().resolve(outPath + "/**"))
+        {
+            pdal::FileUtils::deleteFile(p);
+        }
+
+        auto builder(ConfigParser::getBuilder(json));
+        builder->go();
+
+        // Only a chunk which has been saved can be loaded back.
+        EXPECT_LE(builder->chunkReloads(), builder->chunkSaves());
+        return std::make_pair(builder->chunkSaves(), builder->chunkReloads());
+    });
+
+    Json::Value uncached(cached::multi);
+    uncached.removeMember("chunkCache");
+
+    const auto without(run(uncached));
+    const auto with(run(cached::multi));
+
+    // Without a cache, neighboring files share chunks which must be written
+    // and read back.  Released chunks taken back from the cache save those
+    // round trips.
+    ASSERT_GT(without.second, 0u);
+    EXPECT_LT(with.second, without.second);
+    EXPECT_LE(with.first, without.first);
+}
+
+TEST(Build, Cooling)
+{
+    for (const auto& json : { cached::cooled, cached::packed })
+    {
+        for (const auto& p : arbiter::Arbiter().resolve(outPath + "/**"))
+        {
+            pdal::FileUtils::deleteFile(p);
+        }
+
+        auto builder(ConfigParser::getBuilder(json));
+        builder->go();
+
+        // Some cooled chunks were needed again and restored, and the rest
+        // were written out, whether packed or thawed, by the end of the build.
+        const Cooler& cooler(builder->cooler());
+        EXPECT_GT(cooler.cooled(), 0u);
+        EXPECT_GT(cooler.thawed(), 0u);
+        EXPECT_GT(cooler.written(), 0u);
+        EXPECT_EQ(cooler.thawed() + cooler.written(), cooler.cooled());
+        EXPECT_EQ(cooler.bytes(), 0u);
+    }
+}
+
+namespace
+{
+    // Index along a Hilbert curve through a grid of n by n cells, where n is
+    // a power of two.
+    uint64_t hilbert(const uint64_t n, uint64_t x, uint64_t y)
+    {
+        uint64_t d(0);
+        for (uint64_t s(n / 2); s > 0; s /= 2)
+        {
+            const uint64_t rx((x & s) ? 1 : 0);
+            const uint64_t ry((y & s) ? 1 : 0);
+            d += s * s * ((3 * rx) ^ ry);
+
+            if (!ry)
+            {
+                if (rx)
+                {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return d;
+    }
+
+    OriginList handedOut(Builder& builder)
+    {
+        OriginList order;
+        while (auto o = builder.sequence().next(0)) order.push_back(*o);
+        return order;
+    }
+}
+
+// Origins are handed out for insertion in the order chosen by the scheduling
+// policy, and an explicit "manifest" policy discards a stored order.
+TEST(Build, Scheduling)
+{
+    for (const auto& p : arbiter::Arbiter().resolve(outPath + "/**"))
+    {
+        pdal::FileUtils::deleteFile(p);
+    }
+
+    auto config([](const std::string& scheduling)
+    {
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["scheduling"] = scheduling;
+        return json;
+    });
+
+    {
+        auto builder(ConfigParser::getBuilder(config("largest")));
+        const Manifest& manifest(builder->metadata().manifest());
+
+        OriginList expected(manifest.size());
+        std::iota(expected.begin(), expected.end(), 0);
+        std::stable_sort(
+                expected.begin(),
+                expected.end(),
+                [&manifest](Origin a, Origin b)
+                {
+                    return
+                        manifest.get(a).numPoints() >
+                        manifest.get(b).numPoints();
+                });
+
+        EXPECT_EQ(handedOut(*builder), expected);
+    }
+
+    {
+        auto builder(ConfigParser::getBuilder(config("hilbert")));
+        const Manifest& manifest(builder->metadata().manifest());
+        const Bounds& bounds(builder->metadata().boundsNativeCubic());
+
+        const uint64_t n(1 << 16);
+        auto key([&](Origin o)
+        {
+            const Point mid(manifest.get(o).bounds()->mid());
+            auto cell([n](double v, double min, double max)
+            {
+                return static_cast<uint64_t>((v - min) / (max - min) * (n - 1));
+            });
+
+            return hilbert(
+                    n,
+                    cell(mid.x, bounds.min().x, bounds.max().x),
+                    cell(mid.y, bounds.min().y, bounds.max().y));
+        });
+
+        OriginList expected(manifest.size());
+        std::iota(expected.begin(), expected.end(), 0);
+        std::stable_sort(
+                expected.begin(),
+                expected.end(),
+                [&key](Origin a, Origin b) { return key(a) < key(b); });
+
+        EXPECT_EQ(handedOut(*builder), expected);
+    }
+
+    arbiter::Arbiter a;
+    const arbiter::Endpoint out(a.getEndpoint(outPath));
+
+    // Insert only some files, so the rest remain for a continuation.
+    ConfigParser::getBuilder(config("hilbert"))->go(2);
+    Json::Value manifest(parse(out.get("entwine-manifest")));
+    EXPECT_EQ(manifest["scheduling"].asString(), "hilbert");
+    ASSERT_EQ(manifest["order"].size(), manifest["fileInfo"].size());
+
+    {
+        auto builder(ConfigParser::getBuilder(config("manifest")));
+        ASSERT_TRUE(builder->isContinuation());
+
+        const OriginList order(handedOut(*builder));
+        EXPECT_EQ(order.size(), manifest["fileInfo"].size() - 2);
+        EXPECT_TRUE(std::is_sorted(order.begin(), order.end()));
+    }
+
+    ConfigParser::getBuilder(config("manifest"))->go();
+    manifest = parse(out.get("entwine-manifest"));
+    EXPECT_FALSE(manifest.isMember("scheduling"));
+    EXPECT_FALSE(manifest.isMember("order"));
+}
+
+// Not a correctness test - compares build times with and without sorted
+// insertion.  Run with --gtest_also_run_disabled_tests.
+TEST(Build, DISABLED_SortedInsertionBenchmark)
+{
+    auto time([](bool sortedInsertion)
+    {
+        for (const auto p : arbiter::Arbiter().resolve(outPath + "/**"))
+        {
+            pdal::FileUtils::deleteFile(p);
+        }
+
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["threads"] = 4;
+        json["sortedInsertion"] = sortedInsertion;
+
+        auto builder(ConfigParser::getBuilder(json));
+        const auto start(now());
+        builder->go();
+        return since<std::chrono::milliseconds>(start);
+    });
+
+    const auto unsorted(time(false));
+    const auto sorted(time(true));
+
+    std::cout <<
+        "Unsorted: " << unsorted << "ms\n" <<
+        "Sorted:   " << sorted << "ms" << std::endl;
+}
+
+// Not a correctness test - compares build times of LAZ inputs with and without
+// pipelined input.  Run with --gtest_also_run_disabled_tests.
+TEST(Build, DISABLED_PipelinedInputBenchmark)
+{
+    auto time([](bool pipelinedInput)
+    {
+        for (const auto p : arbiter::Arbiter().resolve(outPath + "/**"))
+        {
+            pdal::FileUtils::deleteFile(p);
+        }
+
+        Json::Value json;
+        json["input"] = test::dataPath() + "ellipsoid-multi-laz";
+        json["output"] = outPath;
+        json["threads"] = 4;
+        json["pipelinedInput"] = pipelinedInput;
+
+        auto builder(ConfigParser::getBuilder(json));
+        const auto start(now());
+        builder->go();
+        return since<std::chrono::milliseconds>(start);
+    });
+
+    const auto serial(time(false));
+    const auto pipelined(time(true));
+
+    std::cout <<
+        "Serial:    " << serial << "ms\n" <<
+        "Pipelined: " << pipelined << "ms" << std::endl;
+}
+
 TEST(Build, Kernel)
 {
     std::string output;
@@ -0,0 +1,195 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <entwine/tree/heuristics.hpp>
+#include <entwine/types/chunk-index.hpp>
+#include <entwine/types/schema.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Bounds bounds(Point(0, 0, 0), Point(8, 8, 8));
+
+    // Cells are in Morton order, with X the least significant: cell 1 is the
+    // upper half in X, cell 2 in Y, and cell 4 in Z.
+    ChunkIndex makeIndex()
+    {
+        return ChunkIndex(
+                bounds,
+                1,
+                std::vector<uint32_t>{ 1, 1, 3, 3, 3, 6, 6, 10 });
+    }
+
+    using Ranges = std::vector<ChunkIndex::Range>;
+
+    const Schema schema({
+            { pdal::Dimension::Id::X },
+            { pdal::Dimension::Id::Y },
+            { pdal::Dimension::Id::Z } });
+
+    // The centers of the cells of makeIndex(), in Morton order.
+    Point center(const std::size_t cell)
+    {
+        return Point(cell & 1 ? 6 : 2, cell & 2 ? 6 : 2, cell & 4 ? 6 : 2);
+    }
+
+    // Points are offset from their cell's center by their original position,
+    // so it may be recovered after they are sorted.
+    const double step(1.0 / (1 << 16));
+
+    Point get(const std::vector<char>& data, const std::size_t i)
+    {
+        double xyz[3];
+        std::memcpy(xyz, data.data() + i * schema.pointSize(), sizeof(xyz));
+        return Point(xyz[0], xyz[1], xyz[2]);
+    }
+}
+
+TEST(ChunkIndex, Ranges)
+{
+    const ChunkIndex index(makeIndex());
+    EXPECT_EQ(index.numPoints(), 10u);
+
+    EXPECT_EQ(index.ranges(bounds), (Ranges{ { 0, 10 } }));
+
+    // Within single cells.
+    EXPECT_EQ(
+            index.ranges(Bounds(Point(1, 1, 1), Point(2, 2, 2))),
+            (Ranges{ { 0, 1 } }));
+    EXPECT_EQ(
+            index.ranges(Bounds(Point(1, 5, 1), Point(2, 6, 2))),
+            (Ranges{ { 1, 3 } }));
+    EXPECT_TRUE(index.ranges(Bounds(Point(5, 1, 1), Point(6, 2, 2))).empty());
+
+    // Runs of cells across empty ones are merged.
+    EXPECT_EQ(
+            index.ranges(Bounds(Point(1, 1, 1), Point(6, 6, 2))),
+            (Ranges{ { 0, 3 } }));
+    EXPECT_EQ(
+            index.ranges(Bounds(Point(1, 1, 5), Point(6, 6, 6))),
+            (Ranges{ { 3, 10 } }));
+
+    // Runs which are not adjacent are not.
+    EXPECT_EQ(
+            index.ranges(Bounds(Point(1, 1, 1), Point(6, 2, 6))),
+            (Ranges{ { 0, 1 }, { 3, 6 } }));
+
+    // Queries beyond the bounds are clamped to the outermost cells.
+    EXPECT_EQ(
+            index.ranges(Bounds(Point(-4, -4, 9), Point(12, 12, 12))),
+            (Ranges{ { 3, 10 } }));
+}
+
+TEST(ChunkIndex, Build)
+{
+    // Enough points for a single level of cells, unevenly spread over them
+    // and leaving cell 3 empty.
+    const std::size_t numPoints(8 * heuristics::chunkIndexCellPoints);
+    const std::vector<std::size_t> counts{
+        512, 128, 256, 0, 64, 384, 320, 384 };
+
+    std::vector<std::size_t> cells;
+    for (std::size_t c(0); c < counts.size(); ++c)
+    {
+        cells.insert(cells.end(), counts[c], c);
+    }
+    ASSERT_EQ(cells.size(), numPoints);
+
+    // Interleave the cells, so every point must move.
+    std::vector<std::size_t> order;
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        order.push_back(i * 7 % numPoints);
+    }
+
+    std::vector<char> data(numPoints * schema.pointSize());
+    for (std::size_t i(0); i < numPoints; ++i)
+    {
+        const Point p(center(cells[order[i]]));
+        const double xyz[3] = { p.x + i * step, p.y, p.z };
+        std::memcpy(data.data() + i * schema.pointSize(), xyz, sizeof(xyz));
+    }
+
+    const ChunkIndex index(ChunkIndex::build(schema, bounds, numPoints, data));
+    ASSERT_EQ(index.bits(), 1u);
+    ASSERT_EQ(index.numPoints(), numPoints);
+    ASSERT_EQ(data.size(), numPoints * schema.pointSize());
+
+    // Each cell's points form the run given by its offsets, in their original
+    // order, and every point appears exactly once.
+    std::vector<bool> seen(numPoints, false);
+    std::size_t begin(0);
+
+    for (std::size_t c(0); c < counts.size(); ++c)
+    {
+        const Point mid(center(c));
+        const Bounds cellBounds(mid - 1, mid + 1);
+        const std::size_t end(begin + counts[c]);
+
+        if (counts[c])
+        {
+            EXPECT_EQ(index.ranges(cellBounds), (Ranges{ { begin, end } }));
+        }
+        else
+        {
+            EXPECT_TRUE(index.ranges(cellBounds).empty());
+        }
+
+        std::size_t last(0);
+        for (std::size_t i(begin); i < end; ++i)
+        {
+            const Point p(get(data, i));
+            ASSERT_EQ(p.y, mid.y);
+            ASSERT_EQ(p.z, mid.z);
+
+            const std::size_t from((p.x - mid.x) / step);
+            ASSERT_LT(from, numPoints);
+            ASSERT_FALSE(seen[from]);
+            ASSERT_EQ(cells[order[from]], c);
+            if (i > begin) { ASSERT_GT(from, last); }
+
+            seen[from] = true;
+            last = from;
+        }
+
+        begin = end;
+    }
+
+    EXPECT_EQ(begin, numPoints);
+}
+
+TEST(ChunkIndex, Serialization)
+{
+    const ChunkIndex index(makeIndex());
+    const std::vector<char> bytes(index.toBytes());
+    ASSERT_EQ(bytes.size(), index.size());
+
+    // The index is extracted from the end of whatever precedes it.
+    std::vector<char> data{ 'a', 'b', 'c' };
+    data.insert(data.end(), bytes.begin(), bytes.end());
+
+    std::size_t size(data.size());
+    const ChunkIndex extracted(ChunkIndex::extract(data.data(), size));
+
+    EXPECT_EQ(size, 3u);
+    EXPECT_EQ(extracted.bits(), index.bits());
+    EXPECT_EQ(extracted.bounds(), index.bounds());
+    EXPECT_EQ(extracted.toBytes(), bytes);
+
+    size = bytes.size() - 1;
+    EXPECT_ANY_THROW(ChunkIndex::extract(bytes.data() + 1, size));
+}
+
+TEST(ChunkIndex, Invalid)
+{
+    EXPECT_ANY_THROW(ChunkIndex(bounds, 1, std::vector<uint32_t>(4, 0)));
+    EXPECT_ANY_THROW(
+            ChunkIndex(
+                bounds,
+                1,
+                std::vector<uint32_t>{ 1, 0, 3, 3, 3, 6, 6, 10 }));
+}
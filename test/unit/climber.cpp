@@ -0,0 +1,254 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <random>
+
+#include <entwine/tree/climber.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/fixed-id.hpp>
+#include <entwine/types/grid.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/time.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    Json::Value makeStructureJson(std::size_t coldDepth)
+    {
+        Json::Value json;
+        json["nullDepth"] = 0;
+        json["baseDepth"] = 4;
+        json["coldDepth"] = static_cast<Json::UInt64>(coldDepth);
+        json["pointsPerChunk"] = 256;
+        json["numPointsHint"] = 1 << 20;
+        json["sparseDepth"] = 12;
+        return json;
+    }
+
+    std::vector<Point> makePoints(
+            const Bounds& bounds,
+            std::size_t n,
+            bool integral = false)
+    {
+        std::mt19937 gen(42);
+        std::uniform_real_distribution<double> x(bounds.min().x, bounds.max().x);
+        std::uniform_real_distribution<double> y(bounds.min().y, bounds.max().y);
+        std::uniform_real_distribution<double> z(bounds.min().z, bounds.max().z);
+
+        std::vector<Point> points;
+        for (std::size_t i(0); i < n; ++i)
+        {
+            points.emplace_back(x(gen), y(gen), z(gen));
+            if (integral)
+            {
+                points.back() = points.back().apply([](double d)
+                {
+                    return std::floor(d);
+                });
+            }
+        }
+        return points;
+    }
+}
+
+TEST(IdTraits, RoundTrip)
+{
+    const std::vector<Id> ids {
+        Id(0),
+        Id(1),
+        Id(std::numeric_limits<uint64_t>::max()),
+        ChunkInfo::binaryPow(2, 40) + 12345,
+        ChunkInfo::calcLevelIndex(2, 62)
+    };
+
+    for (const Id& id : ids)
+    {
+        if (id.blockSize() > IdTraits<FixedId>::blocks) continue;
+
+        const FixedId fixed(IdTraits<FixedId>::from(id));
+        EXPECT_EQ(IdTraits<FixedId>::toId(fixed), id);
+        EXPECT_EQ(IdTraits<FixedId>::log2(fixed), Id::log2(id));
+    }
+
+    EXPECT_THROW(
+            IdTraits<FixedId>::from(
+                ChunkInfo::binaryPow(1, IdTraits<FixedId>::bits)),
+            std::overflow_error);
+}
+
+TEST(IdTraits, ChunkInfo)
+{
+    const Structure structure(makeStructureJson(0));
+    const std::size_t factor(structure.factor());
+
+    for (std::size_t depth(structure.coldDepthBegin() + 1); depth < 30; ++depth)
+    {
+        const Id index(
+                ChunkInfo::calcLevelIndex(structure.dimensions(), depth) +
+                depth * 7);
+
+        const FixedId fixed(IdTraits<FixedId>::from(index));
+
+        EXPECT_EQ(ChunkInfo::calcDepth(factor, index), depth);
+        EXPECT_EQ(ChunkInfo::calcDepth(factor, fixed), depth);
+
+        EXPECT_EQ(
+                IdTraits<FixedId>::toId(
+                    ChunkInfo::calcParentId(structure, fixed, depth)),
+                ChunkInfo::calcParentId(structure, index, depth));
+    }
+}
+
+TEST(Climber, FixedMatchesId)
+{
+    const Bounds bounds(Point(0, 0, 0), Point(1024, 1024, 1024));
+
+    // The first is shallow enough to climb entirely with fixed-width
+    // arithmetic.  The second is lossless, so it climbs past the fixed-width
+    // depth limit and must transparently fall back to Id.
+    for (const std::size_t coldDepth : std::vector<std::size_t>{ 20, 0 })
+    {
+        const Structure structure(makeStructureJson(coldDepth));
+        const std::size_t depthEnd(
+                coldDepth ? coldDepth : structure.fixedDepthEnd() + 4);
+
+        PointState state(structure, bounds);
+
+        for (const Point& p : makePoints(bounds, 64))
+        {
+            state.reset();
+            Id index(0);
+
+            while (state.depth() + 1 < depthEnd)
+            {
+                const Dir dir(getDirection(state.bounds().mid(), p));
+                state.climb(p);
+
+                index <<= structure.dimensions();
+                ++index;
+                index += toIntegral(dir, structure.tubular());
+
+                ASSERT_EQ(state.index(), index);
+                if (state.fixed())
+                {
+                    ASSERT_EQ(
+                            IdTraits<FixedId>::toId(state.fixedIndex()),
+                            index);
+                }
+
+                // Deeper chunk numbers overflow ChunkInfo's simple values.
+                if (
+                        state.depth() >= structure.coldDepthBegin() &&
+                        state.depth() < 32)
+                {
+                    const ChunkInfo info(structure, index);
+                    ASSERT_EQ(state.chunkId(), info.chunkId());
+                    ASSERT_EQ(state.pointsPerChunk(), info.pointsPerChunk());
+                    ASSERT_EQ(state.chunkNum(), info.chunkNum());
+                }
+            }
+        }
+    }
+}
+
+TEST(Climber, GridMatchesBounds)
+{
+    // Integral, but not power-of-two, extents - as scaled cubic bounds are.
+    const Bounds bounds(Point(-1013, -1013, -1013), Point(1013, 1013, 1013));
+    const Structure structure(makeStructureJson(0));
+    ASSERT_TRUE(Grid(bounds).valid());
+
+    // Points which aren't integral fall back to subdividing bounds.
+    for (const bool integral : { true, false })
+    {
+        PointState state(structure, bounds);
+
+        for (const Point& p : makePoints(bounds, 64, integral))
+        {
+            state.reset();
+            Bounds expected(bounds);
+            std::size_t tick(0);
+
+            for (std::size_t depth(1); depth < 64; ++depth)
+            {
+                const Dir dir(getDirection(expected.mid(), p));
+                const Point mid(state.mid());
+                state.climb(p);
+
+                ASSERT_EQ(mid, expected.mid());
+
+                expected.go(dir);
+                tick = (tick << 1) | (isUp(dir) ? 1 : 0);
+
+                ASSERT_EQ(state.bounds().min(), expected.min());
+                ASSERT_EQ(state.bounds().max(), expected.max());
+                ASSERT_EQ(state.tick(), tick);
+            }
+        }
+    }
+}
+
+TEST(Grid, Tick)
+{
+    const Bounds bounds(Point(-1013, -1013, -1013), Point(1013, 1013, 1013));
+    const Grid grid(bounds);
+    Grid::Coord coords[3];
+
+    for (const Point& p : makePoints(bounds, 256, true))
+    {
+        ASSERT_TRUE(grid.normalize(p, coords));
+
+        for (std::size_t depth(0); depth < grid.depthEnd(); ++depth)
+        {
+            ASSERT_EQ(
+                    grid.tick(coords, depth),
+                    Tube::calcTick(p, bounds, depth));
+        }
+    }
+}
+
+// Not a correctness test - compares climbing while reading each position
+// through the Id accessors, as insertion and hierarchy counting once did, with
+// reading it through the fixed-width accessors.  Run with
+// --gtest_also_run_disabled_tests.
+TEST(Climber, DISABLED_FixedAccessorBenchmark)
+{
+    const Bounds bounds(Point(0, 0, 0), Point(1024, 1024, 1024));
+    const std::size_t depthEnd(20);
+    const Structure structure(makeStructureJson(depthEnd));
+    const std::vector<Point> points(makePoints(bounds, 1 << 18));
+
+    auto time([&](bool fixed, std::size_t& sum)
+    {
+        PointState state(structure, bounds);
+        const auto start(now());
+
+        for (const Point& p : points)
+        {
+            state.reset();
+
+            while (state.depth() + 1 < depthEnd)
+            {
+                state.climb(p);
+                ASSERT_TRUE(state.fixed());
+
+                if (fixed) sum += static_cast<std::size_t>(state.fixedIndex());
+                else sum += state.index().getSimple();
+
+                sum += state.chunkNum();
+            }
+        }
+
+        std::cout << (fixed ? "Fixed: " : "Id:    ") <<
+            since<std::chrono::milliseconds>(start) << "ms" << std::endl;
+    });
+
+    std::size_t idSum(0);
+    std::size_t fixedSum(0);
+
+    time(false, idSum);
+    time(true, fixedSum);
+
+    EXPECT_EQ(idSum, fixedSum);
+}
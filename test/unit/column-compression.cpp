@@ -0,0 +1,116 @@
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <vector>
+
+#include <entwine/util/column-compression.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    template<typename T>
+    std::vector<char> pack(const std::vector<T>& values)
+    {
+        const char* pos(reinterpret_cast<const char*>(values.data()));
+        return std::vector<char>(pos, pos + values.size() * sizeof(T));
+    }
+
+    template<typename T>
+    void roundTrip(
+            const ColumnCodec codec,
+            const std::vector<T>& values,
+            const bool isSigned)
+    {
+        const std::vector<char> raw(pack(values));
+        const std::vector<char> encoded(
+                ColumnCompression::encode(codec, raw, sizeof(T), isSigned));
+
+        const std::vector<char> decoded(
+                ColumnCompression::decode(
+                    codec,
+                    encoded.data(),
+                    encoded.size(),
+                    values.size(),
+                    sizeof(T),
+                    isSigned));
+
+        EXPECT_EQ(decoded, raw) << toString(codec);
+    }
+}
+
+TEST(ColumnCompression, Delta)
+{
+    // Slowly varying coordinates, crossing zero, within partial blocks.
+    std::vector<int32_t> coords;
+    for (int32_t i(0); i < 1000; ++i) coords.push_back(i * 3 - 1500);
+    roundTrip(ColumnCodec::Delta, coords, true);
+
+    // Extremes, which need the full bit width.
+    roundTrip(
+            ColumnCodec::Delta,
+            std::vector<int32_t>{ INT32_MIN, INT32_MAX, 0, INT32_MIN },
+            true);
+    roundTrip(
+            ColumnCodec::Delta,
+            std::vector<uint64_t>{ 0, UINT64_MAX, 1, UINT64_MAX / 2 },
+            false);
+
+    // GpsTime is coded by the bits of its doubles.
+    std::vector<double> times;
+    for (std::size_t i(0); i < 300; ++i) times.push_back(1e8 + i * 1e-5);
+    roundTrip(ColumnCodec::Delta, times, true);
+
+    const std::vector<char> raw(pack(coords));
+    const std::vector<char> encoded(
+            ColumnCompression::encode(ColumnCodec::Delta, raw, 4, true));
+    EXPECT_LT(encoded.size(), raw.size() / 4);
+}
+
+TEST(ColumnCompression, RunLength)
+{
+    std::vector<uint8_t> classes(5000, 2);
+    std::fill(classes.begin() + 1000, classes.begin() + 1200, 6);
+    classes.back() = 7;
+    roundTrip(ColumnCodec::RunLength, classes, false);
+
+    const std::vector<char> encoded(
+            ColumnCompression::encode(
+                ColumnCodec::RunLength,
+                pack(classes),
+                1,
+                false));
+    EXPECT_EQ(encoded.size(), 4u * 5u);
+}
+
+TEST(ColumnCompression, Others)
+{
+    std::vector<uint16_t> intensities;
+    for (uint16_t i(0); i < 2000; ++i) intensities.push_back(i % 37 * 11);
+
+    roundTrip(ColumnCodec::Raw, intensities, false);
+    roundTrip(ColumnCodec::Lzma, intensities, false);
+    roundTrip(ColumnCodec::Delta, std::vector<uint16_t>(), false);
+}
+
+TEST(ColumnCompression, Invalid)
+{
+    const std::vector<char> raw(pack(std::vector<int32_t>(100, 4)));
+    const std::vector<char> encoded(
+            ColumnCompression::encode(ColumnCodec::Delta, raw, 4, true));
+
+    // Asking for more values than were encoded.
+    EXPECT_THROW(
+            ColumnCompression::decode(
+                ColumnCodec::Delta,
+                encoded.data(),
+                encoded.size(),
+                200,
+                4,
+                true),
+            std::runtime_error);
+
+    EXPECT_THROW(
+            ColumnCompression::encode(ColumnCodec::Raw, raw, 3, false),
+            std::runtime_error);
+}
@@ -0,0 +1,56 @@
+#include "gtest/gtest.h"
+
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <entwine/tree/hierarchy-block.hpp>
+
+using namespace entwine;
+
+TEST(HierarchyTicks, Concurrent)
+{
+    HierarchyTicks ticks;
+
+    const std::size_t numThreads(8);
+    const std::size_t numTubes(64);
+    const std::size_t numTicks(100);
+    std::vector<std::thread> threads;
+
+    // Every thread counts every key, so the tables must grow while contended.
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&ticks, t]()
+        {
+            for (std::size_t i(0); i < numTubes * numTicks; ++i)
+            {
+                const std::size_t n((i * 7 + t * 13) % (numTubes * numTicks));
+                ticks.at(n / numTicks, n % numTicks + 1).count(2);
+                ticks.at(n / numTicks, n % numTicks + 1).count(-1);
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    std::map<std::pair<uint64_t, uint64_t>, uint64_t> counts;
+    ticks.forEach([&counts](uint64_t tube, uint64_t tick, uint64_t val)
+    {
+        EXPECT_TRUE(counts.emplace(std::make_pair(tube, tick), val).second);
+    });
+
+    ASSERT_EQ(counts.size(), numTubes * numTicks);
+
+    for (const auto& p : counts)
+    {
+        EXPECT_EQ(p.second, numThreads);
+
+        const HierarchyCell* cell(ticks.find(p.first.first, p.first.second));
+        ASSERT_TRUE(cell);
+        EXPECT_EQ(cell->val(), numThreads);
+    }
+
+    EXPECT_FALSE(ticks.find(numTubes, 1));
+    EXPECT_FALSE(ticks.find(0, numTicks + 1));
+}
@@ -0,0 +1,284 @@
+#include "gtest/gtest.h"
+#include "config.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/types/bounds.hpp>
+#include <entwine/types/metadata.hpp>
+#include <entwine/types/packs.hpp>
+#include <entwine/types/structure.hpp>
+#include <entwine/util/compression.hpp>
+#include <entwine/util/mapped-file.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::string outPath(test::dataPath() + "out/");
+    const std::string tmpPath(test::dataPath() + "tmp/");
+    const std::size_t chunksPerPack(4);
+
+    Json::Value makeMetadataJson()
+    {
+        const Bounds bounds(0, 0, 0, 1024, 1024, 1024);
+
+        Json::Value structure;
+        structure["nullDepth"] = 0;
+        structure["baseDepth"] = 4;
+        structure["pointsPerChunk"] = 256;
+        structure["numPointsHint"] = 1 << 20;
+        structure["sparseDepth"] = 12;
+
+        Json::Value json;
+        json["bounds"] = bounds.toJson();
+        json["boundsConforming"] = bounds.toJson();
+        json["structure"] = structure;
+        json["hierarchyStructure"] = structure;
+        json["storage"] = "lazperf";
+        json["compressHierarchy"] = "lzma";
+        json["version"] = "1.0.0";
+
+        for (const std::string name : { "X", "Y", "Z" })
+        {
+            Json::Value dim;
+            dim["name"] = name;
+            dim["type"] = "floating";
+            dim["size"] = 8;
+            json["schema"].append(dim);
+        }
+
+        return json;
+    }
+
+    std::vector<char> makeData(const std::size_t size, const char value)
+    {
+        return std::vector<char>(size, value);
+    }
+
+    std::vector<char> read(const FileView& view)
+    {
+        return std::vector<char>(view.data(), view.data() + view.size());
+    }
+}
+
+class PacksTest : public ::testing::Test
+{
+protected:
+    PacksTest()
+        : metadata(makeMetadataJson())
+        , structure(metadata.structure())
+        , out(a.getEndpoint(outPath))
+        , tmp(a.getEndpoint(tmpPath))
+    { }
+
+    virtual void SetUp() override
+    {
+        cleanup();
+        arbiter::fs::mkdirp(outPath);
+        arbiter::fs::mkdirp(tmpPath);
+    }
+
+    virtual void TearDown() override { cleanup(); }
+
+    void cleanup()
+    {
+        for (const std::string& dir : { outPath, tmpPath })
+        {
+            for (const auto& p : a.resolve(dir + "**")) arbiter::fs::remove(p);
+        }
+    }
+
+    // The ID of the nth cold chunk, which is in pack n / chunksPerPack.
+    Id cold(const std::size_t n) const
+    {
+        return structure.coldIndexBegin() + n * structure.basePointsPerChunk();
+    }
+
+    std::unique_ptr<Packs> create()
+    {
+        std::unique_ptr<Packs> packs(new Packs(metadata, chunksPerPack));
+        packs->stage(tmp);
+        return packs;
+    }
+
+    arbiter::Arbiter a;
+    const Metadata metadata;
+    const Structure& structure;
+    const arbiter::Endpoint out;
+    const arbiter::Endpoint tmp;
+};
+
+TEST_F(PacksTest, PutSaveReload)
+{
+    const Id base(0);
+    const std::vector<Id> ids { base, cold(0), cold(1), cold(chunksPerPack) };
+
+    EXPECT_EQ(create()->packName(base), "pack-base");
+    EXPECT_EQ(create()->packName(cold(1)), "pack-0");
+    EXPECT_EQ(create()->packName(cold(chunksPerPack)), "pack-1");
+
+    {
+        auto packs(create());
+        for (std::size_t i(0); i < ids.size(); ++i)
+        {
+            packs->put(out, ids[i], makeData(100 + i, 'a' + i));
+        }
+
+        // Staged chunks may be viewed before they are saved.
+        ASSERT_TRUE(packs->view(out, cold(1)));
+        EXPECT_EQ(read(*packs->view(out, cold(1))), makeData(102, 'c'));
+        EXPECT_FALSE(out.tryGetSize("entwine-packs"));
+
+        packs->save(out);
+    }
+
+    EXPECT_TRUE(out.tryGetSize("pack-base-1"));
+    EXPECT_TRUE(out.tryGetSize("pack-0-1"));
+    EXPECT_TRUE(out.tryGetSize("pack-1-1"));
+    EXPECT_FALSE(out.tryGetSize("staged-pack-0"));
+
+    Packs packs(metadata, chunksPerPack);
+    for (std::size_t i(0); i < ids.size(); ++i)
+    {
+        EXPECT_TRUE(packs.contains(out, ids[i]));
+
+        const auto view(packs.view(out, ids[i]));
+        ASSERT_TRUE(view);
+        EXPECT_EQ(read(*view), makeData(100 + i, 'a' + i));
+
+        // Only the end of a chunk may be requested.
+        const auto tail(packs.view(out, ids[i], 10));
+        ASSERT_TRUE(tail);
+        EXPECT_EQ(read(*tail), makeData(10, 'a' + i));
+    }
+
+    EXPECT_FALSE(packs.contains(out, cold(2)));
+    EXPECT_FALSE(packs.view(out, cold(2)));
+}
+
+TEST_F(PacksTest, Replace)
+{
+    {
+        auto packs(create());
+        packs->put(out, cold(0), makeData(100, 'a'));
+        packs->put(out, cold(1), makeData(50, 'b'));
+        packs->put(out, cold(0), makeData(20, 'c'));
+        EXPECT_EQ(read(*packs->view(out, cold(0))), makeData(20, 'c'));
+        packs->save(out);
+    }
+
+    // The replaced data is dropped from the pack.
+    ASSERT_TRUE(out.tryGetSize("pack-0-1"));
+    EXPECT_EQ(*out.tryGetSize("pack-0-1"), 70u);
+
+    Packs packs(metadata, chunksPerPack);
+    EXPECT_EQ(read(*packs.view(out, cold(0))), makeData(20, 'c'));
+    EXPECT_EQ(read(*packs.view(out, cold(1))), makeData(50, 'b'));
+}
+
+TEST_F(PacksTest, Continue)
+{
+    {
+        auto packs(create());
+        packs->put(out, cold(0), makeData(100, 'a'));
+        packs->put(out, cold(1), makeData(100, 'b'));
+        packs->put(out, cold(chunksPerPack), makeData(100, 'c'));
+        packs->save(out);
+    }
+
+    {
+        // A continuation adds to one existing pack and replaces a chunk of
+        // it, leaving the other pack alone.
+        auto packs(create());
+        packs->put(out, cold(2), makeData(30, 'd'));
+        packs->put(out, cold(1), makeData(40, 'e'));
+
+        // Until we are saved, the existing pack is still indexed.
+        EXPECT_TRUE(Packs(metadata, chunksPerPack).view(out, cold(1)));
+        EXPECT_EQ(
+                read(*Packs(metadata, chunksPerPack).view(out, cold(1))),
+                makeData(100, 'b'));
+
+        packs->save(out);
+    }
+
+    EXPECT_FALSE(out.tryGetSize("pack-0-1"));
+    EXPECT_TRUE(out.tryGetSize("pack-0-2"));
+    EXPECT_TRUE(out.tryGetSize("pack-1-1"));
+
+    Packs packs(metadata, chunksPerPack);
+    EXPECT_EQ(read(*packs.view(out, cold(0))), makeData(100, 'a'));
+    EXPECT_EQ(read(*packs.view(out, cold(1))), makeData(40, 'e'));
+    EXPECT_EQ(read(*packs.view(out, cold(2))), makeData(30, 'd'));
+    EXPECT_EQ(
+            read(*packs.view(out, cold(chunksPerPack))),
+            makeData(100, 'c'));
+}
+
+TEST_F(PacksTest, ConcurrentPuts)
+{
+    const std::size_t numThreads(8);
+    const std::size_t perThread(16);
+
+    auto packs(create());
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (std::size_t i(0); i < perThread; ++i)
+            {
+                const std::size_t n(i * numThreads + t);
+                packs->put(out, cold(n), makeData(64 + n, 'a' + n % 26));
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    packs->save(out);
+
+    Packs reloaded(metadata, chunksPerPack);
+    for (std::size_t n(0); n < numThreads * perThread; ++n)
+    {
+        const auto view(reloaded.view(out, cold(n)));
+        ASSERT_TRUE(view);
+        EXPECT_EQ(read(*view), makeData(64 + n, 'a' + n % 26));
+    }
+}
+
+TEST_F(PacksTest, CorruptIndex)
+{
+    {
+        auto packs(create());
+        packs->put(out, cold(0), makeData(100, 'a'));
+        packs->save(out);
+    }
+
+    const auto valid(
+            Compression::decompressLzma(out.getBinary("entwine-packs")));
+
+    // Truncated.
+    {
+        const std::vector<char> data(valid->begin(), valid->end() - 4);
+        out.put("entwine-packs", *Compression::compressLzma(data));
+        EXPECT_THROW(
+                Packs(metadata, chunksPerPack).contains(out, cold(0)),
+                std::runtime_error);
+    }
+
+    // An entry referring to a pack which does not exist.
+    {
+        std::vector<char> data(*valid);
+        const std::size_t packPos(data.size() - 3 * sizeof(uint64_t));
+        data[packPos] = 1;
+        out.put("entwine-packs", *Compression::compressLzma(data));
+        EXPECT_THROW(
+                Packs(metadata, chunksPerPack).contains(out, cold(0)),
+                std::runtime_error);
+    }
+}
@@ -0,0 +1,199 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include <entwine/types/point-slab.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    using Type = pdal::Dimension::Type;
+
+    // X, Y, and Z as scaled 32-bit integers, followed by another field.
+    const std::size_t pointSize(16);
+
+    PointSlab makeSlab(std::size_t blockSize)
+    {
+        return PointSlab(
+                pointSize,
+                PointSlab::Field(0, Type::Signed32),
+                PointSlab::Field(4, Type::Signed32),
+                PointSlab::Field(8, Type::Signed32),
+                blockSize);
+    }
+
+    void write(char* pos, int32_t x, int32_t y, int32_t z, int32_t v)
+    {
+        for (const int32_t i : { x, y, z, v })
+        {
+            std::memcpy(pos, &i, sizeof(int32_t));
+            pos += sizeof(int32_t);
+        }
+    }
+
+    int32_t value(const char* pos)
+    {
+        int32_t v;
+        std::memcpy(&v, pos + 12, sizeof(int32_t));
+        return v;
+    }
+}
+
+TEST(PointSlab, Records)
+{
+    PointSlab slab(makeSlab(4));
+
+    // Spans several blocks, each twice the size of the last.
+    const std::size_t n(100);
+    const PointSlab::Offset begin(slab.reserve(n));
+    EXPECT_EQ(begin, 0u);
+    EXPECT_EQ(slab.size(), n);
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        write(slab.data(i), i, -static_cast<int32_t>(i), 2 * i, i * 7);
+        slab.link(i, i + 1 < n ? i + 1 : PointSlab::none);
+    }
+
+    for (std::size_t i(0); i < n; ++i)
+    {
+        EXPECT_EQ(
+                slab.point(i),
+                Point(i, -static_cast<double>(i), 2 * i));
+        EXPECT_EQ(value(slab.data(i)), static_cast<int32_t>(i * 7));
+    }
+
+    EXPECT_EQ(slab.chainSize(0), n);
+    EXPECT_EQ(slab.chainSize(n - 10), 10u);
+
+    // Blocks are visited in offset order, and are exactly the records.
+    std::vector<char> data;
+    slab.forEachBlock([&data](const char* d, std::size_t count)
+    {
+        data.insert(data.end(), d, d + count * pointSize);
+    });
+
+    ASSERT_EQ(data.size(), n * pointSize);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        EXPECT_EQ(
+                value(data.data() + i * pointSize),
+                static_cast<int32_t>(i * 7));
+    }
+}
+
+TEST(PointSlab, Chains)
+{
+    PointSlab slab(makeSlab(2));
+    Cell::Pool cellPool(8);
+    Data::Pool dataPool(pointSize, 8);
+
+    auto makeCell([&](std::size_t count, int32_t first)
+    {
+        Cell::PooledNode cell(cellPool.acquireOne());
+        for (std::size_t i(0); i < count; ++i)
+        {
+            Data::PooledNode node(dataPool.acquireOne());
+            write(*node, 1, 2, 3, first + i);
+            cell->push(std::move(node));
+        }
+        cell->point() = Point(1, 2, 3);
+        return cell;
+    });
+
+    auto release([&](Cell::PooledNode& cell)
+    {
+        Data::PooledStack dataStack(dataPool);
+        dataStack.push(cell->acquire());
+    });
+
+    Cell::PooledNode a(makeCell(3, 0));
+    PointSlab::Offset head(slab.store(*a));
+    release(a);
+
+    EXPECT_EQ(slab.chainSize(head), 3u);
+    EXPECT_EQ(slab.point(head), Point(1, 2, 3));
+
+    Cell::PooledNode b(makeCell(2, 10));
+    slab.prepend(head, *b);
+    release(b);
+
+    EXPECT_EQ(slab.chainSize(head), 5u);
+    EXPECT_EQ(slab.size(), 5u);
+    EXPECT_EQ(slab.dead(), 0u);
+
+    // Overwriting with a shorter chain reuses records, leaving some dead.
+    Cell::PooledNode c(makeCell(1, 20));
+    head = slab.store(*c, head);
+    release(c);
+
+    EXPECT_EQ(slab.chainSize(head), 1u);
+    EXPECT_EQ(value(slab.data(head)), 20);
+    EXPECT_EQ(slab.size(), 5u);
+    EXPECT_EQ(slab.dead(), 4u);
+
+    // And with a longer one, reserves more.
+    Cell::PooledNode d(makeCell(3, 30));
+    head = slab.store(*d, head);
+    release(d);
+
+    EXPECT_EQ(slab.chainSize(head), 3u);
+    EXPECT_EQ(slab.size(), 7u);
+
+    PointSlab other(makeSlab(16));
+    const PointSlab::Offset copied(other.copy(slab, head));
+    EXPECT_EQ(other.chainSize(copied), 3u);
+
+    std::vector<int32_t> values;
+    for (PointSlab::Offset o(copied); o != PointSlab::none; o = other.next(o))
+    {
+        values.push_back(value(other.data(o)));
+    }
+    std::sort(values.begin(), values.end());
+    EXPECT_EQ(values, (std::vector<int32_t>{ 30, 31, 32 }));
+}
+
+TEST(PointSlab, Concurrent)
+{
+    PointSlab slab(makeSlab(1));
+
+    const std::size_t numThreads(8);
+    const std::size_t rounds(6000);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&slab, t, rounds]()
+        {
+            for (std::size_t r(0); r < rounds; ++r)
+            {
+                const std::size_t count(1 + r % 3);
+                const PointSlab::Offset begin(slab.reserve(count));
+
+                for (std::size_t i(0); i < count; ++i)
+                {
+                    write(slab.data(begin + i), t, r, i, t);
+                    slab.link(begin + i, PointSlab::none);
+                }
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    std::vector<std::size_t> counts(numThreads, 0);
+    for (std::size_t i(0); i < slab.size(); ++i)
+    {
+        const int32_t t(value(slab.data(i)));
+        ASSERT_LT(t, static_cast<int32_t>(numThreads));
+        ASSERT_EQ(slab.point(i).x, t);
+        ++counts[t];
+    }
+
+    for (const std::size_t c : counts) EXPECT_EQ(c, rounds * 2);
+}
+
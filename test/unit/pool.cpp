@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <entwine/util/pool.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    struct Owned
+    {
+        int operator()() const { return *value; }
+        std::unique_ptr<int> value;
+    };
+}
+
+TEST(Pool, Await)
+{
+    Pool pool(4);
+    std::atomic_size_t count(0);
+
+    for (std::size_t i(0); i < 1000; ++i)
+    {
+        pool.add([&count]() { ++count; });
+    }
+
+    pool.await();
+    EXPECT_EQ(count, 1000u);
+
+    // Tasks may still be added after awaiting.
+    pool.add([&count]() { ++count; });
+    pool.join();
+
+    EXPECT_EQ(count, 1001u);
+    EXPECT_TRUE(pool.errors().empty());
+}
+
+TEST(Pool, Spawn)
+{
+    // Tasks added by a worker land in its own deque, from which the other
+    // workers must steal them.
+    Pool pool(8, 64);
+    std::atomic_size_t count(0);
+
+    for (std::size_t i(0); i < 8; ++i)
+    {
+        pool.add([&pool, &count]()
+        {
+            for (std::size_t j(0); j < 50; ++j)
+            {
+                pool.add([&count]() { ++count; }, Pool::Priority::High);
+            }
+        });
+    }
+
+    pool.join();
+    EXPECT_EQ(count, 400u);
+}
+
+TEST(Pool, Submit)
+{
+    Pool pool(2, 8);
+
+    std::vector<std::future<std::size_t>> results;
+    for (std::size_t i(0); i < 20; ++i)
+    {
+        results.push_back(pool.submit([i]() { return i * i; }));
+    }
+
+    for (std::size_t i(0); i < results.size(); ++i)
+    {
+        EXPECT_EQ(results[i].get(), i * i);
+    }
+
+    // Move-only tasks are allowed.
+    Owned owned;
+    owned.value.reset(new int(42));
+    EXPECT_EQ(pool.submit(std::move(owned)).get(), 42);
+
+    // Exceptions are delivered through the future rather than recorded as
+    // errors.
+    auto f(pool.submit([]() -> int { throw std::runtime_error("Bad"); }));
+    EXPECT_THROW(f.get(), std::runtime_error);
+
+    pool.join();
+    EXPECT_TRUE(pool.errors().empty());
+
+    pool.go();
+    pool.add([]() { throw std::runtime_error("Recorded"); });
+    pool.join();
+    ASSERT_EQ(pool.errors().size(), 1u);
+    EXPECT_EQ(pool.errors().front(), "Recorded");
+}
+
+TEST(Pool, Limit)
+{
+    Pool pool(8, 64);
+    pool.limit(2);
+    EXPECT_EQ(pool.limit(), 2u);
+
+    std::atomic_size_t running(0);
+    std::atomic_size_t most(0);
+
+    auto task([&]()
+    {
+        const std::size_t now(++running);
+        std::size_t prev(most);
+        while (now > prev && !most.compare_exchange_weak(prev, now)) { }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        --running;
+    });
+
+    for (std::size_t i(0); i < 100; ++i) pool.add(task);
+    pool.await();
+    EXPECT_LE(most, 2u);
+
+    // Raising the limit lets parked threads run again.
+    pool.limit(8);
+    most = 0;
+    for (std::size_t i(0); i < 100; ++i) pool.add(task);
+    pool.join();
+    EXPECT_GT(most, 2u);
+}
+
+TEST(Pool, TryAdd)
+{
+    Pool pool(1, 1);
+
+    std::atomic_bool started(false);
+    std::atomic_bool release(false);
+    std::atomic_size_t count(0);
+
+    pool.add([&]()
+    {
+        started = true;
+        while (!release) std::this_thread::yield();
+    });
+
+    while (!started) std::this_thread::yield();
+
+    // Our only worker is busy, so there is room for just one queued task.
+    EXPECT_TRUE(pool.tryAdd([&count]() { ++count; }));
+    EXPECT_FALSE(pool.tryAdd([&count]() { ++count; }));
+
+    release = true;
+    pool.join();
+    EXPECT_EQ(count, 1u);
+}
@@ -0,0 +1,142 @@
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/tree/prefetcher.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    // Serves files from memory in place of a remote HTTP endpoint.
+    class StandIn : public arbiter::Driver
+    {
+    public:
+        explicit StandIn(std::atomic_size_t& gets) : m_gets(gets) { }
+
+        virtual std::string type() const override { return "standin"; }
+
+        virtual void put(std::string, const std::vector<char>&) const override
+        {
+            throw std::runtime_error("Stand-in is read-only");
+        }
+
+        virtual std::unique_ptr<std::size_t> tryGetSize(
+                std::string path) const override
+        {
+            return std::unique_ptr<std::size_t>(
+                    new std::size_t(contents(path).size()));
+        }
+
+        static std::string contents(const std::string& path)
+        {
+            return std::string(1000, path.back());
+        }
+
+    protected:
+        virtual bool get(std::string path, std::vector<char>& data)
+            const override
+        {
+            ++m_gets;
+            const std::string s(contents(path));
+            data.assign(s.begin(), s.end());
+            return true;
+        }
+
+    private:
+        std::atomic_size_t& m_gets;
+    };
+
+    std::string read(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return std::string(
+                (std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>());
+    }
+}
+
+class PrefetcherTest : public ::testing::Test
+{
+protected:
+    PrefetcherTest()
+        : gets(0)
+        , a()
+        , tmp(a.getEndpoint(arbiter::fs::getTempPath()))
+    {
+        a.addDriver(
+                "standin",
+                std::unique_ptr<arbiter::Driver>(new StandIn(gets)));
+    }
+
+    std::atomic_size_t gets;
+    arbiter::Arbiter a;
+    arbiter::Endpoint tmp;
+};
+
+TEST_F(PrefetcherTest, Fetch)
+{
+    Prefetcher prefetcher(a, tmp, 2, 0);
+
+    prefetcher.push(0, "standin://a");
+    prefetcher.push(1, "standin://b");
+
+    auto handle(prefetcher.take(0, "standin://a"));
+    EXPECT_EQ(read(handle->localPath()), StandIn::contents("a"));
+    handle.reset();
+    prefetcher.release(0);
+
+    handle = prefetcher.take(1, "standin://b");
+    EXPECT_EQ(read(handle->localPath()), StandIn::contents("b"));
+    handle.reset();
+    prefetcher.release(1);
+
+    EXPECT_EQ(gets, 2u);
+    EXPECT_EQ(prefetcher.fetched(), 2u);
+    EXPECT_EQ(prefetcher.bytes(), 0u);
+
+    // Inputs which were not pushed are fetched when taken.
+    handle = prefetcher.take(2, "standin://c");
+    EXPECT_EQ(read(handle->localPath()), StandIn::contents("c"));
+    EXPECT_EQ(gets, 3u);
+    EXPECT_EQ(prefetcher.fetched(), 2u);
+}
+
+TEST_F(PrefetcherTest, Budget)
+{
+    Prefetcher prefetcher(a, tmp, 4, 1000);
+
+    prefetcher.push(0, "standin://a");
+    auto handle(prefetcher.take(0, "standin://a"));
+
+    // The fetched input counts against the budget until it is released, not
+    // merely until it is taken.
+    EXPECT_TRUE(prefetcher.full());
+    EXPECT_EQ(prefetcher.bytes(), 1000u);
+
+    handle.reset();
+    prefetcher.release(0);
+    EXPECT_FALSE(prefetcher.full());
+    prefetcher.await();
+}
+
+TEST_F(PrefetcherTest, Disabled)
+{
+    Prefetcher prefetcher(a, tmp, 0, 0);
+
+    prefetcher.push(0, "standin://a");
+    EXPECT_EQ(gets, 0u);
+
+    auto handle(prefetcher.take(0, "standin://a"));
+    EXPECT_EQ(read(handle->localPath()), StandIn::contents("a"));
+    EXPECT_EQ(gets, 1u);
+    EXPECT_EQ(prefetcher.fetched(), 0u);
+}
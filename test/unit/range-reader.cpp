@@ -0,0 +1,205 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <entwine/third/arbiter/arbiter.hpp>
+#include <entwine/util/mapped-file.hpp>
+#include <entwine/util/range-reader.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const std::size_t fileSize(10000);
+
+    std::vector<char> contents()
+    {
+        std::vector<char> data(fileSize);
+        for (std::size_t i(0); i < data.size(); ++i) data[i] = i % 251;
+        return data;
+    }
+
+    // Serves byte ranges of a single file from memory, in place of a remote
+    // HTTP endpoint.  Unless ranged, it answers every request with the whole
+    // file, as servers without range support do.
+    class StandIn : public arbiter::drivers::Http
+    {
+    public:
+        StandIn(
+                arbiter::http::Pool& pool,
+                std::atomic_size_t& gets,
+                const bool& ranged)
+            : Http(pool)
+            , m_gets(gets)
+            , m_ranged(ranged)
+        { }
+
+        virtual std::string type() const override { return "standin"; }
+
+        virtual std::unique_ptr<std::size_t> tryGetSize(std::string) const
+            override
+        {
+            return std::unique_ptr<std::size_t>(new std::size_t(fileSize));
+        }
+
+    protected:
+        virtual bool get(
+                std::string,
+                std::vector<char>& data,
+                arbiter::http::Headers headers,
+                arbiter::http::Query) const override
+        {
+            ++m_gets;
+
+            const std::vector<char> all(contents());
+
+            if (!m_ranged || !headers.count("Range"))
+            {
+                data = all;
+                return true;
+            }
+
+            const std::string range(headers.at("Range"));
+            const std::size_t dash(range.find('-'));
+
+            const std::size_t begin(std::stoul(range.substr(6, dash - 6)));
+            const std::size_t end(std::stoul(range.substr(dash + 1)) + 1);
+
+            data.assign(all.begin() + begin, all.begin() + end);
+            return true;
+        }
+
+    private:
+        std::atomic_size_t& m_gets;
+        const bool& m_ranged;
+    };
+}
+
+class RangeReaderTest : public ::testing::Test
+{
+protected:
+    RangeReaderTest()
+        : gets(0)
+        , ranged(true)
+        , a()
+    {
+        a.addDriver(
+                "standin",
+                std::unique_ptr<arbiter::Driver>(
+                    new StandIn(a.httpPool(), gets, ranged)));
+    }
+
+    std::atomic_size_t gets;
+    bool ranged;
+    arbiter::Arbiter a;
+};
+
+TEST_F(RangeReaderTest, Read)
+{
+    RangeReader reader(a, "standin://file", fileSize, 3000, 2);
+
+    std::vector<char> data;
+    std::vector<std::size_t> sizes;
+
+    while (!reader.done())
+    {
+        const std::vector<char> block(reader.next());
+        sizes.push_back(block.size());
+        data.insert(data.end(), block.begin(), block.end());
+    }
+
+    EXPECT_EQ(sizes, std::vector<std::size_t>({ 3000, 3000, 3000, 1000 }));
+    EXPECT_EQ(data, contents());
+    EXPECT_EQ(gets, 4u);
+    EXPECT_TRUE(reader.next().empty());
+}
+
+TEST_F(RangeReaderTest, LocalFile)
+{
+    const auto tmp(a.getEndpoint(arbiter::fs::getTempPath()));
+    std::string path;
+
+    {
+        auto local(LocalFile::fetch(a, "standin://file", tmp, 4096, 1));
+        path = local->localPath();
+
+        std::ifstream file(path, std::ios::binary);
+        const std::vector<char> data(
+                (std::istreambuf_iterator<char>(file)),
+                std::istreambuf_iterator<char>());
+
+        EXPECT_EQ(data, contents());
+        EXPECT_EQ(gets, 3u);
+    }
+
+    // Our download is removed along with its handle.
+    EXPECT_FALSE(std::ifstream(path).good());
+}
+
+TEST_F(RangeReaderTest, Unranged)
+{
+    ranged = false;
+
+    {
+        RangeReader reader(a, "standin://file", fileSize, 3000, 2);
+        EXPECT_THROW(reader.next(), RangeReader::Unranged);
+    }
+
+    // Only the requests already in flight were sent.
+    EXPECT_LE(gets, 3u);
+
+    const auto tmp(a.getEndpoint(arbiter::fs::getTempPath()));
+    gets = 0;
+
+    auto local(LocalFile::fetch(a, "standin://file", tmp, 4096, 1));
+
+    std::ifstream file(local->localPath(), std::ios::binary);
+    const std::vector<char> data(
+            (std::istreambuf_iterator<char>(file)),
+            std::istreambuf_iterator<char>());
+
+    EXPECT_EQ(data, contents());
+    EXPECT_LE(gets, 3u);
+}
+
+TEST_F(RangeReaderTest, FileView)
+{
+    const auto ep(a.getEndpoint("standin://dir"));
+    const std::vector<char> all(contents());
+
+    {
+        const FileView view(ep, "file", 1234, 100);
+        ASSERT_EQ(view.size(), 100u);
+        EXPECT_EQ(
+                std::vector<char>(view.data(), view.data() + view.size()),
+                std::vector<char>(all.begin() + 1234, all.begin() + 1334));
+    }
+
+    {
+        const auto last(FileView::last(ep, "file", 100));
+        ASSERT_EQ(last->size(), 100u);
+        EXPECT_TRUE(
+                std::equal(last->data(), last->data() + 100, all.end() - 100));
+    }
+
+    ranged = false;
+
+    // Without range support, a range must not silently view the wrong bytes.
+    EXPECT_THROW(FileView(ep, "file", 1234, 100), RangeReader::Unranged);
+
+    // The end of the whole file is still the end of the file.
+    const auto last(FileView::last(ep, "file", 100));
+    ASSERT_GE(last->size(), 100u);
+    EXPECT_TRUE(
+            std::equal(
+                last->data() + last->size() - 100,
+                last->data() + last->size(),
+                all.end() - 100));
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+
+#include <entwine/tree/residency.hpp>
+
+using namespace entwine;
+
+TEST(Residency, Release)
+{
+    Residency residency(32);
+    const std::size_t bytes(residency.bytes(1000));
+
+    residency.release(Id(1), 1, 1000);
+    residency.release(Id(2), 2, 1000);
+    EXPECT_EQ(residency.idle(), 2 * bytes);
+
+    // Released again without being taken back, so only counted once.
+    residency.release(Id(2), 2, 1000);
+    EXPECT_EQ(residency.idle(), 2 * bytes);
+
+    residency.revive(Id(1));
+    EXPECT_EQ(residency.idle(), bytes);
+    EXPECT_EQ(residency.revivals(), 1u);
+
+    // Chunks which are not idle are ignored.
+    residency.revive(Id(1));
+    residency.forget(Id(3));
+    EXPECT_EQ(residency.revivals(), 1u);
+
+    const auto victims(residency.take(0));
+    ASSERT_EQ(victims.size(), 1u);
+    EXPECT_EQ(victims.front().chunkId, Id(2));
+    EXPECT_EQ(victims.front().chunkNum, 2u);
+    EXPECT_EQ(residency.idle(), 0u);
+}
+
+TEST(Residency, Policy)
+{
+    Residency residency(32);
+
+    // Of equal sizes, the chunk released first is evicted first.
+    residency.release(Id(1), 1, 1000);
+    residency.release(Id(2), 2, 1000);
+
+    auto victims(residency.take(residency.bytes(1000)));
+    ASSERT_EQ(victims.size(), 1u);
+    EXPECT_EQ(victims.front().chunkId, Id(1));
+
+    victims = residency.take(0);
+    ASSERT_EQ(victims.size(), 1u);
+    EXPECT_EQ(victims.front().chunkId, Id(2));
+
+    // The larger chunk is evicted first, even though the smaller one was
+    // released before it.
+    residency.release(Id(4), 4, 10);
+    residency.release(Id(3), 3, 100000);
+
+    victims = residency.take(residency.bytes(10));
+    ASSERT_EQ(victims.size(), 1u);
+    EXPECT_EQ(victims.front().chunkId, Id(3));
+    EXPECT_EQ(residency.idle(), residency.bytes(10));
+}
@@ -0,0 +1,125 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <entwine/third/splice-pool/splice-pool.hpp>
+
+namespace
+{
+    using Pool = splicer::ObjectPool<std::size_t>;
+    using Buffers = splicer::BufferPool<char>;
+}
+
+TEST(SplicePool, Counters)
+{
+    Pool pool(16);
+
+    {
+        auto stack(pool.acquire(8));
+        EXPECT_EQ(stack.size(), 8u);
+        EXPECT_EQ(pool.misses(), 1u);
+    }
+
+    // Released into this thread's cache, so it can be reacquired from there.
+    {
+        auto node(pool.acquireOne(42));
+        EXPECT_EQ(*node, 42u);
+        EXPECT_EQ(pool.hits(), 1u);
+
+        auto stack(pool.acquire(4));
+        EXPECT_EQ(pool.hits(), 2u);
+        EXPECT_EQ(pool.used(), 5u);
+    }
+
+    EXPECT_EQ(pool.used(), 0u);
+}
+
+TEST(SplicePool, Concurrent)
+{
+    Pool pool(64);
+
+    const std::size_t numThreads(8);
+    const std::size_t rounds(2000);
+    std::vector<std::thread> threads;
+    std::vector<std::size_t> failures(numThreads, 0);
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&pool, &failures, t, rounds]()
+        {
+            for (std::size_t r(0); r < rounds; ++r)
+            {
+                // Mix single and bulk acquisitions, with sizes both smaller
+                // and larger than a cache.
+                Pool::UniqueStackType stack(pool.acquire(1 + r % 700));
+                for (auto& v : stack) v = t;
+
+                std::vector<Pool::UniqueNodeType> nodes;
+                for (std::size_t i(0); i < r % 20; ++i)
+                {
+                    nodes.push_back(pool.acquireOne(t));
+                }
+
+                // Nodes held by this thread must not be handed to any other.
+                for (const auto& v : stack) if (v != t) ++failures[t];
+                for (const auto& n : nodes) if (*n != t) ++failures[t];
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    for (const std::size_t f : failures) EXPECT_EQ(f, 0u);
+    EXPECT_EQ(pool.used(), 0u);
+    EXPECT_GT(pool.hits(), 0u);
+    EXPECT_EQ(pool.allocated() % 64, 0u);
+}
+
+
+TEST(SplicePool, Trim)
+{
+    // Buffers of several pages each, so runs of them hold whole pages.
+    const std::size_t page(sysconf(_SC_PAGESIZE));
+    const std::size_t size(4 * page);
+    const std::size_t count(64);
+
+    Buffers pool(size, count);
+
+    auto zeroed([size](const char* b)
+    {
+        return std::all_of(b, b + size, [](char c) { return c == 0; });
+    });
+
+    {
+        auto stack(pool.acquire(count));
+        for (char* b : stack) std::fill(b, b + size, 'x');
+    }
+
+    // Released as a whole block, so the free buffers are all in the shared
+    // stack, where they may be trimmed.
+    const std::size_t allocated(pool.allocated());
+    EXPECT_EQ(pool.used(), 0u);
+    EXPECT_GE(pool.trim(), count * (size - 2 * page));
+    EXPECT_EQ(pool.allocated(), allocated);
+
+    // Trimmed buffers remain available, and are constructed anew, so they
+    // read back as zeros and may be written again.
+    {
+        auto stack(pool.acquire(count));
+        EXPECT_EQ(pool.allocated(), allocated);
+
+        for (char* b : stack)
+        {
+            EXPECT_TRUE(zeroed(b));
+            std::fill(b, b + size, 'y');
+        }
+    }
+
+    // Buffers reused without a trim in between are constructed anew as well.
+    auto stack(pool.acquire(count));
+    for (const char* b : stack) EXPECT_TRUE(zeroed(b));
+}
@@ -0,0 +1,502 @@
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <entwine/types/point-pool.hpp>
+#include <entwine/types/schema.hpp>
+#include <entwine/types/tube.hpp>
+#include <entwine/types/tube-map.hpp>
+#include <entwine/types/tube-pages.hpp>
+
+using namespace entwine;
+
+namespace
+{
+    const Schema schema({
+            { pdal::Dimension::Id::X },
+            { pdal::Dimension::Id::Y },
+            { pdal::Dimension::Id::Z } });
+
+    const Point mid(0, 0, 0);
+
+    struct Input
+    {
+        uint64_t tick;
+        Point point;
+    };
+
+    std::vector<Input> makeInputs(
+            const std::size_t count,
+            const std::size_t numTicks,
+            const unsigned seed)
+    {
+        // Use a small integral grid so duplicate points are common enough to
+        // exercise the merging path as well as the swapping path.
+        std::mt19937 gen(seed);
+        std::uniform_int_distribution<int> coord(-4, 4);
+        std::uniform_int_distribution<uint64_t> tick(0, numTicks - 1);
+
+        std::vector<Input> inputs;
+        for (std::size_t i(0); i < count; ++i)
+        {
+            inputs.push_back(
+                    Input { tick(gen), Point(coord(gen), coord(gen), coord(gen)) });
+        }
+        return inputs;
+    }
+
+    Cell::PooledNode makeCell(PointPool& pool, const Point& p)
+    {
+        Cell::PooledNode cell(pool.cellPool().acquireOne());
+        Data::PooledNode data(pool.dataPool().acquireOne());
+
+        const double xyz[3] = { p.x, p.y, p.z };
+        std::memcpy(*data, xyz, sizeof(xyz));
+
+        cell->point() = p;
+        cell->push(std::move(data));
+        return cell;
+    }
+
+    std::vector<Cell::PooledNode> makeCells(
+            PointPool& pool,
+            const std::vector<Input>& inputs,
+            std::size_t begin,
+            std::size_t end)
+    {
+        std::vector<Cell::PooledNode> cells;
+        for (std::size_t i(begin); i < end; ++i)
+        {
+            cells.push_back(makeCell(pool, inputs[i].point));
+        }
+        return cells;
+    }
+
+    // Insert the inputs across the given number of threads, returning the
+    // number of points that were kicked out of the tube.
+    template<typename T>
+    std::size_t insertAll(
+            T& tube,
+            PointPool& pool,
+            const std::vector<Input>& inputs,
+            const std::size_t numThreads)
+    {
+        const std::size_t per(inputs.size() / numThreads);
+
+        std::vector<std::vector<Cell::PooledNode>> cells;
+        for (std::size_t t(0); t < numThreads; ++t)
+        {
+            cells.push_back(makeCells(pool, inputs, t * per, (t + 1) * per));
+        }
+
+        std::vector<std::size_t> rejected(numThreads, 0);
+        std::vector<std::thread> threads;
+
+        for (std::size_t t(0); t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                Cell::PooledStack reject(pool.cellPool());
+
+                for (std::size_t i(0); i < per; ++i)
+                {
+                    auto& cell(cells[t][i]);
+                    const auto tick(inputs[t * per + i].tick);
+
+                    if (!tube.insert(tick, mid, schema.pointSize(), cell)
+                            .done())
+                    {
+                        rejected[t] += cell->size();
+                        reject.push(std::move(cell));
+                    }
+                }
+
+                pool.release(std::move(reject));
+            });
+        }
+
+        for (auto& t : threads) t.join();
+
+        std::size_t total(0);
+        for (const auto r : rejected) total += r;
+        return total;
+    }
+
+    template<typename T>
+    std::map<uint64_t, std::pair<Point, std::size_t>> residents(const T& tube)
+    {
+        std::map<uint64_t, std::pair<Point, std::size_t>> result;
+        for (const auto& entry : tube)
+        {
+            result[entry.first] =
+                std::make_pair(entry.second->point(), entry.second->size());
+        }
+        return result;
+    }
+
+    template<typename T>
+    void clear(T& tube, PointPool& pool)
+    {
+        Cell::PooledStack cells(pool.cellPool());
+        for (auto& entry : tube) cells.push(std::move(entry.second));
+        pool.release(std::move(cells));
+    }
+
+    template<typename T>
+    void checkConcurrent(const std::size_t numThreads)
+    {
+        PointPool pool(schema, nullptr, 4096);
+        const std::size_t numTicks(64);
+        const auto inputs(makeInputs(numThreads * 20000, numTicks, 42));
+
+        // The expected resident of each tick is the point nearest the middle,
+        // and all duplicates of that point should have merged into it.
+        std::map<uint64_t, std::pair<Point, std::size_t>> expected;
+        for (const auto& input : inputs)
+        {
+            auto it(expected.find(input.tick));
+            if (it == expected.end())
+            {
+                expected[input.tick] = std::make_pair(input.point, 1);
+                continue;
+            }
+
+            auto& best(it->second);
+            if (input.point == best.first)
+            {
+                ++best.second;
+                continue;
+            }
+
+            const auto a(input.point.sqDist3d(mid));
+            const auto b(best.first.sqDist3d(mid));
+            if (a < b || (a == b && ltChained(input.point, best.first)))
+            {
+                best = std::make_pair(input.point, 1);
+            }
+        }
+
+        T tube;
+        const std::size_t rejected(insertAll(tube, pool, inputs, numThreads));
+        const auto actual(residents(tube));
+
+        std::size_t resident(0);
+        for (const auto& p : actual) resident += p.second.second;
+
+        EXPECT_EQ(resident + rejected, inputs.size());
+        ASSERT_EQ(actual.size(), expected.size());
+
+        for (const auto& p : expected)
+        {
+            ASSERT_TRUE(actual.count(p.first));
+            EXPECT_EQ(actual.at(p.first).first, p.second.first);
+            EXPECT_EQ(actual.at(p.first).second, p.second.second);
+        }
+
+        clear(tube, pool);
+    }
+
+    template<typename T>
+    double timeInserts(
+            const std::vector<Input>& inputs,
+            const std::size_t numTubes,
+            const std::size_t numThreads)
+    {
+        PointPool pool(schema, nullptr, 4096);
+        std::vector<T> tubes(numTubes);
+
+        const std::size_t per(inputs.size() / numThreads);
+
+        std::vector<std::vector<Cell::PooledNode>> cells;
+        for (std::size_t t(0); t < numThreads; ++t)
+        {
+            cells.push_back(makeCells(pool, inputs, t * per, (t + 1) * per));
+        }
+
+        std::vector<std::thread> threads;
+        const auto start(std::chrono::high_resolution_clock::now());
+
+        for (std::size_t t(0); t < numThreads; ++t)
+        {
+            threads.emplace_back([&, t]()
+            {
+                for (std::size_t i(0); i < per; ++i)
+                {
+                    const Input& input(inputs[t * per + i]);
+                    T& tube(tubes[(input.tick * 31 + i) % numTubes]);
+                    tube.insert(
+                            input.tick,
+                            mid,
+                            schema.pointSize(),
+                            cells[t][i]);
+                }
+            });
+        }
+
+        for (auto& t : threads) t.join();
+
+        const std::chrono::duration<double> elapsed(
+                std::chrono::high_resolution_clock::now() - start);
+
+        Cell::PooledStack leftovers(pool.cellPool());
+        for (auto& c : cells) for (auto& cell : c) if (cell)
+        {
+            leftovers.push(std::move(cell));
+        }
+        pool.release(std::move(leftovers));
+        for (auto& tube : tubes) clear(tube, pool);
+
+        return elapsed.count();
+    }
+}
+
+TEST(Tube, FlatMatchesMap)
+{
+    PointPool pool(schema, nullptr, 4096);
+    const auto inputs(makeInputs(50000, 256, 7));
+
+    MapTube mapTube;
+    FlatTube flatTube;
+
+    EXPECT_TRUE(flatTube.empty());
+
+    const std::size_t mapRejected(insertAll(mapTube, pool, inputs, 1));
+    const std::size_t flatRejected(insertAll(flatTube, pool, inputs, 1));
+
+    EXPECT_FALSE(flatTube.empty());
+    EXPECT_EQ(mapRejected, flatRejected);
+    EXPECT_EQ(residents(mapTube), residents(flatTube));
+
+    clear(mapTube, pool);
+    clear(flatTube, pool);
+}
+
+TEST(Tube, FlatMove)
+{
+    PointPool pool(schema, nullptr, 4096);
+    const auto inputs(makeInputs(1000, 32, 3));
+
+    FlatTube a;
+    insertAll(a, pool, inputs, 1);
+    const auto before(residents(a));
+
+    FlatTube b(std::move(a));
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(residents(b), before);
+
+    clear(b, pool);
+}
+
+TEST(Tube, SlabMatchesMap)
+{
+    PointPool pool(schema, nullptr, 4096);
+    const std::size_t numThreads(4);
+    const auto inputs(makeInputs(numThreads * 20000, 64, 11));
+
+    MapTube mapTube;
+    const std::size_t mapRejected(insertAll(mapTube, pool, inputs, 1));
+
+    SlabTube slabTube;
+    PointSlab slab(schema);
+    const std::size_t per(inputs.size() / numThreads);
+    std::vector<std::size_t> rejected(numThreads, 0);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            auto cells(makeCells(pool, inputs, t * per, (t + 1) * per));
+            Cell::PooledStack reject(pool.cellPool());
+
+            for (std::size_t i(0); i < per; ++i)
+            {
+                auto& cell(cells[i]);
+                const auto tick(inputs[t * per + i].tick);
+
+                if (!slabTube.insert(tick, mid, cell, slab, pool).done())
+                {
+                    rejected[t] += cell->size();
+                    reject.push(std::move(cell));
+                }
+            }
+
+            pool.release(std::move(reject));
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    std::map<uint64_t, std::pair<Point, std::size_t>> actual;
+    std::size_t resident(0);
+    for (const auto& entry : slabTube)
+    {
+        actual[entry.first] = std::make_pair(
+                slab.point(entry.second),
+                slab.chainSize(entry.second));
+        resident += actual[entry.first].second;
+    }
+
+    std::size_t slabRejected(0);
+    for (const auto r : rejected) slabRejected += r;
+
+    EXPECT_EQ(actual, residents(mapTube));
+    EXPECT_EQ(slabRejected, mapRejected);
+    EXPECT_EQ(slab.size() - slab.dead(), resident);
+
+    // Of the two, only the map tube still holds cells.
+    EXPECT_EQ(pool.cellPool().used(), actual.size());
+
+    clear(mapTube, pool);
+}
+
+TEST(Tube, MapConcurrent)
+{
+    checkConcurrent<MapTube>(8);
+}
+
+TEST(Tube, FlatConcurrent)
+{
+    checkConcurrent<FlatTube>(8);
+}
+
+// Not a correctness test - compares insertion throughput of the tube
+// implementations under contention.  Run with:
+//      entwine-test --gtest_filter=*TubeBenchmark* --gtest_also_run_disabled_tests
+TEST(TubeBenchmark, DISABLED_Insert)
+{
+    const std::size_t numThreads(
+            std::max<std::size_t>(std::thread::hardware_concurrency(), 2));
+    const auto inputs(makeInputs(numThreads * 500000, 1024, 1));
+
+    for (const std::size_t numTubes : { 1, 16, 256 })
+    {
+        const double map(timeInserts<MapTube>(inputs, numTubes, numThreads));
+        const double flat(timeInserts<FlatTube>(inputs, numTubes, numThreads));
+
+        std::cout <<
+            "Tubes: " << numTubes << ", threads: " << numThreads << "\n" <<
+            "\tMapTube:  " << map << "s\n" <<
+            "\tFlatTube: " << flat << "s\n" <<
+            "\tSpeedup:  " << map / flat << "x" << std::endl;
+    }
+}
+
+// These insert through the generic Tube, whose interface differs when resident
+// points are kept in chunk slabs.
+#ifndef ENTWINE_SLAB_TUBE
+TEST(TubeMap, OrderedIteration)
+{
+    PointPool pool(schema, nullptr, 4096);
+    TubeMap tubes(7);
+
+    EXPECT_TRUE(tubes.empty());
+
+    const std::size_t numThreads(8);
+    const std::size_t numIds(1000);
+    std::vector<std::thread> threads;
+
+    for (std::size_t t(0); t < numThreads; ++t)
+    {
+        threads.emplace_back([&, t]()
+        {
+            for (std::size_t i(t); i < numIds; i += numThreads)
+            {
+                // Each tube receives a single cell at tick 0.
+                Cell::PooledNode cell(makeCell(pool, Point(i, i, i)));
+                EXPECT_TRUE(tubes.get((numIds - i) * 37).insert(
+                            0, mid, schema.pointSize(), cell).done());
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_FALSE(tubes.empty());
+
+    std::vector<Id> ids;
+    Cell::PooledStack cells(pool.cellPool());
+
+    tubes.forEach([&](const Id& id, Tube& tube)
+    {
+        ids.push_back(id);
+        for (auto& entry : tube) cells.push(std::move(entry.second));
+    });
+
+    ASSERT_EQ(ids.size(), numIds);
+    EXPECT_TRUE(std::is_sorted(ids.begin(), ids.end()));
+    EXPECT_EQ(cells.size(), numIds);
+
+    pool.release(std::move(cells));
+}
+
+TEST(TubePages, Lazy)
+{
+    PointPool pool(schema, nullptr, 4096);
+    const std::size_t pageSize(16);
+
+    auto fill([&](TubePages& tubes, std::size_t i, double v)
+    {
+        Cell::PooledNode cell(makeCell(pool, Point(v, v, v)));
+        EXPECT_TRUE(
+                tubes.at(i).insert(0, mid, schema.pointSize(), cell).done());
+    });
+
+    auto drain([&](TubePages& tubes)
+    {
+        std::vector<double> values;
+        Cell::PooledStack cells(pool.cellPool());
+
+        tubes.forEach([&](Tube& tube)
+        {
+            for (auto& entry : tube)
+            {
+                values.push_back(entry.second->point().x);
+                cells.push(std::move(entry.second));
+            }
+        });
+
+        pool.release(std::move(cells));
+        return values;
+    });
+
+    TubePages a(100, pageSize);
+    EXPECT_EQ(a.size(), 100u);
+    EXPECT_EQ(a.allocated(), 0u);
+    EXPECT_TRUE(a.empty());
+    EXPECT_THROW(a.at(100), std::out_of_range);
+
+    fill(a, 3, 3);
+    fill(a, 99, 99);
+    EXPECT_EQ(a.allocated(), 2u);
+    EXPECT_FALSE(a.empty());
+
+    // An unaligned append moves tubes individually.
+    TubePages b(40, pageSize);
+    fill(b, 0, 100);
+    fill(b, 39, 139);
+    a.append(b);
+
+    EXPECT_EQ(a.size(), 140u);
+    EXPECT_EQ(b.size(), 0u);
+    EXPECT_TRUE(b.empty());
+
+    // An aligned one hands over whole pages.
+    TubePages c(pageSize * 2, pageSize);
+    TubePages d(8, pageSize);
+    fill(c, 1, 1);
+    fill(d, 7, 39);
+    c.append(d);
+    EXPECT_EQ(c.allocated(), 2u);
+
+    EXPECT_EQ(drain(a), (std::vector<double>{ 3, 99, 100, 139 }));
+    EXPECT_EQ(drain(c), (std::vector<double>{ 1, 39 }));
+}
+#endif